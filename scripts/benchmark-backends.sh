@@ -0,0 +1,67 @@
+#!/bin/bash
+
+# Compares the execution backends on every example program: the bytecode VM (-vm), the ORC JIT
+# with and without optimizations (-run, -opt -run), tiered execution (-tiered) and an ahead of
+# time compiled binary (-opt -c + clang, build and execution measured separately). The times
+# are wall clock milliseconds from process start to exit, so they include startup cost.
+
+winzigc="./bazel-bin/winzigc/main/cmd"
+runtime="./bazel-bin/winzigc/runtime/libwz_runtime.a"
+out_dir="$(mktemp -d)"
+export GLOG_logtostderr=1
+
+# stdin of each program, in the same order as the example programs; programs without an entry
+# read an empty input
+inputs=(
+    "12" "541" "100\n127\n607\n" "" "3\n" "7\n" "" "3\n" "1\n2\n3\n2\n" "" "13\n14\n"
+    "100\n20\n-34\n10\n0\n29\n" "234\n100\n" "77\n100\n" "100/5-7*3\n" "127\n100\n"
+    "127\n100\n" "127\n100\n" "" "" "" "" "" "71\n100\n546\n" "" "128\n96\n"
+    "7\n50000\n123456\n-5\n" "90\n" "0\n" "5\n3\n-1\n4\n1\n5\n" "6\n95\n100\n40\n55\n12\n79\n"
+    "1000\n" "12\n" "500\n600\n1000005\n1000000\n1500000\n0\n" "4\n"
+)
+
+now_ns() {
+    date +%s%N
+}
+
+elapsed_ms() {
+    echo $((($2 - $1) / 1000000))
+}
+
+# some programs loop until eof, which never comes, so every run is bounded and reported as
+# "timeout" when it hits the limit
+time_run() {
+    local input=$1
+    shift
+    local start
+    start=$(now_ns)
+    printf "$input" | timeout 2 "$@" >/dev/null 2>&1
+    if [ $? -eq 124 ]; then
+        echo "timeout"
+    else
+        elapsed_ms "$start" "$(now_ns)"
+    fi
+}
+
+printf "%-12s %8s %8s %12s %8s %10s %8s\n" "program" "vm" "run" "opt-run" "tiered" "aot-build" "aot"
+
+for prog in "$(pwd)"/example-programs/winzig_[0-9][0-9]; do
+    winzig_prog_name=$(basename "$prog")
+    input=${inputs[$((10#${winzig_prog_name#winzig_} - 1))]}
+
+    vm=$(time_run "$input" $winzigc -vm "$prog")
+    run=$(time_run "$input" $winzigc -run "$prog")
+    opt_run=$(time_run "$input" $winzigc -opt -run "$prog")
+    tiered=$(time_run "$input" $winzigc -tiered "$prog")
+
+    start=$(now_ns)
+    $winzigc -opt -c -o "$out_dir/$winzig_prog_name.o" "$prog" || exit 1
+    clang "$out_dir/$winzig_prog_name.o" "$runtime" -o "$out_dir/$winzig_prog_name" || exit 1
+    aot_build=$(elapsed_ms "$start" "$(now_ns)")
+    aot=$(time_run "$input" "$out_dir/$winzig_prog_name")
+
+    printf "%-12s %8s %8s %12s %8s %10d %8s\n" "$winzig_prog_name" "$vm" "$run" "$opt_run" \
+        "$tiered" "$aot_build" "$aot"
+done
+
+rm -rf "$out_dir"
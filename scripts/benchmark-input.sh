@@ -0,0 +1,91 @@
+#!/bin/bash
+
+# Measures how fast integers are read: a compiled WinZigC program going through the runtime
+# library against the same loop written in C with scanf("%d"), the way read() used to be
+# compiled. Both sum the integers, so the printed sums must agree. Input comes once from a
+# regular file (mapped by the runtime) and once from a pipe.
+#
+# usage: sh scripts/benchmark-input.sh [number of integers]
+
+winzigc="./bazel-bin/winzigc/main/cmd"
+runtime="./bazel-bin/winzigc/runtime/libwz_runtime.a"
+count=${1:-5000000}
+out_dir="$(mktemp -d)"
+export GLOG_logtostderr=1
+
+cat >"$out_dir/read_sum" <<'EOF'
+program ReadSum:
+
+var n, i, x, sum: integer;
+
+begin
+    read(n);
+    sum := 0;
+    for (i := 1; i <= n; i := i + 1) begin
+        read(x);
+        sum := sum + x
+    end;
+    output(sum)
+end ReadSum.
+EOF
+
+cat >"$out_dir/read_sum_scanf.c" <<'EOF'
+#include <stdio.h>
+
+int main(void) {
+  int n = 0, x = 0;
+  unsigned sum = 0;
+  scanf("%d", &n);
+  for (int i = 1; i <= n; i++) {
+    scanf("%d", &x);
+    sum += x;
+  }
+  printf("%d\n", (int)sum);
+  return 0;
+}
+EOF
+
+$winzigc -opt -c -o "$out_dir/read_sum.o" "$out_dir/read_sum" || exit 1
+clang "$out_dir/read_sum.o" "$runtime" -o "$out_dir/read_sum_runtime" || exit 1
+clang -O2 "$out_dir/read_sum_scanf.c" -o "$out_dir/read_sum_scanf" || exit 1
+
+awk -v n="$count" 'BEGIN {
+    srand(1);
+    print n;
+    for (i = 0; i < n; i++) {
+        print int((rand() - 0.5) * 4294967294);
+    }
+}' >"$out_dir/input.txt"
+size=$(wc -c <"$out_dir/input.txt")
+
+now_ns() {
+    date +%s%N
+}
+
+# prints the sum, the time in milliseconds and the throughput in MB/s
+measure() {
+    local mode=$1
+    local binary=$2
+    local start
+    local end
+    local sum
+    start=$(now_ns)
+    if [ "$mode" = "file" ]; then
+        sum=$("$binary" <"$out_dir/input.txt")
+    else
+        sum=$(cat "$out_dir/input.txt" | "$binary")
+    fi
+    end=$(now_ns)
+    local ms=$(((end - start) / 1000000))
+    [ "$ms" -eq 0 ] && ms=1
+    printf "%12s %10d %10d\n" "$sum" "$ms" $((size * 1000 / ms / 1000000))
+}
+
+echo "$count integers, $size bytes"
+printf "%-8s %-8s %12s %10s %10s\n" "input" "reader" "sum" "time(ms)" "MB/s"
+for mode in file pipe; do
+    printf "%-8s %-8s %s\n" "$mode" "scanf" "$(measure $mode "$out_dir/read_sum_scanf")"
+    printf "%-8s %-8s %s\n" "$mode" "runtime" "$(measure $mode "$out_dir/read_sum_runtime")"
+done
+
+rm -rf "$out_dir"
@@ -0,0 +1,64 @@
+#!/bin/bash
+
+# Compares textual IR (.ll), bitcode (.bc), ThinLTO bitcode and native object (.o) outputs
+# of every example program: size of the emitted file, time spent by winzigc to write it and
+# time spent by clang to turn it into an executable. ThinLTO bitcode is linked with
+# -flto=thin through lld, which reads its module summary.
+
+winzigc="./bazel-bin/winzigc/main/cmd"
+runtime="./bazel-bin/winzigc/runtime/libwz_runtime.a"
+out_dir="$(mktemp -d)"
+export GLOG_logtostderr=1
+
+now_ns() {
+    date +%s%N
+}
+
+elapsed_ms() {
+    echo $((($2 - $1) / 1000000))
+}
+
+printf "%-12s %-8s %10s %12s %10s\n" "program" "format" "size(B)" "compile(ms)" "link(ms)"
+
+for winzigc_prog_path in "$(pwd)"/example-programs/winzig_[0-9][0-9]; do
+    winzig_prog_name=$(basename "$winzigc_prog_path")
+    cp "$winzigc_prog_path" "$out_dir/$winzig_prog_name"
+    prog="$out_dir/$winzig_prog_name"
+
+    for format in ll bc thinlto o; do
+        case $format in
+        ll)
+            flags=""
+            output="$prog.ll"
+            link_flags=""
+            ;;
+        bc)
+            flags="-emit-bc -o $prog.bc"
+            output="$prog.bc"
+            link_flags=""
+            ;;
+        thinlto)
+            flags="-thinlto -o $prog.thin.bc"
+            output="$prog.thin.bc"
+            link_flags="-flto=thin -fuse-ld=lld"
+            ;;
+        o)
+            flags="-c -o $prog.o"
+            output="$prog.o"
+            link_flags=""
+            ;;
+        esac
+
+        start=$(now_ns)
+        $winzigc -opt $flags "$prog" || exit 1
+        compiled=$(now_ns)
+        clang -O3 $link_flags "$output" "$runtime" -o "$prog"_binary || exit 1
+        linked=$(now_ns)
+
+        size=$(wc -c <"$output")
+        printf "%-12s %-8s %10d %12d %10d\n" "$winzig_prog_name" "$format" "$size" \
+            "$(elapsed_ms "$start" "$compiled")" "$(elapsed_ms "$compiled" "$linked")"
+    done
+done
+
+rm -rf "$out_dir"
@@ -0,0 +1,62 @@
+#!/bin/bash
+
+# Profile guided optimization of one WinZigC program. The program is built with instrumentation,
+# run on a training input to write its profile, and rebuilt from the merged profile; then the
+# plain -opt build and the PGO build run on the measured input. Linking the instrumented build
+# with `clang -fprofile-generate` brings in the profile runtime of LLVM, which writes the
+# .profraw file when the program exits. Both builds take -opt, which decides the control flow the
+# profile is collected on and applied to.
+#
+# usage: sh scripts/benchmark-pgo.sh <program> <training input file> [measured input file]
+
+winzigc="./bazel-bin/winzigc/main/cmd"
+runtime="./bazel-bin/winzigc/runtime/libwz_runtime.a"
+program=$1
+training_input=$2
+measured_input=${3:-$2}
+out_dir="$(mktemp -d)"
+export GLOG_logtostderr=1
+
+if [ -z "$program" ] || [ ! -f "$training_input" ] || [ ! -f "$measured_input" ]; then
+    echo "usage: sh scripts/benchmark-pgo.sh <program> <training input file> [measured input file]"
+    exit 1
+fi
+
+$winzigc -opt -fprofile-generate="$out_dir/program.profraw" -c -o "$out_dir/instrumented.o" \
+    "$program" || exit 1
+clang -fprofile-generate "$out_dir/instrumented.o" "$runtime" -o "$out_dir/instrumented" || exit 1
+"$out_dir/instrumented" <"$training_input" >/dev/null
+llvm-profdata merge -o "$out_dir/program.profdata" "$out_dir/program.profraw" || exit 1
+
+$winzigc -opt -c -o "$out_dir/plain.o" "$program" || exit 1
+clang "$out_dir/plain.o" "$runtime" -o "$out_dir/plain" || exit 1
+$winzigc -opt -fprofile-use="$out_dir/program.profdata" -c -o "$out_dir/pgo.o" "$program" ||
+    exit 1
+clang "$out_dir/pgo.o" "$runtime" -o "$out_dir/pgo" || exit 1
+# a profile that applied leaves its entry counts on the functions
+$winzigc -opt -fprofile-use="$out_dir/program.profdata" -emit-bc -o "$out_dir/pgo.bc" \
+    "$program" 2>/dev/null || exit 1
+if ! llvm-dis "$out_dir/pgo.bc" -o - | grep -q "function_entry_count"; then
+    echo "the profile was not applied"
+    rm -rf "$out_dir"
+    exit 1
+fi
+
+now_ns() {
+    date +%s%N
+}
+
+# prints the time in milliseconds, the outputs of both builds must agree
+measure() {
+    local start
+    start=$(now_ns)
+    "$1" <"$measured_input" >"$1.out"
+    echo $((($(now_ns) - start) / 1000000))
+}
+
+printf "%-8s %10s\n" "build" "time(ms)"
+printf "%-8s %10s\n" "-opt" "$(measure "$out_dir/plain")"
+printf "%-8s %10s\n" "pgo" "$(measure "$out_dir/pgo")"
+cmp -s "$out_dir/plain.out" "$out_dir/pgo.out" || echo "the outputs differ"
+
+rm -rf "$out_dir"
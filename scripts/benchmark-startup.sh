@@ -0,0 +1,76 @@
+#!/bin/bash
+
+# Compares the launch time of the example programs linked three ways: dynamically against libc
+# with libwz_runtime.a, statically against libc, and freestanding with
+# libwz_runtime_freestanding.a. Each executable is spawned repeatedly by a small C launcher with
+# stdin and stdout on /dev/null, so the shell's own fork cost is not measured. Programs that wait
+# for input exit at the end of the empty input like any other.
+#
+# usage: sh scripts/benchmark-startup.sh [number of launches]
+
+winzigc="./bazel-bin/winzigc/main/cmd"
+runtime="./bazel-bin/winzigc/runtime/libwz_runtime.a"
+freestanding_runtime="./bazel-bin/winzigc/runtime/libwz_runtime_freestanding.a"
+launches=${1:-2000}
+out_dir="$(mktemp -d)"
+export GLOG_logtostderr=1
+
+cat >"$out_dir/launch.c" <<'EOF'
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+extern char** environ;
+
+int main(int argc, char** argv) {
+  int launches = atoi(argv[2]);
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+  char* args[] = {argv[1], NULL};
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < launches; i++) {
+    pid_t pid;
+    if (posix_spawn(&pid, argv[1], &actions, NULL, args, environ) != 0) {
+      return 1;
+    }
+    waitpid(pid, NULL, 0);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+  printf("%.1f\n", elapsed_ns / launches / 1000);
+  return 0;
+}
+EOF
+clang -O2 "$out_dir/launch.c" -o "$out_dir/launch" || exit 1
+
+echo "microseconds per launch, $launches launches"
+printf "%-12s %10s %10s %14s %10s %10s\n" "program" "dynamic" "static" "freestanding" \
+    "size(B)" "fs-size(B)"
+
+for winzigc_prog_path in "$(pwd)"/example-programs/winzig_[0-9][0-9]; do
+    winzig_prog_name=$(basename "$winzigc_prog_path")
+    prog="$out_dir/$winzig_prog_name"
+    $winzigc -opt -c -o "$prog.o" "$winzigc_prog_path" || exit 1
+    clang "$prog.o" "$runtime" -o "$prog.dynamic" || exit 1
+    clang -static "$prog.o" "$runtime" -o "$prog.static" || exit 1
+    clang -static -nostdlib "$prog.o" "$freestanding_runtime" -o "$prog.freestanding" || exit 1
+
+    # programs that never finish on empty input are skipped
+    if ! timeout 1 "$prog.dynamic" </dev/null >/dev/null 2>&1; then
+        printf "%-12s %10s\n" "$winzig_prog_name" "timeout"
+        continue
+    fi
+    printf "%-12s %10s %10s %14s %10d %10d\n" "$winzig_prog_name" \
+        "$("$out_dir/launch" "$prog.dynamic" "$launches")" \
+        "$("$out_dir/launch" "$prog.static" "$launches")" \
+        "$("$out_dir/launch" "$prog.freestanding" "$launches")" \
+        "$(wc -c <"$prog.dynamic")" "$(wc -c <"$prog.freestanding")"
+done
+
+rm -rf "$out_dir"
@@ -10,13 +10,16 @@ check_exit_status() {
 winzigc_prog_name=$1
 dbg_flag=false
 opt_flag=false
+freestanding_flag=false
 
-# Check for -dbg and -opt flags
+# Check for -dbg, -opt and -freestanding flags
 for arg in "$@"; do
     if [ "$arg" = "-dbg" ]; then
         dbg_flag=true
     elif [ "$arg" = "-opt" ]; then
         opt_flag=true
+    elif [ "$arg" = "-freestanding" ]; then
+        freestanding_flag=true
     fi
 done
 
@@ -29,25 +32,36 @@ winzigc_prog_path="$(pwd)/example-programs/$winzigc_prog_name"
 
 export GLOG_logtostderr=1
 
+# -opt builds are optimized and emitted as an object file by winzigc, the others are emitted as
+# bitcode and optimized by clang at -O3; debug builds are not optimized by clang
 cmd="./bazel-bin/winzigc/main/cmd"
+clang_flags=""
+if [ "$opt_flag" = true ]; then
+    winzigc_output="$winzigc_prog_path".o
+    cmd+=" -opt -c"
+else
+    winzigc_output="$winzigc_prog_path".bc
+    cmd+=" -emit-bc"
+    clang_flags+=" -O3"
+fi
 if [ "$dbg_flag" = true ]; then
     cmd+=" -dbg"
+    clang_flags=" -g"
 fi
-if [ "$opt_flag" = true ]; then
-    cmd+=" -opt"
-fi
-cmd+=" \"$winzigc_prog_path\""
+cmd+=" -o \"$winzigc_output\" \"$winzigc_prog_path\""
 eval "$cmd"
 
-check_exit_status "Failed to generate llvm bitcode!"
+check_exit_status "Failed to generate the object file or bitcode!"
 
-if [ "$dbg_flag" = true ]; then
-    clang -x ir "$winzigc_prog_path".ll -o "$winzigc_prog_path"_binary -g
+if [ "$freestanding_flag" = true ]; then
+    clang $clang_flags -static -nostdlib "$winzigc_output" \
+        ./bazel-bin/winzigc/runtime/libwz_runtime_freestanding.a -o "$winzigc_prog_path"_binary
 else
-    clang -O3 "$winzigc_prog_path".ll -o "$winzigc_prog_path"_binary
+    clang $clang_flags "$winzigc_output" ./bazel-bin/winzigc/runtime/libwz_runtime.a \
+        -o "$winzigc_prog_path"_binary
 fi
 
-check_exit_status "Failed to generate binary using generatd llvm bitcode!"
+check_exit_status "Failed to link binary using generated object file!"
 
 echo "Program compiled successfully!"
 echo "Executing the" "$winzigc_prog_name"_binary:
@@ -55,5 +69,5 @@ echo "Executing the" "$winzigc_prog_name"_binary:
 "$winzigc_prog_path"_binary
 
 if [ "$dbg_flag" = false ]; then
-    rm "$winzigc_prog_path".ll "$winzigc_prog_path"_binary
+    rm "$winzigc_output" "$winzigc_prog_path"_binary
 fi
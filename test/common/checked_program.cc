@@ -0,0 +1,20 @@
+#include "test/common/checked_program.h"
+
+#include "winzigc/visitor/semantic/semantic_visitor.h"
+#include "winzigc/frontend/parser/parser.h"
+#include "winzigc/frontend/lexer/lexer.h"
+
+#include "gtest/gtest.h"
+
+namespace WinZigC {
+
+std::unique_ptr<Frontend::AST::Program> parse_checked_program(const std::string& source) {
+  Lexer lexer(source);
+  Frontend::Parser parser(lexer.get_tokens());
+  auto program = parser.parse();
+  Visitor::SemanticVisitor semantic_visitor;
+  EXPECT_EQ(semantic_visitor.check(*program, "").size(), 0);
+  return program;
+}
+
+} // namespace WinZigC
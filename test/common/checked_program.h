@@ -0,0 +1,13 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "winzigc/frontend/ast/program.h"
+
+namespace WinZigC {
+
+// Lexes, parses and checks the program, expecting the semantic analysis to find no error.
+std::unique_ptr<Frontend::AST::Program> parse_checked_program(const std::string& source);
+
+} // namespace WinZigC
@@ -230,6 +230,14 @@ TEST(LexerSingleTokenTest, LexOfToken) {
   ASSERT_EQ(tokens->at(0).lexeme, "of");
 }
 
+TEST(LexerSingleTokenTest, LexArrayToken) {
+  Lexer lexer("array");
+  auto tokens = lexer.get_tokens();
+  ASSERT_EQ(tokens->size(), 1);
+  ASSERT_EQ(tokens->at(0).kind, Kind::kArray);
+  ASSERT_EQ(tokens->at(0).lexeme, "array");
+}
+
 TEST(LexerSingleTokenTest, LexCaseRangeToken) {
   Lexer lexer("..");
   auto tokens = lexer.get_tokens();
@@ -470,6 +478,22 @@ TEST(LexerSingleTokenTest, LexCloseBracketToken) {
   ASSERT_EQ(tokens->at(0).lexeme, ")");
 }
 
+TEST(LexerSingleTokenTest, LexOpenSquareToken) {
+  Lexer lexer("[");
+  auto tokens = lexer.get_tokens();
+  ASSERT_EQ(tokens->size(), 1);
+  ASSERT_EQ(tokens->at(0).kind, Kind::kOpenSquare);
+  ASSERT_EQ(tokens->at(0).lexeme, "[");
+}
+
+TEST(LexerSingleTokenTest, LexCloseSquareToken) {
+  Lexer lexer("]");
+  auto tokens = lexer.get_tokens();
+  ASSERT_EQ(tokens->size(), 1);
+  ASSERT_EQ(tokens->at(0).kind, Kind::kCloseSquare);
+  ASSERT_EQ(tokens->at(0).lexeme, "]");
+}
+
 TEST(LexerSingleTokenTest, LexPlusToken) {
   Lexer lexer("+");
   auto tokens = lexer.get_tokens();
@@ -5,8 +5,13 @@
 #include <string>
 #include <array>
 #include <map>
-#include <thread>
 #include <chrono>
+#include <functional>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "winzigc/main/cmd.h"
 
@@ -46,29 +51,123 @@ static const std::vector<ProgramTest> program_test = {
     {"71\n100\n546\n", "1\n0\n2\n"},
     {"", "13 -2 \n-2 -2 \n0\n13 -1 \n"},
     {"128\n96\n", "32\n"},
+    {"7\n50000\n123456\n-5\n", "1\n2\n3\n-1\n1 2 3 0 \n"},
+    {"90\n", "n=\n1 ^2=1 \n1\n#\n2 ^2=4 \n4\n#\n3 ^2=9 \n9\n#\n"
+              "#90 %\n>1 \n#50 %\n>0 \n#10 %\n>0 \nend\n"},
+    {"0\n", "1 4 \n7 6 \n0\n"},
+    {"5\n3\n-1\n4\n1\n5\n", "-1\n1\n3\n4\n5\n25\nolleh\n"},
+    {"6\n95\n100\n40\n55\n12\n79\n", "1\n0\n2\n1\n2\n1 2 0 \n*\n"},
+    {"1000\n", "500500\n1 0 \n1\n"},
+    {"12\n", "6765\n12 25 \nPC\n144 12 5 \nC\n"},
+    {"500\n600\n1000005\n1000000\n1500000\n0\n", "1\n1\n3\n1\n4\n0\n1 1 3 0 \n"},
+    {"4\n", "4\n0\nn\n3\n1\n"},
 };
 
-std::string exec_binary(const char* cmd) {
-  std::array<char, 128> buffer;
-  std::string result;
-  std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd, "r"), pclose);
-  if (!pipe) {
-    throw std::runtime_error("popen() failed!");
+// Calls `run` in a child process with the given input on its stdin and returns everything written
+// to its stdout within the time limit. The child exits with the result of `run`.
+std::string exec_child(const std::function<int()>& run, const std::string& input,
+                       std::chrono::milliseconds time_limit) {
+  int stdin_pipe[2];
+  int stdout_pipe[2];
+  if (pipe(stdin_pipe) != 0 || pipe(stdout_pipe) != 0) {
+    throw std::runtime_error("pipe() failed!");
   }
-  while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-    result += buffer.data();
+  std::fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0) {
+    throw std::runtime_error("fork() failed!");
   }
+  if (pid == 0) {
+    dup2(stdin_pipe[0], STDIN_FILENO);
+    dup2(stdout_pipe[1], STDOUT_FILENO);
+    close(stdin_pipe[0]);
+    close(stdin_pipe[1]);
+    close(stdout_pipe[0]);
+    close(stdout_pipe[1]);
+    int status = run();
+    std::fflush(stdout);
+    _exit(status);
+  }
+  close(stdin_pipe[0]);
+  close(stdout_pipe[1]);
+  std::string stdin_content = input + "\n";
+  ssize_t written = write(stdin_pipe[1], stdin_content.data(), stdin_content.size());
+  EXPECT_EQ(written, static_cast<ssize_t>(stdin_content.size()));
+  close(stdin_pipe[1]);
+
+  std::string result;
+  std::array<char, 128> buffer;
+  auto deadline = std::chrono::steady_clock::now() + time_limit;
+  while (true) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      break;
+    }
+    pollfd poll_fd = {stdout_pipe[0], POLLIN, 0};
+    if (poll(&poll_fd, 1, remaining.count()) <= 0) {
+      break;
+    }
+    ssize_t count = read(stdout_pipe[0], buffer.data(), buffer.size());
+    if (count <= 0) {
+      break;
+    }
+    result.append(buffer.data(), count);
+  }
+  close(stdout_pipe[0]);
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
   return result;
 }
 
-TEST(IntegrationTest, GenerateBitcodeAndBinary) {
-  for (int i = 1; i <= 26; ++i) {
+// Runs the compiler in a child process, see exec_child.
+std::string exec_winzigc(std::vector<std::string> args, const std::string& input,
+                         std::chrono::milliseconds time_limit = std::chrono::milliseconds(1000)) {
+  return exec_child(
+      [&args] {
+        std::vector<char*> argv;
+        for (auto& arg : args) {
+          argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+        return main(argv.size() - 1, argv.data());
+      },
+      input, time_limit);
+}
+
+// Runs a compiled program in a child process, see exec_child.
+std::string exec_binary(const std::string& binary_path, const std::string& input) {
+  return exec_child(
+      [&binary_path] {
+        execl(binary_path.c_str(), binary_path.c_str(), nullptr);
+        return 127;
+      },
+      input, std::chrono::milliseconds(1000));
+}
+
+// A way of building the programs: the flags passed to the compiler, the extension of the file it
+// writes, and the runtime library and flags clang links that file with.
+struct Executable {
+  std::string name;
+  std::vector<std::string> compile_flags;
+  std::string output_extension;
+  std::string runtime_library;
+  std::string link_flags;
+};
+
+class ExecutableTest : public testing::TestWithParam<Executable> {};
+
+TEST_P(ExecutableTest, GenerateAndRunBinary) {
+  for (size_t i = 1; i <= program_test.size(); ++i) {
     std::ostringstream oss;
     oss << std::setw(2) << std::setfill('0') << i;
     std::filesystem::path current_path = std::filesystem::current_path();
     std::filesystem::path program_path = current_path / ("example-programs/winzig_" + oss.str());
 
-    std::vector<std::string> args = {"winzigc-compiler", "-opt", program_path.string()};
+    std::string output_path = program_path.string() + GetParam().output_extension;
+    std::vector<std::string> args = {"winzigc-compiler"};
+    args.insert(args.end(), GetParam().compile_flags.begin(), GetParam().compile_flags.end());
+    args.insert(args.end(), {"-o", output_path, program_path.string()});
     std::vector<char*> argv;
     for (const auto& arg : args) {
       argv.push_back(const_cast<char*>(arg.data()));
@@ -79,22 +178,99 @@ TEST(IntegrationTest, GenerateBitcodeAndBinary) {
     EXPECT_EQ(winzigc_result, 0);
 
     std::string winzigc_binary_path = program_path.string() + "_binary";
-    std::string command = "clang -O3 " + program_path.string() + ".ll -o " + winzigc_binary_path;
+    std::string runtime_path =
+        (current_path / "winzigc/runtime" / GetParam().runtime_library).string();
+    std::string command = "clang " + GetParam().link_flags + " " + output_path + " " +
+                          runtime_path + " -o " + winzigc_binary_path;
     int clang_result = std::system(command.c_str());
     EXPECT_EQ(clang_result, 0);
 
-    std::string exec_command =
-        "echo \"" + program_test[i - 1].input + "\" | " + winzigc_binary_path;
-    std::string kill_command = "sleep 1 && pkill -f " + winzigc_binary_path;
-    std::thread command_thread([kill_command] { std::system(kill_command.c_str()); });
-    std::string output = exec_binary(exec_command.c_str());
-    command_thread.join();
+    std::string output = exec_binary(winzigc_binary_path, program_test[i - 1].input);
     EXPECT_TRUE(output.compare(0, program_test[i - 1].output.size(), program_test[i - 1].output) ==
-                0);
+                0)
+        << "winzig_" << oss.str() << " printed: " << output;
 
-    std::filesystem::remove(program_path.string() + ".ll");
+    std::filesystem::remove(output_path);
     std::filesystem::remove(winzigc_binary_path);
   }
 }
 
+INSTANTIATE_TEST_SUITE_P(
+    IntegrationTest, ExecutableTest,
+    testing::Values(
+        Executable{"TextualIr", {"-opt"}, ".ll", "libwz_runtime.a", "-O3"},
+        Executable{"Bitcode", {"-opt", "-emit-bc"}, ".bc", "libwz_runtime.a", "-O3"},
+        // the link step reads the module summary and runs the ThinLTO backend
+        Executable{"ThinLto", {"-opt", "-thinlto"}, ".bc", "libwz_runtime.a",
+                   "-O3 -flto=thin -fuse-ld=lld"},
+        Executable{"ObjectFile", {"-opt", "-c"}, ".o", "libwz_runtime.a", ""},
+        // the freestanding runtime brings its own _start
+        Executable{"Freestanding", {"-opt", "-c"}, ".o", "libwz_runtime_freestanding.a",
+                   "-static -nostdlib"}),
+    [](const testing::TestParamInfo<Executable>& info) { return info.param.name; });
+
+// A way of running the programs in-process: the flags passed to the compiler before the program.
+struct Backend {
+  std::string name;
+  std::vector<std::string> flags;
+};
+
+class BackendTest : public testing::TestWithParam<Backend> {};
+
+TEST_P(BackendTest, RunExamplePrograms) {
+  for (size_t i = 1; i <= program_test.size(); ++i) {
+    std::ostringstream oss;
+    oss << std::setw(2) << std::setfill('0') << i;
+    std::filesystem::path current_path = std::filesystem::current_path();
+    std::filesystem::path program_path = current_path / ("example-programs/winzig_" + oss.str());
+
+    std::vector<std::string> args = {"winzigc-compiler"};
+    args.insert(args.end(), GetParam().flags.begin(), GetParam().flags.end());
+    args.push_back(program_path.string());
+    std::string output = exec_winzigc(args, program_test[i - 1].input);
+    EXPECT_TRUE(output.compare(0, program_test[i - 1].output.size(), program_test[i - 1].output) ==
+                0)
+        << "winzig_" << oss.str() << " printed: " << output;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    IntegrationTest, BackendTest,
+    testing::Values(Backend{"OrcJit", {"-opt", "-run"}}, Backend{"Interpreter", {"-interpret"}},
+                    Backend{"BytecodeVm", {"-vm"}},
+                    // a low threshold makes the programs switch tiers in the middle of loops and
+                    // recursions
+                    Backend{"Tiered", {"-tiered", "-tier-threshold", "10"}},
+                    Backend{"Memoized", {"-opt", "-memoize", "-run"}},
+                    Backend{"ExplicitStack", {"-opt", "-explicit-stack", "-run"}}),
+    [](const testing::TestParamInfo<Backend>& info) { return info.param.name; });
+
+TEST(IntegrationTest, RunDeepTailRecursion) {
+  // a million calls in tail position deep, they have to run in constant stack
+  std::filesystem::path program_path =
+      std::filesystem::current_path() / "example-programs/winzig_32";
+  const std::string expected_output = "1784293664\n1 0 \n1\n";
+  const std::vector<std::vector<std::string>> flag_sets = {
+      {"-opt", "-run"}, {"-opt", "-memoize", "-run"}, {"-opt", "-explicit-stack", "-run"}};
+  for (const auto& flags : flag_sets) {
+    std::vector<std::string> args = {"winzigc-compiler"};
+    args.insert(args.end(), flags.begin(), flags.end());
+    args.push_back(program_path.string());
+    std::string output = exec_winzigc(args, "1000000", std::chrono::milliseconds(5000));
+    EXPECT_EQ(output, expected_output) << flags[1] << " printed: " << output;
+  }
+}
+
+TEST(IntegrationTest, RunWithoutShortCircuit) {
+  // every call in the conditions of winzig_29 is made when both operands are always evaluated
+  std::filesystem::path program_path =
+      std::filesystem::current_path() / "example-programs/winzig_29";
+  const std::string expected_output = "1 10 \n7 10 \n1\n";
+  for (const std::string& backend : {"-run", "-interpret", "-vm"}) {
+    std::string output = exec_winzigc(
+        {"winzigc-compiler", "-no-short-circuit", backend, program_path.string()}, "5");
+    EXPECT_EQ(output, expected_output) << backend << " printed: " << output;
+  }
+}
+
 } // namespace WinZigC
@@ -0,0 +1,184 @@
+#include <algorithm>
+
+#include "winzigc/visitor/bytecode/bytecode_compiler_visitor.h"
+#include "winzigc/visitor/bytecode/virtual_machine.h"
+#include "test/common/checked_program.h"
+
+#include "gtest/gtest.h"
+
+namespace WinZigC {
+
+using namespace WinZigC::Visitor;
+
+Bytecode::Program compile_program(const std::string& source) {
+  auto program = parse_checked_program(source);
+  BytecodeCompilerVisitor bytecode_compiler;
+  return bytecode_compiler.compile(*program);
+}
+
+std::string run_program(const Bytecode::Program& program) {
+  testing::internal::CaptureStdout();
+  Bytecode::VirtualMachine virtual_machine;
+  EXPECT_EQ(virtual_machine.run(program), 0);
+  return testing::internal::GetCapturedStdout();
+}
+
+size_t count_opcode(const Bytecode::Program& program, Bytecode::Opcode opcode) {
+  return std::count_if(program.code.begin(), program.code.end(),
+                       [opcode](const Bytecode::Instruction& instruction) {
+                         return instruction.opcode == opcode;
+                       });
+}
+
+TEST(BytecodeTest, TestLoopConditionIsFusedBranch) {
+  auto program = compile_program(R"(program winzigc_test:
+  var i: integer;
+  begin
+    i := 0;
+    while i < 5 do i := i + 1;
+    output(i);
+  end winzigc_test.)");
+
+  ASSERT_EQ(count_opcode(program, Bytecode::Opcode::kLt), 0);
+  ASSERT_EQ(count_opcode(program, Bytecode::Opcode::kJumpIfLt), 1);
+  ASSERT_EQ(run_program(program), "5\n");
+}
+
+TEST(BytecodeTest, TestDenseCaseTable) {
+  auto program = compile_program(R"(program winzigc_test:
+  var i: integer;
+  begin
+    for (i := 0; i <= 4; i := i + 1)
+      case i of
+        1: output(10);
+        2..3: output(20);
+      end;
+  end winzigc_test.)");
+
+  ASSERT_EQ(program.case_tables.size(), 1);
+  ASSERT_EQ(program.case_tables[0].dense_targets.size(), 3);
+  ASSERT_EQ(run_program(program), "10\n20\n20\n");
+}
+
+TEST(BytecodeTest, TestWideCaseRangesAreSearched) {
+  auto program = compile_program(R"(program winzigc_test:
+  var i: integer;
+  begin
+    i := 999999;
+    case i of
+      1..1000000: output(1);
+      2000000: output(2);
+    end;
+    i := 2000000;
+    case i of
+      1..1000000: output(1);
+      2000000: output(2);
+    end;
+  end winzigc_test.)");
+
+  ASSERT_EQ(program.case_tables.size(), 2);
+  ASSERT_TRUE(program.case_tables[0].dense_targets.empty());
+  ASSERT_EQ(program.case_tables[0].ranges.size(), 2);
+  ASSERT_EQ(run_program(program), "1\n2\n");
+}
+
+TEST(BytecodeTest, TestOverlappingWideCaseRangesFirstArmWins) {
+  auto program = compile_program(R"(program winzigc_test:
+  var i: integer;
+  begin
+    i := 600;
+    case i of
+      1..1000000: output(1);
+      500..500: output(2);
+    end;
+    i := 600000;
+    case i of
+      1..1000000: output(3);
+      500000..2000000: output(4);
+    end;
+    i := 1500000;
+    case i of
+      1..1000000: output(3);
+      500000..2000000: output(4);
+    end;
+  end winzigc_test.)");
+
+  ASSERT_TRUE(program.case_tables[0].dense_targets.empty());
+  ASSERT_EQ(program.case_tables[0].ranges.size(), 1);
+  ASSERT_EQ(program.case_tables[1].ranges.size(), 2);
+  ASSERT_EQ(program.case_tables[1].ranges[1].low, 1000001);
+  ASSERT_EQ(run_program(program), "1\n3\n4\n");
+}
+
+TEST(BytecodeTest, TestCharacterCaseRange) {
+  auto program = compile_program(R"(program winzigc_test:
+  var c: char;
+  begin
+    c := 'q';
+    case c of
+      'a'..'z': output('l');
+      '0'..'9': output('d');
+    end;
+  end winzigc_test.)");
+
+  ASSERT_EQ(run_program(program), "l\n");
+}
+
+TEST(BytecodeTest, TestRecursiveCall) {
+  auto program = compile_program(R"(program winzigc_test:
+  function fib(n: integer): integer;
+  begin
+    if n < 2 then return (n);
+    return (fib(n - 1) + fib(n - 2));
+  end fib;
+  begin
+    output(fib(20));
+  end winzigc_test.)");
+
+  ASSERT_EQ(run_program(program), "6765\n");
+}
+
+TEST(BytecodeTest, TestIndexOutOfBoundsIsChecked) {
+  auto program = compile_program(R"(program winzigc_test:
+  var a: array [1..3] of integer;
+      g, i: integer;
+  function Local(i: integer): integer;
+  var b: array [-1..1] of integer;
+      x: integer;
+  begin
+    b[i] := 5;
+    return (b[i] + x);
+  end Local;
+  begin
+    a[1] := 1;
+    g := 7;
+    i := 4;
+    a[i] := 9;
+    output(a[i], g, Local(2), Local(1));
+    i := 0;
+    output(a[i], a[i + 1]);
+  end winzigc_test.)");
+
+  // constant indices are checked by the semantic analysis
+  ASSERT_EQ(count_opcode(program, Bytecode::Opcode::kCheckIndex), 6);
+  ASSERT_EQ(run_program(program), "0 7 0 5 \n0 1 \n");
+}
+
+TEST(BytecodeTest, TestDivisionByZeroYieldsZero) {
+  auto program = compile_program(R"(program winzigc_test:
+  var n, z: integer;
+  begin
+    n := 7;
+    z := 0;
+    output(n / z);
+    output(n mod z);
+    n := -2147483647 - 1;
+    z := -1;
+    output(n / z);
+    output(n / 2);
+  end winzigc_test.)");
+
+  ASSERT_EQ(run_program(program), "0\n0\n0\n-1073741824\n");
+}
+
+} // namespace WinZigC
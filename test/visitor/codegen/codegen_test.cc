@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+#include "test/common/checked_program.h"
+
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+
+#include "gtest/gtest.h"
+
+namespace WinZigC {
+
+using namespace WinZigC::Visitor;
+
+// Generates the optimized module of the program and reads it back from the textual IR.
+std::unique_ptr<llvm::Module> compile_program(const std::string& source,
+                                              llvm::LLVMContext& context) {
+  auto program = parse_checked_program(source);
+  CodeGenVisitor codegen_visitor(/*optimize=*/true);
+  codegen_visitor.codegen(*program, "winzigc_test");
+  std::string ir_path = testing::TempDir() + "codegen_test.ll";
+  EXPECT_TRUE(codegen_visitor.print_llvm_ir(ir_path));
+  llvm::SMDiagnostic error;
+  std::unique_ptr<llvm::Module> module = llvm::parseIRFile(ir_path, error, context);
+  EXPECT_TRUE(module) << error.getMessage().str();
+  return module;
+}
+
+template <typename Instruction> size_t count_instructions(const llvm::Function& function) {
+  size_t count = 0;
+  for (const auto& block : function) {
+    count += std::count_if(block.begin(), block.end(), [](const llvm::Instruction& instruction) {
+      return llvm::isa<Instruction>(instruction);
+    });
+  }
+  return count;
+}
+
+size_t count_calls(const llvm::Function& caller, const std::string& callee_name) {
+  size_t count = 0;
+  for (const auto& block : caller) {
+    for (const auto& instruction : block) {
+      const auto* call = llvm::dyn_cast<llvm::CallInst>(&instruction);
+      if (call && call->getCalledFunction() &&
+          call->getCalledFunction()->getName() == callee_name) {
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+// The instructions of the function using the global, in program order.
+std::vector<const llvm::Instruction*> find_global_uses(const llvm::Function& function,
+                                                       const std::string& global_name) {
+  std::vector<const llvm::Instruction*> uses;
+  for (const auto& block : function) {
+    for (const auto& instruction : block) {
+      for (const llvm::Value* operand : instruction.operands()) {
+        const auto* global = llvm::dyn_cast<llvm::GlobalVariable>(operand);
+        if (global && global->getName() == global_name) {
+          uses.push_back(&instruction);
+        }
+      }
+    }
+  }
+  return uses;
+}
+
+// The conditional branches of single block loops, back to their own block.
+std::vector<const llvm::BranchInst*> find_latches(const llvm::Function& function) {
+  std::vector<const llvm::BranchInst*> latches;
+  for (const auto& block : function) {
+    const auto* branch = llvm::dyn_cast<llvm::BranchInst>(block.getTerminator());
+    if (branch && branch->isConditional() &&
+        (branch->getSuccessor(0) == &block || branch->getSuccessor(1) == &block)) {
+      latches.push_back(branch);
+    }
+  }
+  return latches;
+}
+
+// The main body reads n and adds up `Show(<argument>)` over the loop, Show prints its argument.
+// Show is called once more after the loop, LLVM leaves loops calling a function with a single
+// call site to the inliner instead of unrolling them.
+std::string loop_program(const std::string& loop, const std::string& argument) {
+  return R"(program loops:
+  var n, s, i: integer;
+
+  function Show(x: integer): integer;
+  begin
+    output(x);
+    return (x)
+  end Show;
+
+  begin
+    read(n);
+    )" + loop + " s := s + Show(" +
+         argument + R"();
+    output(Show(s))
+  end loops.)";
+}
+
+// `Work(k, x)` bumps x `calls_per_arm` times in each of the arms 1..`arms` of a case on k, and
+// the main body prints `Work(k, n)` for each of `ks`.
+std::string work_program(int arms, int calls_per_arm, const std::vector<int>& ks) {
+  std::ostringstream source;
+  source << R"(program work:
+  var n, g: integer;
+
+  function Bump(x: integer): integer;
+  begin
+    g := g + x;
+    return (g)
+  end Bump;
+
+  function Work(k, x: integer): integer;
+  begin
+    case k of
+)";
+  for (int arm = 1; arm <= arms; arm++) {
+    source << "      " << arm << ": begin\n";
+    for (int call = 0; call < calls_per_arm; call++) {
+      source << "        x := Bump(x);\n";
+    }
+    source << "      end;\n";
+  }
+  source << R"(    end;
+    return (x)
+  end Work;
+
+  begin
+    read(n);
+)";
+  for (int k : ks) {
+    source << "    output(Work(" << k << ", n));\n";
+  }
+  source << "  end work.";
+  return source.str();
+}
+
+TEST(CodeGenTest, TestConstantEnumArgumentSpecializesCallee) {
+  llvm::LLVMContext context;
+  auto module = compile_program(R"(program winzigc_test:
+  type shape = (square, circle);
+  var n: integer;
+
+  function Area(s: shape; x: integer): integer;
+  begin
+    case s of
+      square: if x > 0 then output(x);
+      circle: output(3);
+    end;
+    if s = square then return (x * x);
+    return (3 * x * x)
+  end Area;
+
+  begin
+    read(n);
+    output(Area(square, n), Area(square, n + 1));
+  end winzigc_test.)",
+                                context);
+
+  // both calls share the copy, and the original is left without callers
+  EXPECT_EQ(module->getFunction("Area"), nullptr);
+  llvm::Function* specialized = module->getFunction("Area.specialized");
+  ASSERT_NE(specialized, nullptr);
+  EXPECT_EQ(specialized->arg_size(), 1);
+  EXPECT_EQ(count_instructions<llvm::SwitchInst>(*specialized), 0);
+  EXPECT_EQ(count_calls(*module->getFunction("main"), "Area.specialized"), 2);
+}
+
+TEST(CodeGenTest, TestSpecializationBudget) {
+  std::vector<int> ks;
+  for (int k = 1; k <= 20; k++) {
+    ks.push_back(k);
+  }
+  llvm::LLVMContext context;
+  auto module = compile_program(work_program(4, 50, ks), context);
+
+  // every copy costs the size of the original, the calls past the budget keep calling it
+  llvm::Function* work = module->getFunction("Work");
+  ASSERT_NE(work, nullptr);
+  size_t size = work->getInstructionCount();
+  ASSERT_LE(size, CodeGenVisitor::kMaxSpecializedSize);
+  size_t specialized_calls = CodeGenVisitor::kSpecializationBudget / size;
+  ASSERT_LT(specialized_calls, ks.size());
+  EXPECT_EQ(count_calls(*module->getFunction("main"), "Work"), ks.size() - specialized_calls);
+  EXPECT_NE(module->getFunction("Work.specialized"), nullptr);
+}
+
+TEST(CodeGenTest, TestLargeFunctionIsNotSpecialized) {
+  llvm::LLVMContext context;
+  auto module = compile_program(work_program(4, 80, {1}), context);
+
+  llvm::Function* work = module->getFunction("Work");
+  ASSERT_NE(work, nullptr);
+  ASSERT_GT(work->getInstructionCount(), CodeGenVisitor::kMaxSpecializedSize);
+  EXPECT_EQ(count_calls(*module->getFunction("main"), "Work"), 1);
+  EXPECT_EQ(module->getFunction("Work.specialized"), nullptr);
+}
+
+TEST(CodeGenTest, TestMainKeepsGlobalsInRegisters) {
+  llvm::LLVMContext context;
+  auto module = compile_program(R"(program winzigc_test:
+  var n, a, b: integer;
+
+  function Bump(x: integer): integer;
+  begin
+    a := a + x;
+    return (a)
+  end Bump;
+
+  begin
+    read(n);
+    a := n;
+    b := n * 2;
+    output(Bump(b));
+    output(a + b);
+  end winzigc_test.)",
+                                context);
+
+  llvm::Function* main_function = module->getFunction("main");
+  // no function touches n and b
+  EXPECT_TRUE(find_global_uses(*main_function, "n").empty());
+  EXPECT_TRUE(find_global_uses(*main_function, "b").empty());
+  // a is written back for Bump and loaded again for the output after the call
+  auto uses = find_global_uses(*main_function, "a");
+  ASSERT_EQ(uses.size(), 2);
+  ASSERT_TRUE(llvm::isa<llvm::StoreInst>(uses[0]));
+  ASSERT_TRUE(llvm::isa<llvm::LoadInst>(uses[1]));
+  ASSERT_EQ(uses[0]->getParent(), uses[1]->getParent());
+  std::vector<const llvm::Instruction*> between;
+  for (const llvm::Instruction* instruction = uses[0]->getNextNode(); instruction != uses[1];
+       instruction = instruction->getNextNode()) {
+    between.push_back(instruction);
+  }
+  EXPECT_TRUE(std::any_of(between.begin(), between.end(), [](const llvm::Instruction* instruction) {
+    const auto* call = llvm::dyn_cast<llvm::CallInst>(instruction);
+    return call && call->getCalledFunction() && call->getCalledFunction()->getName() == "Bump";
+  }));
+}
+
+TEST(CodeGenTest, TestLoopIsRotated) {
+  llvm::LLVMContext context;
+  auto module =
+      compile_program(loop_program("for (i := 1; i <= n; i := i + 1)", "i"), context);
+
+  // the guard skips the loop, the test at the end of the body runs it again
+  auto latches = find_latches(*module->getFunction("main"));
+  ASSERT_EQ(latches.size(), 1);
+  const llvm::BasicBlock* body = latches[0]->getParent();
+  ASSERT_EQ(llvm::pred_size(body), 2);
+  for (const llvm::BasicBlock* predecessor : llvm::predecessors(body)) {
+    if (predecessor != body) {
+      const auto* guard_branch = llvm::dyn_cast<llvm::BranchInst>(predecessor->getTerminator());
+      ASSERT_NE(guard_branch, nullptr);
+      EXPECT_TRUE(guard_branch->isConditional());
+    }
+  }
+  // the trip count is not known
+  EXPECT_EQ(latches[0]->getMetadata(llvm::LLVMContext::MD_prof), nullptr);
+  EXPECT_EQ(latches[0]->getMetadata(llvm::LLVMContext::MD_loop), nullptr);
+}
+
+TEST(CodeGenTest, TestShortConstantTripCountIsUnrolledFully) {
+  llvm::LLVMContext context;
+  auto module =
+      compile_program(loop_program("for (i := 1; i <= 4; i := i + 1)", "i + n"), context);
+
+  llvm::Function* main_function = module->getFunction("main");
+  EXPECT_TRUE(find_latches(*main_function).empty());
+  EXPECT_EQ(count_calls(*main_function, "Show"), 4 + 1);
+}
+
+TEST(CodeGenTest, TestConstantTripCountWeighsLatch) {
+  llvm::LLVMContext context;
+  // one iteration more than kMaxFullUnrollTripCount
+  auto module =
+      compile_program(loop_program("for (i := 0; i < 17; i := i + 1)", "i * n"), context);
+
+  llvm::Function* main_function = module->getFunction("main");
+  auto latches = find_latches(*main_function);
+  ASSERT_EQ(latches.size(), 1);
+  EXPECT_EQ(count_calls(*main_function, "Show"), 1 + 1);
+  uint64_t taken_weight = 0;
+  uint64_t not_taken_weight = 0;
+  ASSERT_TRUE(latches[0]->extractProfMetadata(taken_weight, not_taken_weight));
+  // 16 times back into the body for every time out of the loop
+  if (latches[0]->getSuccessor(0) != latches[0]->getParent()) {
+    std::swap(taken_weight, not_taken_weight);
+  }
+  EXPECT_EQ(taken_weight, 16);
+  EXPECT_EQ(not_taken_weight, 1);
+}
+
+TEST(CodeGenTest, TestWrappingForLoopHasNoTripCount) {
+  llvm::LLVMContext context;
+  // 2147483650 wraps around to a negative counter, which passes the condition again
+  auto module = compile_program(
+      loop_program("for (i := 2147483600; i <= 2147483645; i := i + 10)", "i - n"), context);
+
+  llvm::Function* main_function = module->getFunction("main");
+  auto latches = find_latches(*main_function);
+  ASSERT_EQ(latches.size(), 1);
+  EXPECT_EQ(count_calls(*main_function, "Show"), 1 + 1);
+  EXPECT_EQ(latches[0]->getMetadata(llvm::LLVMContext::MD_prof), nullptr);
+}
+
+} // namespace WinZigC
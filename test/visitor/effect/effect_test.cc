@@ -0,0 +1,154 @@
+#include "winzigc/visitor/effect/effect_visitor.h"
+#include "test/common/checked_program.h"
+
+#include "gtest/gtest.h"
+
+namespace WinZigC {
+
+using namespace WinZigC::Visitor;
+
+std::map<std::string, FunctionEffects> analyze_program(const std::string& source) {
+  auto program = parse_checked_program(source);
+  EffectVisitor effect_visitor;
+  return effect_visitor.analyze(*program);
+}
+
+TEST(EffectTest, TestLocalsAndEnumLiteralsAreNotGlobals) {
+  auto effects = analyze_program(R"(program effects:
+  type color = (red, green);
+  var g: integer;
+
+  function Square(g: integer): integer;
+  var t: integer;
+  begin
+    t := g * g;
+    Square := t;
+    if red = green then return (0)
+  end Square;
+
+  begin
+    output(Square(3))
+  end effects.)");
+
+  const FunctionEffects& square = effects.at("Square");
+  EXPECT_FALSE(square.accesses_memory());
+  EXPECT_TRUE(square.globals.empty());
+  EXPECT_FALSE(square.recursive);
+  EXPECT_FALSE(square.may_diverge);
+}
+
+TEST(EffectTest, TestEffectsFollowCalls) {
+  auto effects = analyze_program(R"(program effects:
+  var g: integer;
+
+  function Get(x: integer): integer;
+  begin
+    return (g + x)
+  end Get;
+
+  function Twice(x: integer): integer;
+  begin
+    return (Get(x) + Get(x))
+  end Twice;
+
+  function Put(x: integer): integer;
+  begin
+    g := x;
+    return (Twice(x))
+  end Put;
+
+  function Show(x: integer): integer;
+  begin
+    output(Put(x));
+    return (x)
+  end Show;
+
+  begin
+    d := Show(1)
+  end effects.)");
+
+  EXPECT_TRUE(effects.at("Twice").reads_globals);
+  EXPECT_TRUE(effects.at("Twice").only_reads_memory());
+  EXPECT_FALSE(effects.at("Put").only_reads_memory());
+  EXPECT_FALSE(effects.at("Put").does_io);
+  EXPECT_TRUE(effects.at("Show").does_io);
+  EXPECT_TRUE(effects.at("Show").writes_globals);
+  EXPECT_EQ(effects.at("Get").globals, std::set<std::string>({"g"}));
+  EXPECT_EQ(effects.at("Show").globals, std::set<std::string>({"g"}));
+}
+
+TEST(EffectTest, TestRecursionAndLoopsMayDiverge) {
+  auto effects = analyze_program(R"(program effects:
+
+  function Fact(n: integer): integer;
+  begin
+    if n > 0 then return (n * Fact(n - 1))
+    else return (1)
+  end Fact;
+
+  function UsesFact(n: integer): integer;
+  begin
+    return (Fact(n))
+  end UsesFact;
+
+  function Sum(n: integer): integer;
+  var i: integer;
+  begin
+    Sum := 0;
+    for (i := 1; i <= n; i := i + 1)
+      Sum := Sum + i
+  end Sum;
+
+  begin
+    output(UsesFact(3), Sum(3))
+  end effects.)");
+
+  EXPECT_TRUE(effects.at("Fact").recursive);
+  EXPECT_TRUE(effects.at("Fact").may_diverge);
+  EXPECT_FALSE(effects.at("UsesFact").recursive);
+  EXPECT_TRUE(effects.at("UsesFact").may_diverge);
+  EXPECT_FALSE(effects.at("Sum").recursive);
+  EXPECT_TRUE(effects.at("Sum").may_diverge);
+  EXPECT_FALSE(effects.at("Sum").accesses_memory());
+}
+
+TEST(EffectTest, TestRecursionThroughReturnedCallsIsTailRecursive) {
+  auto effects = analyze_program(R"(program effects:
+
+  function Count(n, total: integer): integer;
+  begin
+    if n = 0 then return (total);
+    return (Count(n - 1, total + 1))
+  end Count;
+
+  function IsEven(n: integer): boolean;
+  begin
+    if n = 0 then return (true);
+    return (IsOdd(n - 1))
+  end IsEven;
+
+  function IsOdd(n: integer): boolean;
+  begin
+    if n = 0 then return (false);
+    return (IsEven(n - 1))
+  end IsOdd;
+
+  function Fib(n: integer): integer;
+  begin
+    if n < 2 then return (Count(n, 0));
+    return (Fib(Fib(n - 1) - Fib(n - 2) + n - 1))
+  end Fib;
+
+  begin
+    output(Count(3, 0), IsEven(3), Fib(5))
+  end effects.)");
+
+  EXPECT_TRUE(effects.at("Count").tail_recursive);
+  EXPECT_TRUE(effects.at("IsEven").tail_recursive);
+  EXPECT_TRUE(effects.at("IsOdd").tail_recursive);
+  // the returned call is in tail position, the calls in its arguments are not
+  EXPECT_TRUE(effects.at("Fib").recursive);
+  EXPECT_FALSE(effects.at("Fib").tail_recursive);
+}
+
+} // namespace WinZigC
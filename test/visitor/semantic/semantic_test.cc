@@ -277,4 +277,73 @@ TEST(SemanticTest, TestCaseValueTypeMismatch) {
             ":12:11: Case value type mismatch: 'char' and 'integer'");
 }
 
+TEST(SemanticTest, TestArrayMisuse) {
+  Lexer lexer(R"(program winzigc:
+  var a : array [1..10] of integer;
+      b : array [5..1] of char;
+      i : integer;
+
+  function F(x : array [1..2] of integer) : integer;
+  begin
+    return (0)
+  end F;
+
+  begin
+    a[11] := 1;
+    a['c'] := 2;
+    i := a;
+    i := i[1];
+    a[1] := 'c'
+  end winzigc.)");
+  Parser parser(lexer.get_tokens());
+  auto program = parser.parse();
+  SemanticVisitor semantic_visitor;
+  auto errors = semantic_visitor.check(*program, "");
+
+  ASSERT_EQ(errors.size(), 7);
+  ASSERT_EQ(errors[0].get_error_message(), ":3:7: Array upper bound is less than its lower bound");
+  ASSERT_EQ(errors[1].get_error_message(), ":6:14: Arrays cannot be passed to functions: 'x'");
+  ASSERT_EQ(errors[2].get_error_message(), ":12:5: Array index out of bounds: 'a[11]'");
+  ASSERT_EQ(errors[3].get_error_message(), ":13:5: Array index type should be integer");
+  ASSERT_EQ(errors[4].get_error_message(), ":14:10: Array 'a' can only be used with an index");
+  ASSERT_EQ(errors[5].get_error_message(),
+            ":15:10: Indexing a variable that is not an array: 'i'");
+  ASSERT_EQ(errors[6].get_error_message(),
+            ":16:10: Assignment type mismatch: 'integer' and 'char'");
+}
+
+TEST(SemanticTest, TestConstantMisuse) {
+  Lexer lexer(R"(program winzigc:
+  const size = 3, letter = 'x';
+  var i : integer;
+      c : char;
+
+  function F(n : integer) : integer;
+  const twice = n, size = 4;
+  begin
+    size := 5;
+    return (size)
+  end F;
+
+  begin
+    size := 1;
+    read(size);
+    c :=: letter;
+    i := letter
+  end winzigc.)");
+  Parser parser(lexer.get_tokens());
+  auto program = parser.parse();
+  SemanticVisitor semantic_visitor;
+  auto errors = semantic_visitor.check(*program, "");
+
+  ASSERT_EQ(errors.size(), 6);
+  ASSERT_EQ(errors[0].get_error_message(), ":7:17: Constant value is not a constant: 'n'");
+  ASSERT_EQ(errors[1].get_error_message(), ":9:5: Cannot assign to constant: 'size'");
+  ASSERT_EQ(errors[2].get_error_message(), ":14:5: Cannot assign to constant: 'size'");
+  ASSERT_EQ(errors[3].get_error_message(), ":15:10: Cannot assign to constant: 'size'");
+  ASSERT_EQ(errors[4].get_error_message(), ":16:11: Cannot assign to constant: 'letter'");
+  ASSERT_EQ(errors[5].get_error_message(),
+            ":17:7: Assignment type mismatch: 'integer' and 'char'");
+}
+
 } // namespace WinZigC
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace WinZigC {
+
+// The labels low..high of a case arm, and where the arm starts in the backend.
+template <typename Target> struct LabelRange {
+  int64_t low;
+  int64_t high;
+  Target target;
+};
+
+// Splits the label ranges of the arms, given in the order of the arms, into disjoint ranges sorted
+// by their low label. A label listed by more than one arm belongs to the first of them, so
+// `1..1000000: ...; 500: ...` keeps 500 on the first arm and the second arm gets no range.
+template <typename Target>
+std::vector<LabelRange<Target>>
+disjoint_label_ranges(const std::vector<LabelRange<Target>>& ranges) {
+  // low -> range of the labels taken by the earlier arms
+  std::map<int64_t, LabelRange<Target>> taken;
+  for (const auto& range : ranges) {
+    int64_t next = range.low;
+    auto overlap = taken.upper_bound(range.low);
+    if (overlap != taken.begin() && std::prev(overlap)->second.high >= range.low) {
+      overlap = std::prev(overlap);
+    }
+    std::vector<LabelRange<Target>> gaps;
+    for (; overlap != taken.end() && overlap->first <= range.high && next <= range.high;
+         overlap++) {
+      if (next < overlap->first) {
+        gaps.push_back({next, overlap->first - 1, range.target});
+      }
+      next = std::max(next, overlap->second.high + 1);
+    }
+    if (next <= range.high) {
+      gaps.push_back({next, range.high, range.target});
+    }
+    for (const auto& gap : gaps) {
+      taken.emplace(gap.low, gap);
+    }
+  }
+
+  std::vector<LabelRange<Target>> disjoint;
+  for (const auto& entry : taken) {
+    disjoint.push_back(entry.second);
+  }
+  return disjoint;
+}
+
+} // namespace WinZigC
@@ -0,0 +1,14 @@
+#include "winzigc/frontend/ast/constant.h"
+#include "winzigc/frontend/ast/visitor.h"
+
+namespace WinZigC {
+namespace Frontend {
+namespace AST {
+
+void GlobalConstant::accept(Visitor& visitor) const { visitor.visit(*this); }
+
+void LocalConstant::accept(Visitor& visitor) const { visitor.visit(*this); }
+
+} // namespace AST
+} // namespace Frontend
+} // namespace WinZigC
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "winzigc/frontend/ast/expr.h"
+#include "winzigc/frontend/ast/location.h"
+#include "winzigc/common/pure.h"
+
+namespace WinZigC {
+namespace Frontend {
+namespace AST {
+
+class Visitor;
+
+// `Name = ConstValue` of a const section. The value is a literal or the name of an enum literal
+// or of an earlier constant, it is known at compile time and takes no storage.
+class Constant {
+public:
+  Constant(SourceLocation location, std::string name, std::unique_ptr<Expression> value)
+      : location(location), name(std::move(name)), value(std::move(value)) {}
+  virtual ~Constant() = default;
+  virtual void accept(Visitor& visitor) const PURE;
+  const std::string& get_name() const { return name; }
+  const Expression& get_value() const { return *value; }
+  int get_line() const { return location.line; }
+  int get_column() const { return location.column; }
+
+private:
+  SourceLocation location;
+  std::string name;
+  std::unique_ptr<Expression> value;
+};
+
+class GlobalConstant : public Constant {
+public:
+  GlobalConstant(SourceLocation location, std::string name, std::unique_ptr<Expression> value)
+      : Constant(location, std::move(name), std::move(value)) {}
+  virtual void accept(Visitor& visitor) const override;
+};
+
+class LocalConstant : public Constant {
+public:
+  LocalConstant(SourceLocation location, std::string name, std::unique_ptr<Expression> value)
+      : Constant(location, std::move(name), std::move(value)) {}
+  virtual void accept(Visitor& visitor) const override;
+};
+
+} // namespace AST
+} // namespace Frontend
+} // namespace WinZigC
@@ -17,6 +17,8 @@ void CallExpression::accept(Visitor& visitor) const { visitor.visit(*this); }
 
 void IdentifierExpression::accept(Visitor& visitor) const { visitor.visit(*this); }
 
+void IndexExpression::accept(Visitor& visitor) const { visitor.visit(*this); }
+
 void AssignmentExpression::accept(Visitor& visitor) const { visitor.visit(*this); }
 
 void IfExpression::accept(Visitor& visitor) const { visitor.visit(*this); }
@@ -128,6 +128,19 @@ private:
   std::string name;
 };
 
+// An element of an array variable, `name[index]`. It takes the place of a plain identifier
+// wherever a variable is read or assigned.
+class IndexExpression : public IdentifierExpression {
+public:
+  IndexExpression(SourceLocation location, std::string name, std::unique_ptr<Expression> index)
+      : IdentifierExpression(location, name), index(std::move(index)) {}
+  void accept(Visitor& visitor) const override;
+  const Expression& get_index() const { return *index; }
+
+private:
+  std::unique_ptr<Expression> index;
+};
+
 class AssignmentExpression : public Expression {
 public:
   AssignmentExpression(SourceLocation location, std::unique_ptr<IdentifierExpression> name,
@@ -4,6 +4,7 @@
 #include <string>
 #include <utility>
 
+#include "winzigc/frontend/ast/constant.h"
 #include "winzigc/frontend/ast/type.h"
 #include "winzigc/frontend/ast/expr.h"
 #include "winzigc/frontend/ast/var.h"
@@ -19,11 +20,13 @@ class Function {
 public:
   Function(int line, std::string name, std::unique_ptr<Type> return_type,
            std::vector<std::unique_ptr<LocalVariable>> parameters,
+           std::vector<std::unique_ptr<LocalConstant>> constants,
            std::vector<std::unique_ptr<LocalUserTypeDef>> type_defs,
            std::vector<std::unique_ptr<LocalVariable>> local_var_dclns,
            std::vector<std::unique_ptr<Expression>> function_body_exprs)
       : name(name), return_type(std::move(return_type)), parameters(std::move(parameters)),
-        type_defs(std::move(type_defs)), local_var_dclns(std::move(local_var_dclns)),
+        constants(std::move(constants)), type_defs(std::move(type_defs)),
+        local_var_dclns(std::move(local_var_dclns)),
         function_body_exprs(std::move(function_body_exprs)) {}
   const std::string& get_name() const { return name; }
   const int get_line() const { return line; }
@@ -32,6 +35,7 @@ public:
   const std::vector<std::unique_ptr<LocalVariable>>& get_local_var_dclns() const {
     return local_var_dclns;
   }
+  const std::vector<std::unique_ptr<LocalConstant>>& get_constants() const { return constants; }
   const std::vector<std::unique_ptr<LocalUserTypeDef>>& get_type_defs() const { return type_defs; }
   const std::vector<std::unique_ptr<Expression>>& get_function_body_exprs() const {
     return function_body_exprs;
@@ -43,6 +47,7 @@ private:
   std::string name;
   std::unique_ptr<Type> return_type;
   std::vector<std::unique_ptr<LocalVariable>> parameters;
+  std::vector<std::unique_ptr<LocalConstant>> constants;
   std::vector<std::unique_ptr<LocalUserTypeDef>> type_defs;
   std::vector<std::unique_ptr<LocalVariable>> local_var_dclns;
   std::vector<std::unique_ptr<Expression>> function_body_exprs;
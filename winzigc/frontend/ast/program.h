@@ -5,6 +5,7 @@
 #include <vector>
 #include <utility>
 
+#include "winzigc/frontend/ast/constant.h"
 #include "winzigc/frontend/ast/function.h"
 #include "winzigc/frontend/ast/var.h"
 #include "winzigc/frontend/ast/expr.h"
@@ -19,17 +20,20 @@ class Visitor;
 
 class Program {
 public:
-  Program(std::string name, std::vector<std::unique_ptr<GlobalUserTypeDef>> user_types,
+  Program(std::string name, std::vector<std::unique_ptr<GlobalConstant>> constants,
+          std::vector<std::unique_ptr<GlobalUserTypeDef>> user_types,
           std::vector<std::unique_ptr<GlobalVariable>> vars,
           std::vector<std::unique_ptr<Function>> functions,
           std::vector<std::unique_ptr<Expression>> statements)
-      : name(name), user_types(std::move(user_types)), variables(std::move(vars)),
+      : name(name), constants(std::move(constants)), user_types(std::move(user_types)),
+        variables(std::move(vars)),
         functions(std::move(functions)), statements(std::move(statements)) {
     discard_variable = std::make_unique<GlobalVariable>(SourceLocation{0, 0}, std::string("d"),
                                                         std::make_unique<IntegerType>());
   }
 
   const std::string& get_name() const { return name; }
+  const std::vector<std::unique_ptr<GlobalConstant>>& get_constants() const { return constants; }
   const std::vector<std::unique_ptr<GlobalVariable>>& get_variables() const { return variables; }
   const std::vector<std::unique_ptr<GlobalUserTypeDef>>& get_user_types() const {
     return user_types;
@@ -41,6 +45,7 @@ public:
 
 private:
   std::string name;
+  std::vector<std::unique_ptr<GlobalConstant>> constants;
   std::vector<std::unique_ptr<GlobalUserTypeDef>> user_types;
   std::vector<std::unique_ptr<GlobalVariable>> variables;
   std::unique_ptr<GlobalVariable> discard_variable;
@@ -13,6 +13,8 @@ void CharacterType::accept(Visitor& visitor) const { visitor.visit(*this); }
 
 void UserType::accept(Visitor& visitor) const { visitor.visit(*this); }
 
+void ArrayType::accept(Visitor& visitor) const { visitor.visit(*this); }
+
 } // namespace AST
 } // namespace Frontend
 } // namespace WinZigC
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -44,6 +45,23 @@ public:
   virtual void accept(Visitor& visitor) const override;
 };
 
+// `array [lower..upper] of element_type`, the elements are stored contiguously.
+class ArrayType : public Type {
+public:
+  ArrayType(int lower, int upper, std::unique_ptr<Type> element_type)
+      : lower(lower), upper(upper), element_type(std::move(element_type)) {}
+  virtual void accept(Visitor& visitor) const override;
+  int get_lower() const { return lower; }
+  int get_upper() const { return upper; }
+  int64_t get_size() const { return static_cast<int64_t>(upper) - lower + 1; }
+  const Type& get_element_type() const { return *element_type; }
+
+private:
+  int lower;
+  int upper;
+  std::unique_ptr<Type> element_type;
+};
+
 } // namespace AST
 } // namespace Frontend
 } // namespace WinZigC
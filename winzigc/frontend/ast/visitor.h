@@ -1,5 +1,6 @@
 #pragma once
 
+#include "winzigc/frontend/ast/constant.h"
 #include "winzigc/frontend/ast/expr.h"
 #include "winzigc/frontend/ast/type.h"
 #include "winzigc/frontend/ast/user_type.h"
@@ -25,6 +26,7 @@ public:
 
   virtual void visit(const CallExpression& expression) PURE;
   virtual void visit(const IdentifierExpression& expression) PURE;
+  virtual void visit(const IndexExpression& expression) PURE;
   virtual void visit(const AssignmentExpression& expression) PURE;
   virtual void visit(const SwapExpression& expression) PURE;
   virtual void visit(const IfExpression& expression) PURE;
@@ -39,6 +41,9 @@ public:
   virtual void visit(const GlobalVariable& expression) PURE;
   virtual void visit(const LocalVariable& expression) PURE;
 
+  virtual void visit(const GlobalConstant& expression) PURE;
+  virtual void visit(const LocalConstant& expression) PURE;
+
   virtual void visit(const GlobalUserTypeDef& expression) PURE;
   virtual void visit(const LocalUserTypeDef& expression) PURE;
 
@@ -46,6 +51,7 @@ public:
   virtual void visit(const BooleanType& expression) PURE;
   virtual void visit(const CharacterType& expression) PURE;
   virtual void visit(const UserType& expression) PURE;
+  virtual void visit(const ArrayType& expression) PURE;
 
   virtual void visit(const Function& expression) PURE;
   virtual void visit(const Program& expression) PURE;
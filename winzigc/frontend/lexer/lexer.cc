@@ -222,6 +222,8 @@ Syntax::Token Lexer::find_next_token() {
       return Syntax::Token{Syntax::Kind::kCase, "case", line, column - 3};
     } else if (lexeme == "of") {
       return Syntax::Token{Syntax::Kind::kOf, "of", line, column - 1};
+    } else if (lexeme == "array") {
+      return Syntax::Token{Syntax::Kind::kArray, "array", line, column - 4};
     } else if (lexeme == "otherwise") {
       return Syntax::Token{Syntax::Kind::kOtherwise, "otherwise", line, column - 8};
     } else if (lexeme == "repeat") {
@@ -332,7 +334,7 @@ Syntax::Token Lexer::find_next_token() {
     return Syntax::Token{Syntax::Kind::kGreaterOrEqualOpr, ">=", line, column - 1};
   }
 
-  //  ":", ".", "<", ">", "=", ";", ",", "(", ")", "+", "-", "*", "/"
+  //  ":", ".", "<", ">", "=", ";", ",", "(", ")", "[", "]", "+", "-", "*", "/"
   switch (get_current_char()) {
   case ':':
     position++;
@@ -370,6 +372,14 @@ Syntax::Token Lexer::find_next_token() {
     position++;
     column++;
     return Syntax::Token{Syntax::Kind::kCloseBracket, ")", line, column};
+  case '[':
+    position++;
+    column++;
+    return Syntax::Token{Syntax::Kind::kOpenSquare, "[", line, column};
+  case ']':
+    position++;
+    column++;
+    return Syntax::Token{Syntax::Kind::kCloseSquare, "]", line, column};
   case '+':
     position++;
     column++;
@@ -27,7 +27,7 @@ std::unique_ptr<AST::Program> Parser::parse() {
   read(Syntax::Kind::kProgram);
   std::string program_name = read(Syntax::Kind::kIdentifier);
   read(Syntax::Kind::kColon);
-  // TODO: consts
+  std::vector<std::unique_ptr<AST::GlobalConstant>> global_constants = parse_global_constants();
   std::vector<std::unique_ptr<AST::GlobalUserTypeDef>> global_type_defs =
       parse_global_user_type_defs();
   std::vector<std::unique_ptr<AST::GlobalVariable>> var_dclns = parse_global_dclns();
@@ -35,9 +35,9 @@ std::unique_ptr<AST::Program> Parser::parse() {
   std::vector<std::unique_ptr<AST::Expression>> statements;
   parse_body(statements);
 
-  return std::make_unique<AST::Program>(program_name, std::move(global_type_defs),
-                                        std::move(var_dclns), std::move(functions),
-                                        std::move(statements));
+  return std::make_unique<AST::Program>(program_name, std::move(global_constants),
+                                        std::move(global_type_defs), std::move(var_dclns),
+                                        std::move(functions), std::move(statements));
 }
 
 // GlobalDclns      ->  'var' (GlobalDcln ';')+            =>  "global-dclns"
@@ -56,7 +56,7 @@ std::vector<std::unique_ptr<AST::GlobalVariable>> Parser::parse_global_dclns() {
   return var_dclns;
 }
 
-// GlobalDcln      ->  Name list ',' ':' Name                                        => "var";
+// GlobalDcln      ->  Name list ',' ':' ArrayBounds Name                            => "var";
 void Parser::parse_global_dcln(std::vector<std::unique_ptr<AST::GlobalVariable>>& var_dclns) {
   std::vector<std::pair<AST::SourceLocation, std::string>> identifiers;
   identifiers.push_back(
@@ -67,10 +67,11 @@ void Parser::parse_global_dcln(std::vector<std::unique_ptr<AST::GlobalVariable>>
         {{current_token->line, current_token->column}, read(Syntax::Kind::kIdentifier)});
   }
   read(Syntax::Kind::kColon);
+  std::optional<ArrayBounds> bounds = parse_array_bounds();
   std::string type = read(Syntax::Kind::kIdentifier);
   for (const auto& [location, identifier] : identifiers) {
     var_dclns.push_back(
-        std::make_unique<AST::GlobalVariable>(location, identifier, create_type(type)));
+        std::make_unique<AST::GlobalVariable>(location, identifier, create_type(type, bounds)));
   }
 }
 
@@ -90,7 +91,7 @@ std::vector<std::unique_ptr<AST::LocalVariable>> Parser::parse_local_dclns() {
   return var_dclns;
 }
 
-// LocalDcln       ->  Name list ',' ':' Name                                        => "var";
+// LocalDcln       ->  Name list ',' ':' ArrayBounds Name                            => "var";
 void Parser::parse_local_dcln(std::vector<std::unique_ptr<AST::LocalVariable>>& var_dclns) {
   std::vector<std::pair<AST::SourceLocation, std::string>> identifiers;
   identifiers.push_back(
@@ -101,13 +102,129 @@ void Parser::parse_local_dcln(std::vector<std::unique_ptr<AST::LocalVariable>>&
         {{current_token->line, current_token->column}, read(Syntax::Kind::kIdentifier)});
   }
   read(Syntax::Kind::kColon);
+  std::optional<ArrayBounds> bounds = parse_array_bounds();
   std::string type = read(Syntax::Kind::kIdentifier);
   for (const auto& [location, identifier] : identifiers) {
     var_dclns.push_back(
-        std::make_unique<AST::LocalVariable>(location, identifier, create_type(type)));
+        std::make_unique<AST::LocalVariable>(location, identifier, create_type(type, bounds)));
   }
 }
 
+// ArrayBounds     ->  'array' '[' Bound '..' Bound ']' 'of'                        => "array"
+//                 ->  ;
+std::optional<Parser::ArrayBounds> Parser::parse_array_bounds() {
+  if (current_token->kind != Syntax::Kind::kArray) {
+    return std::nullopt;
+  }
+  read(Syntax::Kind::kArray);
+  read(Syntax::Kind::kOpenSquare);
+  ArrayBounds bounds;
+  bounds.lower = parse_array_bound();
+  read(Syntax::Kind::kCaseRange);
+  bounds.upper = parse_array_bound();
+  read(Syntax::Kind::kCloseSquare);
+  read(Syntax::Kind::kOf);
+  return bounds;
+}
+
+// Bound           ->  '-'? '<integer>'
+//                 ->  Name;
+int Parser::parse_array_bound() {
+  if (current_token->kind == Syntax::Kind::kIdentifier) {
+    std::string name = read(Syntax::Kind::kIdentifier);
+    std::optional<int> value = lookup_integer_constant(name);
+    if (!value) {
+      LOG(ERROR) << "array bound: " << name;
+      throw std::runtime_error("Array bound is not an integer constant");
+    }
+    return *value;
+  }
+  if (current_token->kind == Syntax::Kind::kMinus) {
+    read(Syntax::Kind::kMinus);
+    return -std::stoi(read(Syntax::Kind::kInteger));
+  }
+  return std::stoi(read(Syntax::Kind::kInteger));
+}
+
+// GlobalConsts     ->  'const' GlobalConst list ',' ';'               => "global-consts"
+//                  ->                                                 => "global-consts";
+std::vector<std::unique_ptr<AST::GlobalConstant>> Parser::parse_global_constants() {
+  std::vector<std::unique_ptr<AST::GlobalConstant>> constants;
+  if (current_token->kind == Syntax::Kind::kConst) {
+    read(Syntax::Kind::kConst);
+    parse_global_constant(constants);
+    while (current_token->kind == Syntax::Kind::kComma) {
+      read(Syntax::Kind::kComma);
+      parse_global_constant(constants);
+    }
+    read(Syntax::Kind::kSemiColon);
+  }
+  return constants;
+}
+
+// GlobalConst      ->  Name '=' ConstValue                            => "global-const";
+void Parser::parse_global_constant(std::vector<std::unique_ptr<AST::GlobalConstant>>& constants) {
+  AST::SourceLocation location = {current_token->line, current_token->column};
+  std::string name = read(Syntax::Kind::kIdentifier);
+  read(Syntax::Kind::kEqualToOpr);
+  std::unique_ptr<AST::Expression> value = parse_const_value();
+  record_integer_constant(name, *value, global_integer_constants);
+  constants.push_back(std::make_unique<AST::GlobalConstant>(location, name, std::move(value)));
+}
+
+// LocalConsts     ->  'const' LocalConst list ',' ';'                 => "local-consts"
+//                 ->                                                  => "local-consts";
+std::vector<std::unique_ptr<AST::LocalConstant>> Parser::parse_local_constants() {
+  std::vector<std::unique_ptr<AST::LocalConstant>> constants;
+  if (current_token->kind == Syntax::Kind::kConst) {
+    read(Syntax::Kind::kConst);
+    parse_local_constant(constants);
+    while (current_token->kind == Syntax::Kind::kComma) {
+      read(Syntax::Kind::kComma);
+      parse_local_constant(constants);
+    }
+    read(Syntax::Kind::kSemiColon);
+  }
+  return constants;
+}
+
+// LocalConst      ->  Name '=' ConstValue                             => "local-const";
+void Parser::parse_local_constant(std::vector<std::unique_ptr<AST::LocalConstant>>& constants) {
+  AST::SourceLocation location = {current_token->line, current_token->column};
+  std::string name = read(Syntax::Kind::kIdentifier);
+  read(Syntax::Kind::kEqualToOpr);
+  std::unique_ptr<AST::Expression> value = parse_const_value();
+  record_integer_constant(name, *value, local_integer_constants);
+  constants.push_back(std::make_unique<AST::LocalConstant>(location, name, std::move(value)));
+}
+
+// Array bounds are resolved while parsing, so the parser keeps the value of every integer
+// constant, including the constants naming another one.
+void Parser::record_integer_constant(const std::string& name, const AST::Expression& value,
+                                     std::map<std::string, int>& integer_constants) {
+  if (const AST::IntegerExpression* integer =
+          dynamic_cast<const AST::IntegerExpression*>(&value)) {
+    integer_constants[name] = integer->get_value();
+  } else if (const AST::IdentifierExpression* identifier =
+                 dynamic_cast<const AST::IdentifierExpression*>(&value)) {
+    if (std::optional<int> aliased = lookup_integer_constant(identifier->get_name())) {
+      integer_constants[name] = *aliased;
+    }
+  }
+}
+
+std::optional<int> Parser::lookup_integer_constant(const std::string& name) const {
+  auto local = local_integer_constants.find(name);
+  if (local != local_integer_constants.end()) {
+    return local->second;
+  }
+  auto global = global_integer_constants.find(name);
+  if (global != global_integer_constants.end()) {
+    return global->second;
+  }
+  return std::nullopt;
+}
+
 // GlobalTypes      ->  'type' (GlobalType ';')+                       => "global-type-defs"
 //                  ->                                                 => "global-type-defs";
 std::vector<std::unique_ptr<AST::GlobalUserTypeDef>> Parser::parse_global_user_type_defs() {
@@ -178,6 +295,7 @@ std::vector<std::unique_ptr<AST::Function>> Parser::parse_functions() {
   std::vector<std::unique_ptr<AST::Function>> functions;
   while (current_token->kind == Syntax::Kind::kFunction) {
     local_user_types.clear();
+    local_integer_constants.clear();
     parse_function(functions);
   }
   return functions;
@@ -196,6 +314,7 @@ void Parser::parse_function(std::vector<std::unique_ptr<AST::Function>>& functio
   read(Syntax::Kind::kColon);
   std::unique_ptr<AST::Type> return_type = create_type(read(Syntax::Kind::kIdentifier));
   read(Syntax::Kind::kSemiColon);
+  std::vector<std::unique_ptr<AST::LocalConstant>> local_constants = parse_local_constants();
   std::vector<std::unique_ptr<AST::LocalUserTypeDef>> local_type_defs =
       parse_local_user_type_defs();
   std::vector<std::unique_ptr<AST::LocalVariable>> local_vars = parse_local_dclns();
@@ -211,7 +330,8 @@ void Parser::parse_function(std::vector<std::unique_ptr<AST::Function>>& functio
   read(Syntax::Kind::kSemiColon);
   functions.push_back(std::make_unique<AST::Function>(
       location.line, std::move(function_identifier_first), std::move(return_type),
-      std::move(params), std::move(local_type_defs), std::move(local_vars), std::move(statements)));
+      std::move(params), std::move(local_constants), std::move(local_type_defs),
+      std::move(local_vars), std::move(statements)));
 }
 
 // Params     ->  LocalDcln list ';'                                            => "params";
@@ -284,14 +404,11 @@ void Parser::parse_statement(std::vector<std::unique_ptr<AST::Expression>>& stat
   }
 }
 
-// Assignment ->  Name ':=' Expression                                          => "assign"
-//            ->  Name ':=:' Name                                               => "swap";
+// Assignment ->  Variable ':=' Expression                                      => "assign"
+//            ->  Variable ':=:' Variable                                       => "swap";
 std::unique_ptr<AST::Expression> Parser::parse_assignment_statement() {
-  AST::SourceLocation identifier_location = {current_token->line, current_token->column};
-  auto identifier_expr = std::make_unique<AST::IdentifierExpression>(
-      identifier_location, read(Syntax::Kind::kIdentifier));
+  std::unique_ptr<AST::IdentifierExpression> identifier_expr = parse_variable();
   std::unique_ptr<AST::IdentifierExpression> identifier_expr_rhs;
-  AST::SourceLocation identifier_right_location;
   std::unique_ptr<AST::Expression> expression;
   AST::SourceLocation assignment_operator_location;
   switch (current_token->kind) {
@@ -305,9 +422,7 @@ std::unique_ptr<AST::Expression> Parser::parse_assignment_statement() {
   case Syntax::Kind::kSwap:
     assignment_operator_location = {current_token->line, current_token->column};
     read(Syntax::Kind::kSwap);
-    identifier_right_location = {current_token->line, current_token->column};
-    identifier_expr_rhs = std::make_unique<AST::IdentifierExpression>(
-        identifier_right_location, read(Syntax::Kind::kIdentifier));
+    identifier_expr_rhs = parse_variable();
     return std::make_unique<AST::SwapExpression>(
         assignment_operator_location, std::move(identifier_expr), std::move(identifier_expr_rhs));
     break;
@@ -317,6 +432,20 @@ std::unique_ptr<AST::Expression> Parser::parse_assignment_statement() {
   }
 }
 
+// Variable   ->  Name
+//            ->  Name '[' Expression ']'                                       => "index";
+std::unique_ptr<AST::IdentifierExpression> Parser::parse_variable() {
+  AST::SourceLocation location = {current_token->line, current_token->column};
+  std::string name = read(Syntax::Kind::kIdentifier);
+  if (current_token->kind != Syntax::Kind::kOpenSquare) {
+    return std::make_unique<AST::IdentifierExpression>(location, name);
+  }
+  read(Syntax::Kind::kOpenSquare);
+  std::unique_ptr<AST::Expression> index = parse_expression();
+  read(Syntax::Kind::kCloseSquare);
+  return std::make_unique<AST::IndexExpression>(location, name, std::move(index));
+}
+
 std::unique_ptr<AST::Expression> Parser::parse_output_statement() {
   AST::SourceLocation location = {current_token->line, current_token->column};
   std::string name = read(Syntax::Kind::kOutput); // TODO: make this printf for lib function
@@ -554,7 +683,7 @@ std::unique_ptr<AST::Expression> Parser::parse_primary() {
       read(Syntax::Kind::kCloseBracket);
       return std::make_unique<AST::CallExpression>(location, name, std::move(arguments));
     }
-    return std::make_unique<AST::IdentifierExpression>(location, read(Syntax::Kind::kIdentifier));
+    return parse_variable();
   case Syntax::Kind::kInteger:
     return std::make_unique<AST::IntegerExpression>(location,
                                                     std::stoi(read(Syntax::Kind::kInteger)));
@@ -632,6 +761,14 @@ std::unique_ptr<AST::Type> Parser::create_type(const std::string& type) {
   }
 }
 
+std::unique_ptr<AST::Type> Parser::create_type(const std::string& type,
+                                               const std::optional<ArrayBounds>& bounds) {
+  if (!bounds) {
+    return create_type(type);
+  }
+  return std::make_unique<AST::ArrayType>(bounds->lower, bounds->upper, create_type(type));
+}
+
 bool Parser::has_next_token() { return token_index < tokens->size(); }
 
 Syntax::Kind Parser::peek_next_kind() {
@@ -749,6 +886,7 @@ const std::map<Syntax::Kind, std::string> Parser::kind_to_string = {
     {Syntax::Kind::kDo, "kDo"},
     {Syntax::Kind::kCase, "kCase"},
     {Syntax::Kind::kOf, "kOf"},
+    {Syntax::Kind::kArray, "kArray"},
     {Syntax::Kind::kCaseRange, "kCaseRange"},
     {Syntax::Kind::kOtherwise, "kOtherwise"},
     {Syntax::Kind::kRepeat, "kRepeat"},
@@ -779,6 +917,8 @@ const std::map<Syntax::Kind, std::string> Parser::kind_to_string = {
     {Syntax::Kind::kComma, "kComma"},
     {Syntax::Kind::kOpenBracket, "kOpenBracket"},
     {Syntax::Kind::kCloseBracket, "kCloseBracket"},
+    {Syntax::Kind::kOpenSquare, "kOpenSquare"},
+    {Syntax::Kind::kCloseSquare, "kCloseSquare"},
     {Syntax::Kind::kPlus, "kPlus"},
     {Syntax::Kind::kMinus, "kMinus"},
     {Syntax::Kind::kMultiply, "kMultiply"},
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <optional>
 
 #include "winzigc/frontend/syntax/kind.h"
 #include "winzigc/frontend/syntax/token.h"
@@ -28,6 +29,7 @@ private:
   void parse_statement(std::vector<std::unique_ptr<AST::Expression>>& statements);
 
   std::unique_ptr<AST::Expression> parse_assignment_statement();
+  std::unique_ptr<AST::IdentifierExpression> parse_variable();
   std::unique_ptr<AST::Expression> parse_output_statement();
   std::unique_ptr<AST::Expression> parse_read_statement();
   std::unique_ptr<AST::Expression> parse_return_statement();
@@ -43,6 +45,21 @@ private:
   void parse_otherwise_clause(std::vector<std::unique_ptr<AST::Expression>>& otherwise_statements);
   std::unique_ptr<AST::Expression> parse_const_value();
 
+  struct ArrayBounds {
+    int lower;
+    int upper;
+  };
+  std::optional<ArrayBounds> parse_array_bounds();
+  int parse_array_bound();
+
+  std::vector<std::unique_ptr<AST::GlobalConstant>> parse_global_constants();
+  void parse_global_constant(std::vector<std::unique_ptr<AST::GlobalConstant>>& constants);
+  std::vector<std::unique_ptr<AST::LocalConstant>> parse_local_constants();
+  void parse_local_constant(std::vector<std::unique_ptr<AST::LocalConstant>>& constants);
+  void record_integer_constant(const std::string& name, const AST::Expression& value,
+                               std::map<std::string, int>& integer_constants);
+  std::optional<int> lookup_integer_constant(const std::string& name) const;
+
   std::vector<std::unique_ptr<AST::GlobalVariable>> parse_global_dclns();
   void parse_global_dcln(std::vector<std::unique_ptr<AST::GlobalVariable>>& variables);
   std::vector<std::unique_ptr<AST::LocalVariable>> parse_local_dclns();
@@ -59,6 +76,8 @@ private:
   void parse_params(std::vector<std::unique_ptr<AST::LocalVariable>>& params);
 
   std::unique_ptr<AST::Type> create_type(const std::string& type);
+  std::unique_ptr<AST::Type> create_type(const std::string& type,
+                                         const std::optional<ArrayBounds>& bounds);
   bool has_next_token();
   Syntax::Kind peek_next_kind();
   Syntax::Token peek_next_token();
@@ -73,6 +92,8 @@ private:
   Syntax::Token* current_token;
   std::vector<std::string> global_user_types;
   std::vector<std::string> local_user_types;
+  std::map<std::string, int> global_integer_constants;
+  std::map<std::string, int> local_integer_constants;
 
   static const std::map<Syntax::Kind, std::string> kind_to_string;
   static const std::map<Syntax::Kind, int> kind_to_precedence;
@@ -35,6 +35,7 @@ enum class Kind {
   kDo,                //  do
   kCase,              //  case
   kOf,                //  of
+  kArray,             //  array
   kCaseRange,         //  ..
   kOtherwise,         //  otherwise
   kRepeat,            //  repeat
@@ -65,6 +66,8 @@ enum class Kind {
   kComma,             //  ,
   kOpenBracket,       //  (
   kCloseBracket,      //  )
+  kOpenSquare,        //  [
+  kCloseSquare,       //  ]
   kPlus,              //  +
   kMinus,             //  -
   kMultiply,          //  *
@@ -9,7 +9,11 @@
 #include "winzigc/frontend/parser/parser.h"
 #include "winzigc/frontend/ast/program.h"
 #include "winzigc/visitor/semantic/semantic_visitor.h"
+#include "winzigc/visitor/bytecode/bytecode_compiler_visitor.h"
+#include "winzigc/visitor/bytecode/virtual_machine.h"
 #include "winzigc/visitor/codegen/codegen_visitor.h"
+#include "winzigc/visitor/interpreter/interpreter_visitor.h"
+#include "winzigc/visitor/interpreter/tier_up_compiler.h"
 
 #include "glog/logging.h"
 
@@ -28,7 +32,24 @@ int main(int argc, char** argv) {
 
   bool optimize = false;
   bool debug = false;
+  bool emit_object = false;
+  bool emit_bitcode = false;
+  bool thin_lto = false;
+  bool run = false;
+  bool interpret = false;
+  bool vm = false;
+  bool tiered = false;
+  bool short_circuit = true;
+  bool memoize = false;
+  bool memoize_stats = false;
+  bool explicit_stack = false;
+  bool profile_generate = false;
+  std::string profile_output_path;
+  std::string profile_use_path;
+  std::string target_cpu;
+  uint64_t tier_up_threshold = WinZigC::Visitor::InterpreterVisitor::kDefaultTierUpThreshold;
   std::string program_path;
+  std::string output_path;
 
   for (int i = 1; i < argc; ++i) {
     std::string arg = argv[i];
@@ -36,6 +57,52 @@ int main(int argc, char** argv) {
       optimize = true;
     } else if (arg == "-dbg") {
       debug = true;
+    } else if (arg == "-c") {
+      emit_object = true;
+    } else if (arg == "-emit-bc") {
+      emit_bitcode = true;
+    } else if (arg == "-thinlto") {
+      emit_bitcode = true;
+      thin_lto = true;
+    } else if (arg == "-run") {
+      run = true;
+    } else if (arg == "-interpret") {
+      interpret = true;
+    } else if (arg == "-vm") {
+      vm = true;
+    } else if (arg == "-tiered") {
+      tiered = true;
+    } else if (arg == "-no-short-circuit") {
+      short_circuit = false;
+    } else if (arg == "-memoize") {
+      memoize = true;
+    } else if (arg == "-memoize-stats") {
+      memoize_stats = true;
+    } else if (arg == "-explicit-stack") {
+      explicit_stack = true;
+    } else if (arg == "-fprofile-generate") {
+      profile_generate = true;
+    } else if (arg.rfind("-fprofile-generate=", 0) == 0) {
+      profile_generate = true;
+      profile_output_path = arg.substr(std::string("-fprofile-generate=").size());
+    } else if (arg.rfind("-fprofile-use=", 0) == 0) {
+      profile_use_path = arg.substr(std::string("-fprofile-use=").size());
+    } else if (arg.rfind("-march=", 0) == 0) {
+      target_cpu = arg.substr(std::string("-march=").size());
+    } else if (arg.rfind("-mcpu=", 0) == 0) {
+      target_cpu = arg.substr(std::string("-mcpu=").size());
+    } else if (arg == "-tier-threshold") {
+      if (i + 1 >= argc) {
+        LOG(ERROR) << "Missing call count after '-tier-threshold'.";
+        return 1;
+      }
+      tier_up_threshold = std::stoull(argv[++i]);
+    } else if (arg == "-o") {
+      if (i + 1 >= argc) {
+        LOG(ERROR) << "Missing output file path after '-o'.";
+        return 1;
+      }
+      output_path = argv[++i];
     } else {
       program_path = arg;
     }
@@ -45,6 +112,31 @@ int main(int argc, char** argv) {
     LOG(ERROR) << "Please provide a file path.";
     return 1;
   }
+  // the profile runtime is linked into the program by `clang -fprofile-generate`, the in-process
+  // backends have none
+  if (profile_generate && (run || interpret || vm || tiered)) {
+    LOG(ERROR) << "'-fprofile-generate' only applies to compiled programs.";
+    return 1;
+  }
+  // -opt changes the control flow generated for the program, the profile only applies to the
+  // control flow it was collected on
+  if ((profile_generate || !profile_use_path.empty()) && !optimize) {
+    LOG(ERROR) << "'-fprofile-generate' and '-fprofile-use' require '-opt'.";
+    return 1;
+  }
+  // a program is written in one format, or run without writing anything
+  if (emit_object && emit_bitcode) {
+    LOG(ERROR) << "'-c' and '-emit-bc' or '-thinlto' select different output formats.";
+    return 1;
+  }
+  if ((emit_object || emit_bitcode || !output_path.empty()) && (run || interpret || vm || tiered)) {
+    LOG(ERROR) << "'-c', '-emit-bc', '-thinlto' and '-o' only apply to compiled programs.";
+    return 1;
+  }
+  if (!profile_use_path.empty() && !std::ifstream(profile_use_path)) {
+    LOG(ERROR) << "Failed to open profile: " << profile_use_path;
+    return 1;
+  }
 
   std::ifstream file(program_path);
   if (!file) {
@@ -72,11 +164,53 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  WinZigC::Visitor::CodeGenVisitor codegen_visitor(optimize, debug);
-  codegen_visitor.codegen(*program, program_path);
-  codegen_visitor.print_llvm_ir(program_path);
+  if (vm) {
+    WinZigC::Visitor::BytecodeCompilerVisitor bytecode_compiler(short_circuit);
+    WinZigC::Bytecode::VirtualMachine virtual_machine;
+    return virtual_machine.run(bytecode_compiler.compile(*program));
+  }
+  if (interpret || tiered) {
+    WinZigC::Visitor::InterpreterVisitor interpreter;
+    interpreter.set_short_circuit(short_circuit);
+    WinZigC::Visitor::JitTierUpCompiler tier_up_compiler(*program, program_path, interpreter);
+    if (tiered) {
+      interpreter.set_tier_up_compiler(&tier_up_compiler, tier_up_threshold);
+    }
+    return interpreter.run(*program);
+  }
 
-  return 0;
+  WinZigC::Visitor::CodeGenVisitor codegen_visitor(optimize, debug, short_circuit, memoize,
+                                                   memoize_stats);
+  if (!target_cpu.empty()) {
+    codegen_visitor.set_target_cpu(target_cpu);
+  }
+  codegen_visitor.set_explicit_stack(explicit_stack);
+  if (profile_generate) {
+    codegen_visitor.set_profile_generate(profile_output_path);
+  }
+  if (!profile_use_path.empty()) {
+    codegen_visitor.set_profile_use(profile_use_path);
+  }
+  codegen_visitor.codegen(*program, program_path);
+  if (run) {
+    return codegen_visitor.run_jit();
+  }
+  if (emit_object) {
+    if (output_path.empty()) {
+      output_path = program_path + ".o";
+    }
+    return codegen_visitor.emit_object_file(output_path) ? 0 : 1;
+  }
+  if (emit_bitcode) {
+    if (output_path.empty()) {
+      output_path = program_path + ".bc";
+    }
+    return codegen_visitor.write_bitcode(output_path, thin_lto) ? 0 : 1;
+  }
+  if (output_path.empty()) {
+    output_path = program_path + ".ll";
+  }
+  return codegen_visitor.print_llvm_ir(output_path) ? 0 : 1;
 }
 
 } // namespace WinZigC
@@ -0,0 +1,35 @@
+// Frame stacks of the functions compiled with -explicit-stack. A function keeps the frames of
+// its pending self calls in an anonymous mapping instead of on the native stack, so the depth of
+// its recursion is only bounded by memory.
+
+#include "winzigc/runtime/wz_runtime.h"
+#include "winzigc/runtime/wz_system.h"
+
+#include <string.h>
+
+#define WZ_FRAMES_MIN_SIZE (1 << 16)
+
+void* wz_frames_grow(void* frames, int64_t* capacity, int64_t frame_size) {
+  int64_t grown_capacity =
+      *capacity == 0 ? (WZ_FRAMES_MIN_SIZE + frame_size - 1) / frame_size : *capacity * 2;
+  void* grown = wz_mmap((size_t)(grown_capacity * frame_size), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1);
+  if (wz_mmap_failed(grown)) {
+    static const char message[] = "out of memory for the frames of a recursion\n";
+    wz_flush();
+    wz_write(STDERR_FILENO, message, sizeof(message) - 1);
+    wz_exit(1);
+  }
+  if (frames) {
+    memcpy(grown, frames, (size_t)(*capacity * frame_size));
+    wz_munmap(frames, (size_t)(*capacity * frame_size));
+  }
+  *capacity = grown_capacity;
+  return grown;
+}
+
+void wz_frames_free(void* frames, int64_t capacity, int64_t frame_size) {
+  if (frames) {
+    wz_munmap(frames, (size_t)(capacity * frame_size));
+  }
+}
@@ -0,0 +1,133 @@
+// Hash tables behind the functions compiled with -memoize. Every memoized function owns one
+// wz_memo_table; its entries live in an anonymous mapping, so the freestanding runtime needs no
+// allocator, and are found by linear probing.
+
+#include "winzigc/runtime/wz_runtime.h"
+#include "winzigc/runtime/wz_system.h"
+
+#define WZ_MEMO_MIN_CAPACITY (1 << 10)
+// past this many entries new results are not cached any more
+#define WZ_MEMO_MAX_CAPACITY (1 << 22)
+
+static inline size_t entry_size(int32_t arg_count) { return (size_t)arg_count + 2; }
+
+static inline uint32_t hash_args(const int32_t* args, int32_t arg_count) {
+  uint64_t hash = 0x9e3779b97f4a7c15ull;
+  for (int32_t i = 0; i < arg_count; ++i) {
+    hash = (hash ^ (uint32_t)args[i]) * 0xff51afd7ed558ccdull;
+    hash ^= hash >> 32;
+  }
+  return (uint32_t)hash;
+}
+
+static inline int same_args(const int32_t* entry_args, const int32_t* args, int32_t arg_count) {
+  for (int32_t i = 0; i < arg_count; ++i) {
+    if (entry_args[i] != args[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// The entry holding the arguments, or the empty entry where they belong. Tables are never more
+// than three quarters full, so the probe always ends.
+static int32_t* probe(const wz_memo_table* table, const int32_t* args, int32_t arg_count) {
+  uint32_t mask = (uint32_t)table->capacity - 1;
+  for (uint32_t slot = hash_args(args, arg_count) & mask;; slot = (slot + 1) & mask) {
+    int32_t* entry = table->entries + slot * entry_size(arg_count);
+    if (entry[0] == 0 || same_args(entry + 2, args, arg_count)) {
+      return entry;
+    }
+  }
+}
+
+static int grow(wz_memo_table* table, int32_t arg_count) {
+  int32_t capacity = table->capacity == 0 ? WZ_MEMO_MIN_CAPACITY : table->capacity * 2;
+  size_t length = (size_t)capacity * entry_size(arg_count) * sizeof(int32_t);
+  void* entries = wz_mmap(length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1);
+  if (wz_mmap_failed(entries)) {
+    return 0;
+  }
+
+  wz_memo_table grown = *table;
+  grown.entries = entries;
+  grown.capacity = capacity;
+  for (int32_t slot = 0; slot < table->capacity; ++slot) {
+    const int32_t* entry = table->entries + slot * entry_size(arg_count);
+    if (entry[0] != 0) {
+      int32_t* target = probe(&grown, entry + 2, arg_count);
+      for (size_t i = 0; i < entry_size(arg_count); ++i) {
+        target[i] = entry[i];
+      }
+    }
+  }
+  if (table->entries) {
+    wz_munmap(table->entries, (size_t)table->capacity * entry_size(arg_count) * sizeof(int32_t));
+  }
+  *table = grown;
+  return 1;
+}
+
+int32_t wz_memo_find(const wz_memo_table* table, const int32_t* args, int32_t arg_count,
+                     int32_t* result) {
+  if (table->capacity == 0) {
+    return 0;
+  }
+  const int32_t* entry = probe(table, args, arg_count);
+  if (entry[0] == 0) {
+    return 0;
+  }
+  *result = entry[1];
+  return 1;
+}
+
+void wz_memo_insert(wz_memo_table* table, const int32_t* args, int32_t arg_count, int32_t result) {
+  if ((int64_t)(table->count + 1) * 4 > (int64_t)table->capacity * 3) {
+    if (table->capacity >= WZ_MEMO_MAX_CAPACITY || !grow(table, arg_count)) {
+      return;
+    }
+  }
+  int32_t* entry = probe(table, args, arg_count);
+  if (entry[0] == 0) {
+    entry[0] = 1;
+    for (int32_t i = 0; i < arg_count; ++i) {
+      entry[2 + i] = args[i];
+    }
+    table->count++;
+  }
+  entry[1] = result;
+}
+
+static char* format_count(int64_t value, char* end) {
+  uint64_t magnitude = (uint64_t)value;
+  do {
+    *--end = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  return end;
+}
+
+static void append(char** to, const char* from, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    *(*to)++ = from[i];
+  }
+}
+
+void wz_memo_report(const char* name, int32_t length, const wz_memo_table* table) {
+  char line[256];
+  char digits[24];
+  char* end = line;
+  if (length > 128) {
+    length = 128;
+  }
+  append(&end, "memoize ", 8);
+  append(&end, name, length);
+  append(&end, ": ", 2);
+  char* begin = format_count(table->hits, digits + sizeof(digits));
+  append(&end, begin, digits + sizeof(digits) - begin);
+  append(&end, " hits, ", 7);
+  begin = format_count(table->misses, digits + sizeof(digits));
+  append(&end, begin, digits + sizeof(digits) - begin);
+  append(&end, " misses\n", 8);
+  wz_write(STDERR_FILENO, line, end - line);
+}
@@ -0,0 +1,276 @@
+#include "winzigc/runtime/wz_runtime.h"
+#include "winzigc/runtime/wz_system.h"
+
+#include <string.h>
+
+#define WZ_OUTPUT_BUFFER_SIZE (1 << 16)
+#define WZ_INPUT_BUFFER_SIZE (1 << 16)
+// "-2147483648" and the separator
+#define WZ_MAX_INT_LENGTH 12
+
+static char output_buffer[WZ_OUTPUT_BUFFER_SIZE];
+static size_t output_length = 0;
+
+static char input_buffer[WZ_INPUT_BUFFER_SIZE];
+// the unread input, inside input_buffer or inside the mapping of stdin
+static const char* input_begin = input_buffer;
+static const char* input_end = input_buffer;
+static int input_opened = 0;
+static int input_mapped = 0;
+
+static const char digit_pairs[201] = "00010203040506070809"
+                                     "10111213141516171819"
+                                     "20212223242526272829"
+                                     "30313233343536373839"
+                                     "40414243444546474849"
+                                     "50515253545556575859"
+                                     "60616263646566676869"
+                                     "70717273747576777879"
+                                     "80818283848586878889"
+                                     "90919293949596979899";
+
+static void write_all(const char* data, size_t length) {
+  while (length > 0) {
+    long written = wz_write(STDOUT_FILENO, data, length);
+    if (written < 0) {
+      if (written == -EINTR) {
+        continue;
+      }
+      return;
+    }
+    data += written;
+    length -= written;
+  }
+}
+
+void wz_flush(void) {
+  write_all(output_buffer, output_length);
+  output_length = 0;
+}
+
+static inline void reserve(size_t length) {
+  if (output_length + length > WZ_OUTPUT_BUFFER_SIZE) {
+    wz_flush();
+  }
+}
+
+// Formats the value at the end of the buffer, two digits at a time.
+static inline void put_int(int32_t value) {
+  char digits[WZ_MAX_INT_LENGTH];
+  char* end = digits + sizeof(digits);
+  char* begin = end;
+  uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+  while (magnitude >= 100) {
+    uint32_t pair = (magnitude % 100) * 2;
+    magnitude /= 100;
+    *--begin = digit_pairs[pair + 1];
+    *--begin = digit_pairs[pair];
+  }
+  if (magnitude >= 10) {
+    *--begin = digit_pairs[magnitude * 2 + 1];
+    *--begin = digit_pairs[magnitude * 2];
+  } else {
+    *--begin = (char)('0' + magnitude);
+  }
+  if (value < 0) {
+    *--begin = '-';
+  }
+  memcpy(output_buffer + output_length, begin, end - begin);
+  output_length += end - begin;
+}
+
+void wz_out_int(int32_t value) {
+  reserve(WZ_MAX_INT_LENGTH);
+  put_int(value);
+  output_buffer[output_length++] = '\n';
+}
+
+void wz_out_char(int8_t value) {
+  reserve(2);
+  output_buffer[output_length++] = (char)value;
+  output_buffer[output_length++] = '\n';
+}
+
+void wz_out_text(const char* text, int32_t length) {
+  if ((size_t)length > WZ_OUTPUT_BUFFER_SIZE) {
+    wz_flush();
+    write_all(text, length);
+    return;
+  }
+  reserve(length);
+  memcpy(output_buffer + output_length, text, length);
+  output_length += length;
+}
+
+void wz_out_format(const char* format, int32_t length, const int32_t* values) {
+  const char* end = format + length;
+  while (format < end) {
+    const char* text = format;
+    while (format < end && *format != '%') {
+      ++format;
+    }
+    if (format != text) {
+      wz_out_text(text, format - text);
+    }
+    if (end - format < 2) {
+      break;
+    }
+    char directive = format[1];
+    format += 2;
+    if (directive == 'd') {
+      reserve(WZ_MAX_INT_LENGTH);
+      put_int(*values++);
+    } else {
+      reserve(1);
+      output_buffer[output_length++] = directive == 'c' ? (char)*values++ : '%';
+    }
+  }
+}
+
+// A regular file on stdin is mapped as a whole, from the current offset of the descriptor, so
+// reading it needs no copies and no further system calls.
+static void map_input(void) {
+  struct stat status;
+  if (wz_fstat(STDIN_FILENO, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size <= 0) {
+    return;
+  }
+  long offset = wz_lseek(STDIN_FILENO, 0, SEEK_CUR);
+  if (offset < 0 || offset >= status.st_size) {
+    return;
+  }
+  void* data = wz_mmap(status.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO);
+  if (wz_mmap_failed(data)) {
+    return;
+  }
+  wz_madvise(data, status.st_size, MADV_SEQUENTIAL);
+  input_begin = (const char*)data + offset;
+  input_end = (const char*)data + status.st_size;
+  input_mapped = 1;
+}
+
+// Makes more input available once the unread input is used up, returns 0 at the end of the input.
+// The program may wait for its input here, so everything it printed so far goes out first.
+static int refill(void) {
+  wz_flush();
+  if (!input_opened) {
+    input_opened = 1;
+    map_input();
+    if (input_begin != input_end) {
+      return 1;
+    }
+  }
+  if (input_mapped) {
+    return 0;
+  }
+  while (1) {
+    long count = wz_read(STDIN_FILENO, input_buffer, sizeof(input_buffer));
+    if (count == -EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return 0;
+    }
+    input_begin = input_buffer;
+    input_end = input_buffer + count;
+    return 1;
+  }
+}
+
+static inline int is_space(char c) {
+  return c == ' ' || (unsigned char)(c - '\t') < 5;
+}
+
+static inline int is_digit(char c) {
+  return (unsigned char)(c - '0') < 10;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define WZ_SWAR_DIGITS 1
+
+static const uint32_t powers_of_ten[9] = {1,      10,      100,      1000,     10000,
+                                          100000, 1000000, 10000000, 100000000};
+
+// Number of leading decimal digits among the eight bytes of chunk, in memory order. A byte is a
+// digit when it is below 10 after the '0' is xor-ed away; adding 0x76 sets the top bit of every
+// byte that is not.
+static inline int count_digits(uint64_t chunk) {
+  uint64_t values = chunk ^ 0x3030303030303030ull;
+  uint64_t non_digits =
+      (((values & 0x7f7f7f7f7f7f7f7full) + 0x7676767676767676ull) | values) & 0x8080808080808080ull;
+  return non_digits ? __builtin_ctzll(non_digits) / 8 : 8;
+}
+
+// Value of the first count (1 to 8) digits of chunk. The digits are moved to the top of the word
+// and combined pairwise into 2, 4 and 8 digit numbers with three multiplications.
+static inline uint32_t digits_value(uint64_t chunk, int count) {
+  uint64_t values = (chunk ^ 0x3030303030303030ull) << (8 * (8 - count));
+  values = (values * 10 + (values >> 8)) & 0x00ff00ff00ff00ffull;
+  values = (values * 100 + (values >> 16)) & 0x0000ffff0000ffffull;
+  values = (values * 10000 + (values >> 32)) & 0x00000000ffffffffull;
+  return (uint32_t)values;
+}
+#endif
+
+// Parses the digits at the start of the unread input. Values out of range wrap around.
+static uint32_t parse_digits(void) {
+  uint32_t value = 0;
+  while (1) {
+#ifdef WZ_SWAR_DIGITS
+    if (input_end - input_begin >= 8) {
+      uint64_t chunk;
+      memcpy(&chunk, input_begin, sizeof(chunk));
+      int count = count_digits(chunk);
+      if (count == 0) {
+        return value;
+      }
+      value = value * powers_of_ten[count] + digits_value(chunk, count);
+      input_begin += count;
+      if (count < 8) {
+        return value;
+      }
+      continue;
+    }
+#endif
+    if (input_begin == input_end && !refill()) {
+      return value;
+    }
+    if (!is_digit(*input_begin)) {
+      return value;
+    }
+    value = value * 10 + (uint32_t)(*input_begin++ - '0');
+  }
+}
+
+int32_t wz_read_int(int32_t* value) {
+  while (1) {
+    if (input_begin == input_end && !refill()) {
+      return 0;
+    }
+    if (!is_space(*input_begin)) {
+      break;
+    }
+    ++input_begin;
+  }
+  int negative = 0;
+  if (*input_begin == '-' || *input_begin == '+') {
+    negative = *input_begin == '-';
+    ++input_begin;
+    if (input_begin == input_end && !refill()) {
+      return 0;
+    }
+  }
+  if (!is_digit(*input_begin)) {
+    return 0;
+  }
+  uint32_t magnitude = parse_digits();
+  *value = (int32_t)(negative ? 0u - magnitude : magnitude);
+  return 1;
+}
+
+int32_t wz_read_char(int8_t* value) {
+  if (input_begin == input_end && !refill()) {
+    return 0;
+  }
+  *value = (int8_t)*input_begin++;
+  return 1;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Runtime library linked into every WinZigC program. Output is collected in a per-process buffer
+// and handed to write(2) when the buffer fills up, before the program blocks on input and when
+// main returns. Input is read in large blocks, or mapped when stdin is a regular file.
+
+// output(i) of a single integer or boolean: the value followed by a new line
+void wz_out_int(int32_t value);
+// output(c) of a single character: the character followed by a new line
+void wz_out_char(int8_t value);
+// raw bytes, used for outputs whose arguments are all constants
+void wz_out_text(const char* text, int32_t length);
+// formatted output of one or more output calls: the bytes of format are copied, except for "%d"
+// and "%c" that print the next of values as an integer or a character and "%%" that prints '%'
+void wz_out_format(const char* format, int32_t length, const int32_t* values);
+void wz_flush(void);
+
+// read of an integer, with the semantics of scanf("%d"): leading white space is skipped and an
+// optional sign is accepted. Returns 1 and stores the value, or returns 0 and leaves it unchanged
+// when the input does not start with a number.
+int32_t wz_read_int(int32_t* value);
+// read of a character, with the semantics of scanf("%c"): the next byte, white space included.
+int32_t wz_read_char(int8_t* value);
+
+// Result cache of a function compiled with -memoize, zero initialized by the program. Arguments
+// and results are widened to 32 bits; an entry holds a used flag, the result and the arguments.
+// The compiled code counts hits and misses itself.
+typedef struct wz_memo_table {
+  int32_t* entries;
+  int32_t capacity;
+  int32_t count;
+  int64_t hits;
+  int64_t misses;
+} wz_memo_table;
+
+// Returns 1 and stores the cached result when the arguments are in the table, 0 otherwise.
+int32_t wz_memo_find(const wz_memo_table* table, const int32_t* args, int32_t arg_count,
+                     int32_t* result);
+// Caches the result, unless the table reached its maximum size.
+void wz_memo_insert(wz_memo_table* table, const int32_t* args, int32_t arg_count, int32_t result);
+// Prints the hits and misses of the cache of the named function to stderr.
+void wz_memo_report(const char* name, int32_t length, const wz_memo_table* table);
+
+// Frame stack of a function compiled with -explicit-stack, `capacity` frames of `frame_size`
+// bytes. Returns a stack at least twice as large holding the same frames, and updates
+// `capacity`; prints an error and exits when there is no memory left.
+void* wz_frames_grow(void* frames, int64_t* capacity, int64_t frame_size);
+void wz_frames_free(void* frames, int64_t capacity, int64_t frame_size);
+
+#ifdef __cplusplus
+}
+#endif
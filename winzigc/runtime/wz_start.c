@@ -0,0 +1,92 @@
+// Process entry point of the freestanding runtime, together with the few libc functions compiled
+// code may call. A freestanding program is linked without libc and without a dynamic loader:
+//
+//   clang -static -nostdlib program.o libwz_runtime_freestanding.a -o program
+//
+// so it starts straight in _start, runs main and leaves with exit_group.
+
+#include "winzigc/runtime/wz_runtime.h"
+#include "winzigc/runtime/wz_system.h"
+
+#ifndef WZ_FREESTANDING
+#error "wz_start.c is only part of the freestanding runtime"
+#endif
+
+int main(void);
+
+// main flushes the output itself before it returns
+__attribute__((noreturn, used)) void wz_start_main(void) {
+  long status = main();
+  while (1) {
+    wz_syscall(SYS_exit_group, status, 0, 0, 0, 0, 0);
+  }
+}
+
+// The kernel starts the process with the stack pointer on argc, it only has to be aligned for
+// the call. Nothing to return to, so the frame and link registers are cleared for debuggers.
+#if defined(__x86_64__)
+__asm__(".text\n"
+        ".global _start\n"
+        ".type _start, @function\n"
+        "_start:\n"
+        "  xor %ebp, %ebp\n"
+        "  and $-16, %rsp\n"
+        "  call wz_start_main\n"
+        "  hlt\n");
+#elif defined(__aarch64__)
+__asm__(".text\n"
+        ".global _start\n"
+        ".type _start, %function\n"
+        "_start:\n"
+        "  mov x29, #0\n"
+        "  mov x30, #0\n"
+        "  bl wz_start_main\n");
+#endif
+
+// The optimizer lowers block copies and fills to these, in the program and in the runtime.
+#if defined(__x86_64__)
+
+__attribute__((used)) void* memcpy(void* destination, const void* source, size_t length) {
+  void* result = destination;
+  __asm__ volatile("rep movsb" : "+D"(destination), "+S"(source), "+c"(length) : : "memory");
+  return result;
+}
+
+__attribute__((used)) void* memset(void* destination, int value, size_t length) {
+  void* result = destination;
+  __asm__ volatile("rep stosb" : "+D"(destination), "+c"(length) : "a"(value) : "memory");
+  return result;
+}
+
+#else
+
+__attribute__((used)) void* memcpy(void* destination, const void* source, size_t length) {
+  char* to = destination;
+  const char* from = source;
+  while (length--) {
+    *to++ = *from++;
+  }
+  return destination;
+}
+
+__attribute__((used)) void* memset(void* destination, int value, size_t length) {
+  char* to = destination;
+  while (length--) {
+    *to++ = (char)value;
+  }
+  return destination;
+}
+
+#endif
+
+__attribute__((used)) void* memmove(void* destination, const void* source, size_t length) {
+  char* to = destination;
+  const char* from = source;
+  if (to <= from || to >= from + length) {
+    return memcpy(destination, source, length);
+  }
+  while (length--) {
+    to[length] = from[length];
+  }
+  return destination;
+}
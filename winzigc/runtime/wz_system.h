@@ -0,0 +1,130 @@
+#pragma once
+
+// The few system calls the runtime library needs. The hosted build goes through libc, the
+// freestanding build (WZ_FREESTANDING) issues them directly and does not link against libc at
+// all. Every call returns its result, or the negated error number on failure, like the kernel.
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef WZ_FREESTANDING
+
+#include <sys/syscall.h>
+
+#if defined(__x86_64__)
+
+static inline long wz_syscall(long number, long a, long b, long c, long d, long e, long f) {
+  register long r10 __asm__("r10") = d;
+  register long r8 __asm__("r8") = e;
+  register long r9 __asm__("r9") = f;
+  long result;
+  __asm__ volatile("syscall"
+                   : "=a"(result)
+                   : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9)
+                   : "rcx", "r11", "memory");
+  return result;
+}
+
+#elif defined(__aarch64__)
+
+static inline long wz_syscall(long number, long a, long b, long c, long d, long e, long f) {
+  register long x8 __asm__("x8") = number;
+  register long x0 __asm__("x0") = a;
+  register long x1 __asm__("x1") = b;
+  register long x2 __asm__("x2") = c;
+  register long x3 __asm__("x3") = d;
+  register long x4 __asm__("x4") = e;
+  register long x5 __asm__("x5") = f;
+  __asm__ volatile("svc 0"
+                   : "+r"(x0)
+                   : "r"(x8), "r"(x1), "r"(x2), "r"(x3), "r"(x4), "r"(x5)
+                   : "memory");
+  return x0;
+}
+
+#else
+#error "the freestanding runtime supports x86-64 and AArch64 Linux"
+#endif
+
+static inline long wz_read(int fd, void* data, size_t length) {
+  return wz_syscall(SYS_read, fd, (long)data, (long)length, 0, 0, 0);
+}
+
+static inline long wz_write(int fd, const void* data, size_t length) {
+  return wz_syscall(SYS_write, fd, (long)data, (long)length, 0, 0, 0);
+}
+
+static inline long wz_fstat(int fd, struct stat* status) {
+  return wz_syscall(SYS_fstat, fd, (long)status, 0, 0, 0, 0);
+}
+
+static inline long wz_lseek(int fd, long offset, int whence) {
+  return wz_syscall(SYS_lseek, fd, offset, whence, 0, 0, 0);
+}
+
+static inline void* wz_mmap(size_t length, int protection, int flags, int fd) {
+  return (void*)wz_syscall(SYS_mmap, 0, (long)length, protection, flags, fd, 0);
+}
+
+static inline long wz_munmap(void* address, size_t length) {
+  return wz_syscall(SYS_munmap, (long)address, (long)length, 0, 0, 0, 0);
+}
+
+static inline void wz_madvise(void* address, size_t length, int advice) {
+  wz_syscall(SYS_madvise, (long)address, (long)length, advice, 0, 0, 0);
+}
+
+static inline int wz_mmap_failed(void* address) {
+  return (uintptr_t)address > (uintptr_t)-4096;
+}
+
+__attribute__((noreturn)) static inline void wz_exit(int status) {
+  while (1) {
+    wz_syscall(SYS_exit_group, status, 0, 0, 0, 0, 0);
+  }
+}
+
+#else
+
+static inline long wz_read(int fd, void* data, size_t length) {
+  ssize_t result = read(fd, data, length);
+  return result < 0 ? -errno : result;
+}
+
+static inline long wz_write(int fd, const void* data, size_t length) {
+  ssize_t result = write(fd, data, length);
+  return result < 0 ? -errno : result;
+}
+
+static inline long wz_fstat(int fd, struct stat* status) {
+  return fstat(fd, status) < 0 ? -errno : 0;
+}
+
+static inline long wz_lseek(int fd, long offset, int whence) {
+  off_t result = lseek(fd, offset, whence);
+  return result < 0 ? -errno : result;
+}
+
+static inline void* wz_mmap(size_t length, int protection, int flags, int fd) {
+  return mmap(NULL, length, protection, flags, fd, 0);
+}
+
+static inline long wz_munmap(void* address, size_t length) {
+  return munmap(address, length) < 0 ? -errno : 0;
+}
+
+static inline void wz_madvise(void* address, size_t length, int advice) {
+  madvise(address, length, advice);
+}
+
+static inline int wz_mmap_failed(void* address) {
+  return address == MAP_FAILED;
+}
+
+__attribute__((noreturn)) static inline void wz_exit(int status) { _exit(status); }
+
+#endif
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace WinZigC {
+namespace Bytecode {
+
+// Every frame owns a window of 32 bit registers. Register 0 holds the return value, the
+// parameters follow it, then the local variables and the temporaries. Registers are typed by the
+// compiler (integer, boolean or char, characters kept sign extended) and the opcodes that care
+// about the type, such as `read` and `output`, come in typed variants. Input and output go through
+// the buffered runtime library, like the input and output of compiled programs. Arrays take
+// consecutive globals or registers, one per element; element opcodes add the register holding the
+// index to their base operand, which has the lower bound of the array already subtracted. Every
+// element access is preceded by a kCheckIndex of the same operands; as in the interpreter, an index
+// out of the bounds is reported, a read of it yields 0 and a write of it is dropped.
+enum class Opcode : uint8_t {
+  kLoadConst,   // r[a] = b
+  kMove,        // r[a] = r[b]
+  kLoadGlobal,  // r[a] = globals[b]
+  kStoreGlobal, // globals[a] = r[b]
+  kLoadGlobalElement,  // r[a] = globals[b + r[c]]
+  kStoreGlobalElement, // globals[a + r[b]] = r[c]
+  kLoadElement,        // r[a] = r[b + r[c]]
+  kStoreElement,       // r[a + r[b]] = r[c]
+  // unless b + r[a] is an element of arrays[c], report it and skip the access that follows
+  kCheckIndex,
+
+  kAdd,    // r[a] = r[b] + r[c]
+  kAddImm, // r[a] = r[b] + c
+  kSub,    // r[a] = r[b] - r[c]
+  kMul,    // r[a] = r[b] * r[c]
+  kDiv,    // r[a] = r[b] / r[c]
+  kMod,    // r[a] = r[b] % r[c]
+  kNeg,    // r[a] = -r[b]
+  kNot,    // r[a] = !r[b]
+  kAnd,    // r[a] = r[b] & r[c]
+  kOr,     // r[a] = r[b] | r[c]
+  kLt,     // r[a] = r[b] < r[c]
+  kLe,     // r[a] = r[b] <= r[c]
+  kGt,     // r[a] = r[b] > r[c]
+  kGe,     // r[a] = r[b] >= r[c]
+  kEq,     // r[a] = r[b] == r[c]
+  kNe,     // r[a] = r[b] != r[c]
+
+  kJump,        // pc = a
+  kJumpIfTrue,  // if (r[a]) pc = b
+  kJumpIfFalse, // if (!r[a]) pc = b
+  // fused compare and branch: if (r[a] <op> r[b]) pc = c
+  kJumpIfLt,
+  kJumpIfLe,
+  kJumpIfGt,
+  kJumpIfGe,
+  kJumpIfEq,
+  kJumpIfNe,
+  kSwitch, // pc = case_tables[b].lookup(r[a])
+
+  kCall,   // r[a] = functions[b](r[c], r[c + 1], ...)
+  kReturn, // return r[0]
+  kHalt,
+
+  kReadInt,         // wz_read_int into r[a], unchanged on failure
+  kReadChar,        // wz_read_char into r[a], unchanged on failure
+  kOutputInt,       // wz_out_int(r[a])
+  kOutputChar,      // wz_out_char(r[a])
+  kOutputText,      // wz_out_text(strings[a])
+  kOutputFormat,    // wz_out_format(strings[a], &r[b])
+};
+
+struct Instruction {
+  Opcode opcode;
+  int32_t a = 0;
+  int32_t b = 0;
+  int32_t c = 0;
+};
+
+struct CaseRange {
+  int32_t low;
+  int32_t high;
+  int32_t target;
+};
+
+// Case tables are dense jump tables indexed by `value - low` when the labels are close together,
+// otherwise the sorted label ranges are binary searched.
+struct CaseTable {
+  int32_t low = 0;
+  int32_t default_target = 0;
+  std::vector<int32_t> dense_targets;
+  std::vector<CaseRange> ranges;
+};
+
+struct Array {
+  std::string name;
+  // the global index or register of the first element
+  int32_t first;
+  int32_t lower;
+  int32_t size;
+};
+
+struct Function {
+  std::string name;
+  int32_t entry = 0;
+  int32_t param_count = 0;
+  int32_t frame_size = 0;
+};
+
+struct Program {
+  std::vector<Instruction> code;
+  std::vector<Function> functions;
+  std::vector<CaseTable> case_tables;
+  std::vector<Array> arrays;
+  std::vector<std::string> strings;
+  int32_t global_count = 0;
+  // main runs as the frame of this pseudo function
+  Function main;
+};
+
+} // namespace Bytecode
+} // namespace WinZigC
@@ -0,0 +1,795 @@
+#include <algorithm>
+
+#include "winzigc/visitor/bytecode/bytecode_compiler_visitor.h"
+
+#include "glog/logging.h"
+#include "winzigc/common/case_ranges.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+namespace {
+
+// wider label spans are binary searched instead of getting a jump table
+constexpr int64_t kMaxDenseCaseSpan = 1024;
+
+bool writes_register_a(Bytecode::Opcode opcode) {
+  switch (opcode) {
+  case Bytecode::Opcode::kLoadConst:
+  case Bytecode::Opcode::kMove:
+  case Bytecode::Opcode::kLoadGlobal:
+  case Bytecode::Opcode::kLoadGlobalElement:
+  case Bytecode::Opcode::kLoadElement:
+  case Bytecode::Opcode::kAdd:
+  case Bytecode::Opcode::kAddImm:
+  case Bytecode::Opcode::kSub:
+  case Bytecode::Opcode::kMul:
+  case Bytecode::Opcode::kDiv:
+  case Bytecode::Opcode::kMod:
+  case Bytecode::Opcode::kNeg:
+  case Bytecode::Opcode::kNot:
+  case Bytecode::Opcode::kAnd:
+  case Bytecode::Opcode::kOr:
+  case Bytecode::Opcode::kLt:
+  case Bytecode::Opcode::kLe:
+  case Bytecode::Opcode::kGt:
+  case Bytecode::Opcode::kGe:
+  case Bytecode::Opcode::kEq:
+  case Bytecode::Opcode::kNe:
+  case Bytecode::Opcode::kCall:
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+Bytecode::Program BytecodeCompilerVisitor::compile(const Frontend::AST::Program& program) {
+  program.accept(*this);
+  return std::move(bytecode);
+}
+
+int32_t BytecodeCompilerVisitor::emit(Bytecode::Opcode opcode, int32_t a, int32_t b, int32_t c) {
+  bytecode.code.push_back({opcode, a, b, c});
+  return bytecode.code.size() - 1;
+}
+
+int32_t BytecodeCompilerVisitor::current_pc() const { return bytecode.code.size(); }
+
+void BytecodeCompilerVisitor::patch_target(int32_t instruction, int32_t target) {
+  last_jump_target = std::max(last_jump_target, target);
+  Bytecode::Instruction& branch = bytecode.code[instruction];
+  switch (branch.opcode) {
+  case Bytecode::Opcode::kJump:
+    branch.a = target;
+    break;
+  case Bytecode::Opcode::kJumpIfTrue:
+  case Bytecode::Opcode::kJumpIfFalse:
+    branch.b = target;
+    break;
+  default:
+    branch.c = target;
+  }
+}
+
+int32_t BytecodeCompilerVisitor::allocate_register() {
+  int32_t reg = next_register++;
+  frame_size = std::max(frame_size, next_register);
+  return reg;
+}
+
+int32_t BytecodeCompilerVisitor::compile_expression(const Frontend::AST::Expression& expression) {
+  expression.accept(*this);
+  return result_register;
+}
+
+void BytecodeCompilerVisitor::compile_statements(
+    const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements) {
+  for (const auto& statement : statements) {
+    int32_t statement_register = next_register;
+    statement->accept(*this);
+    next_register = statement_register;
+  }
+}
+
+void BytecodeCompilerVisitor::move_result(int32_t destination, int32_t source) {
+  if (destination == source) {
+    return;
+  }
+  // a temporary that was just computed can be written to its destination directly, unless a jump
+  // lands right after it and other paths computed the temporary differently
+  if (source >= first_temporary && !bytecode.code.empty() && last_jump_target != current_pc() &&
+      bytecode.code.back().a == source && writes_register_a(bytecode.code.back().opcode)) {
+    bytecode.code.back().a = destination;
+    return;
+  }
+  emit(Bytecode::Opcode::kMove, destination, source);
+}
+
+void BytecodeCompilerVisitor::store_variable(const std::string& name, int32_t source) {
+  if (local_variables.find(name) != local_variables.end()) {
+    move_result(local_variables[name], source);
+  } else if (global_indices.find(name) != global_indices.end()) {
+    emit(Bytecode::Opcode::kStoreGlobal, global_indices[name], source);
+  } else {
+    LOG(ERROR) << "Unknown variable: " << name;
+  }
+}
+
+int32_t BytecodeCompilerVisitor::add_array_bounds(const std::string& name, int32_t first,
+                                                  int32_t lower, int64_t size) {
+  bytecode.arrays.push_back({name, first, lower, static_cast<int32_t>(size)});
+  return bytecode.arrays.size() - 1;
+}
+
+// The index is evaluated once, so an element that is read and then written back is addressed by
+// the same registers.
+BytecodeCompilerVisitor::ElementAddress
+BytecodeCompilerVisitor::compile_element_address(const Frontend::AST::IndexExpression& element) {
+  int32_t offset = compile_expression(element.get_index());
+  const std::string& name = element.get_name();
+  bool global = local_arrays.find(name) == local_arrays.end();
+  if (global && global_arrays.find(name) == global_arrays.end()) {
+    LOG(ERROR) << "Unknown array: " << name;
+    return {true, 0, offset, -1};
+  }
+  const ArrayVariable& array = global ? global_arrays[name] : local_arrays[name];
+  // the semantic check keeps constant indices within the bounds
+  int32_t bounds =
+      dynamic_cast<const Frontend::AST::IntegerExpression*>(&element.get_index()) ? -1
+                                                                                   : array.bounds;
+  // the lower bound is folded into the base unless that overflows the operand
+  int64_t base = static_cast<int64_t>(array.first) - array.lower;
+  if (base >= INT32_MIN && base <= INT32_MAX) {
+    return {global, static_cast<int32_t>(base), offset, bounds};
+  }
+  int32_t index = offset;
+  offset = allocate_register();
+  emit(Bytecode::Opcode::kAddImm, offset, index, static_cast<int32_t>(0u - array.lower));
+  return {global, array.first, offset, bounds};
+}
+
+// The check has to come right before the access, which it skips when the index is out of bounds.
+int32_t BytecodeCompilerVisitor::load_element(const ElementAddress& address) {
+  int32_t reg = allocate_register();
+  if (address.bounds >= 0) {
+    emit(Bytecode::Opcode::kCheckIndex, address.offset, address.base, address.bounds);
+  }
+  emit(address.global ? Bytecode::Opcode::kLoadGlobalElement : Bytecode::Opcode::kLoadElement,
+       reg, address.base, address.offset);
+  return reg;
+}
+
+void BytecodeCompilerVisitor::store_element(const ElementAddress& address, int32_t source) {
+  if (address.bounds >= 0) {
+    emit(Bytecode::Opcode::kCheckIndex, address.offset, address.base, address.bounds);
+  }
+  emit(address.global ? Bytecode::Opcode::kStoreGlobalElement : Bytecode::Opcode::kStoreElement,
+       address.base, address.offset, source);
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::Program& program) {
+  for (const auto& constant : program.get_constants()) {
+    constant->accept(*this);
+  }
+  for (const auto& user_type : program.get_user_types()) {
+    user_type->accept(*this);
+  }
+  program.get_discard_variable()->accept(*this);
+  for (const auto& var : program.get_variables()) {
+    var->accept(*this);
+  }
+
+  // functions can be called before their code is emitted, so every index is known up front
+  for (const auto& function : program.get_functions()) {
+    function_indices[function->get_name()] = bytecode.functions.size();
+    bytecode.functions.push_back({function->get_name()});
+  }
+
+  bytecode.main = {program.get_name(), current_pc(), 0, 0};
+  local_variables.clear();
+  local_arrays.clear();
+  first_temporary = next_register = frame_size = 0;
+  compile_statements(program.get_statements());
+  emit(Bytecode::Opcode::kHalt);
+  bytecode.main.frame_size = frame_size;
+
+  for (const auto& function : program.get_functions()) {
+    function->accept(*this);
+  }
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::Function& function) {
+  Bytecode::Function& bytecode_function = bytecode.functions[function_indices[function.get_name()]];
+  bytecode_function.entry = current_pc();
+  bytecode_function.param_count = function.get_parameters().size();
+
+  local_variables.clear();
+  local_arrays.clear();
+  local_user_def_type_consts.clear();
+  next_register = frame_size = 0;
+  local_variables[function.get_name()] = allocate_register();
+  for (const auto& param : function.get_parameters()) {
+    param->accept(*this);
+  }
+  for (const auto& constant : function.get_constants()) {
+    constant->accept(*this);
+  }
+  for (const auto& type_def : function.get_type_defs()) {
+    type_def->accept(*this);
+  }
+  for (const auto& local_var : function.get_local_var_dclns()) {
+    local_var->accept(*this);
+  }
+  first_temporary = next_register;
+
+  compile_statements(function.get_function_body_exprs());
+  emit(Bytecode::Opcode::kReturn);
+  bytecode_function.frame_size = frame_size;
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::GlobalVariable& expression) {
+  int32_t index = bytecode.global_count;
+  global_indices[expression.get_name()] = index;
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&expression.get_type())) {
+    global_arrays[expression.get_name()] = {
+        index, array_type->get_lower(),
+        add_array_bounds(expression.get_name(), index, array_type->get_lower(),
+                         array_type->get_size())};
+    bytecode.global_count += array_type->get_size();
+    return;
+  }
+  bytecode.global_count++;
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::LocalVariable& expression) {
+  // frames start zeroed, which is the default value of every type
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&expression.get_type())) {
+    local_arrays[expression.get_name()] = {
+        next_register, array_type->get_lower(),
+        add_array_bounds(expression.get_name(), next_register, array_type->get_lower(),
+                         array_type->get_size())};
+    for (int64_t element = 0; element < array_type->get_size(); element++) {
+      allocate_register();
+    }
+    return;
+  }
+  local_variables[expression.get_name()] = allocate_register();
+}
+
+// The value of a constant is a literal or names an earlier constant, the case labels are made of
+// the same.
+void BytecodeCompilerVisitor::visit(const Frontend::AST::GlobalConstant& expression) {
+  int32_t value = 0;
+  if (!get_case_label(expression.get_value(), value)) {
+    LOG(ERROR) << "Unknown constant value: " << expression.get_name();
+  }
+  global_user_def_type_consts[expression.get_name()] = value;
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::LocalConstant& expression) {
+  int32_t value = 0;
+  if (!get_case_label(expression.get_value(), value)) {
+    LOG(ERROR) << "Unknown constant value: " << expression.get_name();
+  }
+  int32_t reg = allocate_register();
+  emit(Bytecode::Opcode::kLoadConst, reg, value);
+  local_variables[expression.get_name()] = reg;
+  local_user_def_type_consts[expression.get_name()] = value;
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::GlobalUserTypeDef& expression) {
+  for (size_t value_index = 0; value_index < expression.get_value_names().size(); value_index++) {
+    global_user_def_type_consts[expression.get_value_names().at(value_index)] = value_index;
+  }
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::LocalUserTypeDef& expression) {
+  for (size_t value_index = 0; value_index < expression.get_value_names().size(); value_index++) {
+    const std::string& value_name = expression.get_value_names().at(value_index);
+    int32_t reg = allocate_register();
+    emit(Bytecode::Opcode::kLoadConst, reg, value_index);
+    local_variables[value_name] = reg;
+    local_user_def_type_consts[value_name] = value_index;
+  }
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::IntegerExpression& expression) {
+  result_register = allocate_register();
+  emit(Bytecode::Opcode::kLoadConst, result_register, expression.get_value());
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::BooleanExpression& expression) {
+  result_register = allocate_register();
+  emit(Bytecode::Opcode::kLoadConst, result_register, expression.get_bool() ? 1 : 0);
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::CharacterExpression& expression) {
+  result_register = allocate_register();
+  emit(Bytecode::Opcode::kLoadConst, result_register,
+       static_cast<int8_t>(expression.get_character()));
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::CallExpression& expression) {
+  if (expression.get_name() == "output") {
+    compile_output_call(expression);
+    return;
+  } else if (expression.get_name() == "read") {
+    compile_read_call(expression);
+    return;
+  }
+
+  if (function_indices.find(expression.get_name()) == function_indices.end()) {
+    LOG(ERROR) << "Unknown function referenced";
+    return;
+  }
+  // arguments go to consecutive registers, the callee copies them into its own frame
+  int32_t first_arg = next_register;
+  for (size_t i = 0; i < expression.get_arguments().size(); i++) {
+    allocate_register();
+  }
+  for (size_t i = 0; i < expression.get_arguments().size(); i++) {
+    move_result(first_arg + i, compile_expression(*expression.get_arguments()[i]));
+  }
+  result_register = allocate_register();
+  emit(Bytecode::Opcode::kCall, result_register, function_indices[expression.get_name()],
+       first_arg);
+}
+
+void BytecodeCompilerVisitor::compile_read_call(const Frontend::AST::CallExpression& expression) {
+  for (const auto& arg : expression.get_arguments()) {
+    const Frontend::AST::IdentifierExpression* var_identifier =
+        dynamic_cast<const Frontend::AST::IdentifierExpression*>(arg.get());
+    if (!var_identifier) {
+      LOG(ERROR) << "'read' called with non global variable";
+      continue;
+    }
+    Bytecode::Opcode opcode;
+    if (var_identifier->get_type_info() == "integer") {
+      opcode = Bytecode::Opcode::kReadInt;
+    } else if (var_identifier->get_type_info() == "char") {
+      opcode = Bytecode::Opcode::kReadChar;
+    } else {
+      LOG(ERROR) << "Unsupported variable type";
+      return;
+    }
+    // a failed read leaves the variable unchanged, so globals are read through their old value
+    if (const Frontend::AST::IndexExpression* element =
+            dynamic_cast<const Frontend::AST::IndexExpression*>(var_identifier)) {
+      ElementAddress address = compile_element_address(*element);
+      int32_t reg = load_element(address);
+      emit(opcode, reg);
+      store_element(address, reg);
+      continue;
+    }
+    int32_t reg = compile_expression(*var_identifier);
+    emit(opcode, reg);
+    if (global_indices.find(var_identifier->get_name()) != global_indices.end()) {
+      emit(Bytecode::Opcode::kStoreGlobal, global_indices[var_identifier->get_name()], reg);
+    }
+  }
+}
+
+void BytecodeCompilerVisitor::compile_output_call(const Frontend::AST::CallExpression& expression) {
+  const auto& arguments = expression.get_arguments();
+  if (arguments.size() == 1) {
+    int32_t reg = compile_expression(*arguments[0]);
+    emit(arguments[0]->get_type_info() == "char" ? Bytecode::Opcode::kOutputChar
+                                                 : Bytecode::Opcode::kOutputInt,
+         reg);
+    return;
+  }
+
+  // all arguments are evaluated into consecutive registers before anything is printed, like in
+  // the compiled code; character literals become part of the format
+  std::string format;
+  std::string text;
+  std::vector<const Frontend::AST::Expression*> value_arguments;
+  for (const auto& arg : arguments) {
+    if (const Frontend::AST::CharacterExpression* character =
+            dynamic_cast<const Frontend::AST::CharacterExpression*>(arg.get())) {
+      char value = character->get_character();
+      format += value == '%' ? "%%" : std::string(1, value);
+      text += value;
+    } else {
+      format += arg->get_type_info() == "char" ? "%c" : "%d ";
+      value_arguments.push_back(arg.get());
+    }
+  }
+  format += "\n";
+  text += "\n";
+
+  if (value_arguments.empty()) {
+    emit(Bytecode::Opcode::kOutputText, intern_string(text));
+    return;
+  }
+  int32_t first_value = next_register;
+  for (size_t i = 0; i < value_arguments.size(); i++) {
+    allocate_register();
+  }
+  for (size_t i = 0; i < value_arguments.size(); i++) {
+    move_result(first_value + i, compile_expression(*value_arguments[i]));
+  }
+  emit(Bytecode::Opcode::kOutputFormat, intern_string(format), first_value);
+}
+
+int32_t BytecodeCompilerVisitor::intern_string(const std::string& text) {
+  auto string = std::find(bytecode.strings.begin(), bytecode.strings.end(), text);
+  if (string == bytecode.strings.end()) {
+    string = bytecode.strings.insert(bytecode.strings.end(), text);
+  }
+  return string - bytecode.strings.begin();
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::IdentifierExpression& expression) {
+  const std::string& name = expression.get_name();
+  if (local_variables.find(name) != local_variables.end()) {
+    result_register = local_variables[name];
+  } else if (global_indices.find(name) != global_indices.end()) {
+    result_register = allocate_register();
+    emit(Bytecode::Opcode::kLoadGlobal, result_register, global_indices[name]);
+  } else if (global_user_def_type_consts.find(name) != global_user_def_type_consts.end()) {
+    result_register = allocate_register();
+    emit(Bytecode::Opcode::kLoadConst, result_register, global_user_def_type_consts[name]);
+  } else {
+    LOG(ERROR) << "Unknown variable: " << name;
+    result_register = allocate_register();
+  }
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::IndexExpression& expression) {
+  result_register = load_element(compile_element_address(expression));
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::AssignmentExpression& expression) {
+  if (const Frontend::AST::IndexExpression* element =
+          dynamic_cast<const Frontend::AST::IndexExpression*>(&expression.get_name())) {
+    ElementAddress address = compile_element_address(*element);
+    store_element(address, compile_expression(expression.get_expression()));
+    return;
+  }
+  store_variable(expression.get_name().get_name(), compile_expression(expression.get_expression()));
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::SwapExpression& expression) {
+  const Frontend::AST::IndexExpression* lhs_element =
+      dynamic_cast<const Frontend::AST::IndexExpression*>(&expression.get_lhs());
+  const Frontend::AST::IndexExpression* rhs_element =
+      dynamic_cast<const Frontend::AST::IndexExpression*>(&expression.get_rhs());
+  ElementAddress lhs_address{};
+  ElementAddress rhs_address{};
+  int32_t value1 = allocate_register();
+  int32_t value2 = allocate_register();
+  if (lhs_element) {
+    lhs_address = compile_element_address(*lhs_element);
+    move_result(value1, load_element(lhs_address));
+  } else {
+    emit(Bytecode::Opcode::kMove, value1, compile_expression(expression.get_lhs()));
+  }
+  if (rhs_element) {
+    rhs_address = compile_element_address(*rhs_element);
+    move_result(value2, load_element(rhs_address));
+  } else {
+    emit(Bytecode::Opcode::kMove, value2, compile_expression(expression.get_rhs()));
+  }
+  // elements are stored first, their offset may be the register of the other variable
+  if (lhs_element) {
+    store_element(lhs_address, value2);
+  }
+  if (rhs_element) {
+    store_element(rhs_address, value1);
+  }
+  if (!lhs_element) {
+    store_variable(expression.get_lhs().get_name(), value2);
+  }
+  if (!rhs_element) {
+    store_variable(expression.get_rhs().get_name(), value1);
+  }
+}
+
+int32_t BytecodeCompilerVisitor::compile_branch(const Frontend::AST::Expression& condition,
+                                                bool when) {
+  if (const Frontend::AST::BinaryExpression* comparison =
+          dynamic_cast<const Frontend::AST::BinaryExpression*>(&condition)) {
+    Bytecode::Opcode taken;
+    Bytecode::Opcode not_taken;
+    switch (comparison->get_op()) {
+    case Frontend::AST::BinaryOperation::kLessThan:
+      taken = Bytecode::Opcode::kJumpIfLt;
+      not_taken = Bytecode::Opcode::kJumpIfGe;
+      break;
+    case Frontend::AST::BinaryOperation::kLessThanOrEqual:
+      taken = Bytecode::Opcode::kJumpIfLe;
+      not_taken = Bytecode::Opcode::kJumpIfGt;
+      break;
+    case Frontend::AST::BinaryOperation::kGreaterThan:
+      taken = Bytecode::Opcode::kJumpIfGt;
+      not_taken = Bytecode::Opcode::kJumpIfLe;
+      break;
+    case Frontend::AST::BinaryOperation::kGreaterThanOrEqual:
+      taken = Bytecode::Opcode::kJumpIfGe;
+      not_taken = Bytecode::Opcode::kJumpIfLt;
+      break;
+    case Frontend::AST::BinaryOperation::kEqual:
+      taken = Bytecode::Opcode::kJumpIfEq;
+      not_taken = Bytecode::Opcode::kJumpIfNe;
+      break;
+    case Frontend::AST::BinaryOperation::kNotEqual:
+      taken = Bytecode::Opcode::kJumpIfNe;
+      not_taken = Bytecode::Opcode::kJumpIfEq;
+      break;
+    default:
+      taken = not_taken = Bytecode::Opcode::kHalt;
+    }
+    if (taken != Bytecode::Opcode::kHalt) {
+      int32_t lhs = compile_expression(comparison->get_lhs());
+      int32_t rhs = compile_expression(comparison->get_rhs());
+      return emit(when ? taken : not_taken, lhs, rhs);
+    }
+  }
+  if (const Frontend::AST::UnaryExpression* negation =
+          dynamic_cast<const Frontend::AST::UnaryExpression*>(&condition)) {
+    if (negation->get_op() == Frontend::AST::UnaryOperation::kNot) {
+      return compile_branch(negation->get_expression(), !when);
+    }
+  }
+  int32_t reg = compile_expression(condition);
+  return emit(when ? Bytecode::Opcode::kJumpIfTrue : Bytecode::Opcode::kJumpIfFalse, reg);
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::IfExpression& expression) {
+  int32_t else_branch = compile_branch(expression.get_condition(), false);
+  compile_statements(expression.get_then_statement());
+  if (expression.get_else_statement().empty()) {
+    patch_target(else_branch, current_pc());
+    return;
+  }
+  int32_t merge_branch = emit(Bytecode::Opcode::kJump);
+  patch_target(else_branch, current_pc());
+  compile_statements(expression.get_else_statement());
+  patch_target(merge_branch, current_pc());
+}
+
+// Loops test their condition at the bottom, so an iteration costs a single fused branch.
+void BytecodeCompilerVisitor::visit(const Frontend::AST::ForExpression& expression) {
+  expression.get_start_assignment().accept(*this);
+  int32_t cond_branch = emit(Bytecode::Opcode::kJump);
+  int32_t body_pc = current_pc();
+  compile_statements(expression.get_body_statements());
+  expression.get_end_assignment().accept(*this);
+  patch_target(cond_branch, current_pc());
+  patch_target(compile_branch(expression.get_condition(), true), body_pc);
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::RepeatUntilExpression& expression) {
+  int32_t body_pc = current_pc();
+  compile_statements(expression.get_body_statements());
+  patch_target(compile_branch(expression.get_condition(), false), body_pc);
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::WhileExpression& expression) {
+  int32_t cond_branch = emit(Bytecode::Opcode::kJump);
+  int32_t body_pc = current_pc();
+  compile_statements(expression.get_body_statements());
+  patch_target(cond_branch, current_pc());
+  patch_target(compile_branch(expression.get_condition(), true), body_pc);
+}
+
+bool BytecodeCompilerVisitor::get_case_label(const Frontend::AST::Expression& expression,
+                                             int32_t& label) {
+  if (const Frontend::AST::IdentifierExpression* const_identifier =
+          dynamic_cast<const Frontend::AST::IdentifierExpression*>(&expression)) {
+    const std::string& name = const_identifier->get_name();
+    if (local_user_def_type_consts.find(name) != local_user_def_type_consts.end()) {
+      label = local_user_def_type_consts[name];
+    } else if (global_user_def_type_consts.find(name) != global_user_def_type_consts.end()) {
+      label = global_user_def_type_consts[name];
+    } else {
+      return false;
+    }
+  } else if (const Frontend::AST::IntegerExpression* integer =
+                 dynamic_cast<const Frontend::AST::IntegerExpression*>(&expression)) {
+    label = integer->get_value();
+  } else if (const Frontend::AST::CharacterExpression* character =
+                 dynamic_cast<const Frontend::AST::CharacterExpression*>(&expression)) {
+    label = static_cast<int8_t>(character->get_character());
+  } else if (const Frontend::AST::BooleanExpression* boolean =
+                 dynamic_cast<const Frontend::AST::BooleanExpression*>(&expression)) {
+    label = boolean->get_bool() ? 1 : 0;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Bytecode::CaseTable
+BytecodeCompilerVisitor::build_case_table(std::vector<Bytecode::CaseRange> ranges,
+                                          int32_t default_target) {
+  Bytecode::CaseTable table;
+  table.default_target = default_target;
+  // the first arm listing a label wins, as it does in the interpreter
+  std::vector<LabelRange<int32_t>> arm_ranges;
+  for (const auto& range : ranges) {
+    arm_ranges.push_back({range.low, range.high, range.target});
+  }
+  std::vector<LabelRange<int32_t>> disjoint = disjoint_label_ranges(arm_ranges);
+  if (disjoint.empty()) {
+    return table;
+  }
+  int64_t low = disjoint.front().low;
+  int64_t high = disjoint.back().high;
+  if (high - low < kMaxDenseCaseSpan) {
+    table.low = low;
+    table.dense_targets.assign(high - low + 1, default_target);
+    for (const auto& range : disjoint) {
+      std::fill(table.dense_targets.begin() + (range.low - low),
+                table.dense_targets.begin() + (range.high - low + 1), range.target);
+    }
+    return table;
+  }
+  for (const auto& range : disjoint) {
+    table.ranges.push_back({static_cast<int32_t>(range.low), static_cast<int32_t>(range.high),
+                            range.target});
+  }
+  return table;
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::CaseExpression& expression) {
+  int32_t switch_register = compile_expression(expression.get_expression());
+  int32_t switch_instruction = emit(Bytecode::Opcode::kSwitch, switch_register);
+
+  std::vector<Bytecode::CaseRange> ranges;
+  std::vector<int32_t> exit_branches;
+  for (const auto& case_clause : expression.get_cases()) {
+    int32_t arm_pc = current_pc();
+    const auto& case_value = case_clause.first;
+    int32_t low = 0;
+    int32_t high = 0;
+    bool valid_label = false;
+    if (std::holds_alternative<std::unique_ptr<Frontend::AST::Expression>>(case_value)) {
+      valid_label =
+          get_case_label(*std::get<std::unique_ptr<Frontend::AST::Expression>>(case_value), low);
+      high = low;
+    } else {
+      const auto& range =
+          std::get<std::pair<std::unique_ptr<Frontend::AST::Expression>,
+                             std::unique_ptr<Frontend::AST::Expression>>>(case_value);
+      valid_label = get_case_label(*range.first, low) && get_case_label(*range.second, high);
+    }
+    if (!valid_label) {
+      LOG(ERROR) << "Unknown case value";
+    } else if (low <= high) {
+      ranges.push_back({low, high, arm_pc});
+    }
+    compile_statements(case_clause.second);
+    exit_branches.push_back(emit(Bytecode::Opcode::kJump));
+  }
+
+  // as in the compiled code the otherwise statements sit on the case exit, so arms that do not
+  // return run them as well
+  int32_t exit_pc = current_pc();
+  for (int32_t exit_branch : exit_branches) {
+    patch_target(exit_branch, exit_pc);
+  }
+  bytecode.code[switch_instruction].b = bytecode.case_tables.size();
+  bytecode.case_tables.push_back(build_case_table(std::move(ranges), exit_pc));
+  compile_statements(expression.get_otherwise_clause());
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::ReturnExpression& expression) {
+  move_result(0, compile_expression(expression.get_expression()));
+  emit(Bytecode::Opcode::kReturn);
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::BinaryExpression& expression) {
+  if (short_circuit && (expression.get_op() == Frontend::AST::BinaryOperation::kAnd ||
+                        expression.get_op() == Frontend::AST::BinaryOperation::kOr)) {
+    // the left operand is the result when it decides it, the right one is skipped
+    int32_t result = allocate_register();
+    move_result(result, compile_expression(expression.get_lhs()));
+    int32_t skip = emit(expression.get_op() == Frontend::AST::BinaryOperation::kAnd
+                            ? Bytecode::Opcode::kJumpIfFalse
+                            : Bytecode::Opcode::kJumpIfTrue,
+                        result);
+    move_result(result, compile_expression(expression.get_rhs()));
+    patch_target(skip, current_pc());
+    result_register = result;
+    return;
+  }
+  int32_t lhs = compile_expression(expression.get_lhs());
+  // additions and subtractions of a literal are folded into the instruction
+  const Frontend::AST::IntegerExpression* immediate =
+      dynamic_cast<const Frontend::AST::IntegerExpression*>(&expression.get_rhs());
+  if (immediate && (expression.get_op() == Frontend::AST::BinaryOperation::kAdd ||
+                    expression.get_op() == Frontend::AST::BinaryOperation::kSubtract)) {
+    int32_t value = immediate->get_value();
+    result_register = allocate_register();
+    emit(Bytecode::Opcode::kAddImm, result_register, lhs,
+         expression.get_op() == Frontend::AST::BinaryOperation::kAdd
+             ? value
+             : static_cast<int32_t>(0u - value));
+    return;
+  }
+  int32_t rhs = compile_expression(expression.get_rhs());
+
+  Bytecode::Opcode opcode;
+  switch (expression.get_op()) {
+  case Frontend::AST::BinaryOperation::kAdd:
+    opcode = Bytecode::Opcode::kAdd;
+    break;
+  case Frontend::AST::BinaryOperation::kSubtract:
+    opcode = Bytecode::Opcode::kSub;
+    break;
+  case Frontend::AST::BinaryOperation::kMultiply:
+    opcode = Bytecode::Opcode::kMul;
+    break;
+  case Frontend::AST::BinaryOperation::kDivide:
+    opcode = Bytecode::Opcode::kDiv;
+    break;
+  case Frontend::AST::BinaryOperation::kModulo:
+    opcode = Bytecode::Opcode::kMod;
+    break;
+  case Frontend::AST::BinaryOperation::kLessThan:
+    opcode = Bytecode::Opcode::kLt;
+    break;
+  case Frontend::AST::BinaryOperation::kLessThanOrEqual:
+    opcode = Bytecode::Opcode::kLe;
+    break;
+  case Frontend::AST::BinaryOperation::kGreaterThan:
+    opcode = Bytecode::Opcode::kGt;
+    break;
+  case Frontend::AST::BinaryOperation::kGreaterThanOrEqual:
+    opcode = Bytecode::Opcode::kGe;
+    break;
+  case Frontend::AST::BinaryOperation::kEqual:
+    opcode = Bytecode::Opcode::kEq;
+    break;
+  case Frontend::AST::BinaryOperation::kNotEqual:
+    opcode = Bytecode::Opcode::kNe;
+    break;
+  case Frontend::AST::BinaryOperation::kAnd:
+    opcode = Bytecode::Opcode::kAnd;
+    break;
+  case Frontend::AST::BinaryOperation::kOr:
+    opcode = Bytecode::Opcode::kOr;
+    break;
+  default:
+    LOG(ERROR) << "Unknown binary operation";
+    return;
+  }
+  result_register = allocate_register();
+  emit(opcode, result_register, lhs, rhs);
+}
+
+void BytecodeCompilerVisitor::visit(const Frontend::AST::UnaryExpression& expression) {
+  int32_t operand = compile_expression(expression.get_expression());
+  switch (expression.get_op()) {
+  case Frontend::AST::UnaryOperation::kMinus:
+    result_register = allocate_register();
+    emit(Bytecode::Opcode::kNeg, result_register, operand);
+    break;
+  case Frontend::AST::UnaryOperation::kPlus:
+    result_register = operand;
+    break;
+  case Frontend::AST::UnaryOperation::kNot:
+    result_register = allocate_register();
+    emit(Bytecode::Opcode::kNot, result_register, operand);
+    break;
+  case Frontend::AST::UnaryOperation::kSucc:
+    result_register = allocate_register();
+    emit(Bytecode::Opcode::kAddImm, result_register, operand, 1);
+    break;
+  case Frontend::AST::UnaryOperation::kPred:
+    result_register = allocate_register();
+    emit(Bytecode::Opcode::kAddImm, result_register, operand, -1);
+    break;
+  default:
+    LOG(ERROR) << "Unknown unary operation";
+  }
+}
+
+} // namespace Visitor
+} // namespace WinZigC
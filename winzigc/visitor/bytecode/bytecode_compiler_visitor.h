@@ -0,0 +1,119 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "winzigc/frontend/ast/visitor.h"
+#include "winzigc/visitor/bytecode/bytecode.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+// Lowers the checked AST to the register based bytecode of `Bytecode::Program`, without going
+// through LLVM. Variables live in fixed registers and expression temporaries are allocated
+// stack-wise above them and released after every statement.
+class BytecodeCompilerVisitor : public Frontend::AST::Visitor {
+public:
+  // `short_circuit` selects whether `and` and `or` skip their right operand when the left one
+  // decides the result, or always evaluate both operands.
+  BytecodeCompilerVisitor(bool short_circuit = true) : short_circuit(short_circuit) {}
+  ~BytecodeCompilerVisitor() = default;
+
+  Bytecode::Program compile(const Frontend::AST::Program& program);
+
+  void visit(const Frontend::AST::Program& program) override;
+  void visit(const Frontend::AST::Function& function) override;
+
+  void visit(const Frontend::AST::IntegerExpression& expression) override;
+  void visit(const Frontend::AST::BooleanExpression& expression) override;
+  void visit(const Frontend::AST::CharacterExpression& expression) override;
+
+  void visit(const Frontend::AST::CallExpression& expression) override;
+  void compile_read_call(const Frontend::AST::CallExpression& expression);
+  void compile_output_call(const Frontend::AST::CallExpression& expression);
+  int32_t intern_string(const std::string& text);
+
+  void visit(const Frontend::AST::IdentifierExpression& expression) override;
+  void visit(const Frontend::AST::IndexExpression& expression) override;
+  void visit(const Frontend::AST::AssignmentExpression& expression) override;
+  void visit(const Frontend::AST::SwapExpression& expression) override;
+  void visit(const Frontend::AST::IfExpression& expression) override;
+  void visit(const Frontend::AST::ForExpression& expression) override;
+  void visit(const Frontend::AST::RepeatUntilExpression& expression) override;
+  void visit(const Frontend::AST::WhileExpression& expression) override;
+  void visit(const Frontend::AST::CaseExpression& expression) override;
+  void visit(const Frontend::AST::ReturnExpression& expression) override;
+  void visit(const Frontend::AST::BinaryExpression& expression) override;
+  void visit(const Frontend::AST::UnaryExpression& expression) override;
+
+  void visit(const Frontend::AST::LocalVariable& expression) override;
+  void visit(const Frontend::AST::GlobalVariable& expression) override;
+
+  void visit(const Frontend::AST::LocalConstant& expression) override;
+  void visit(const Frontend::AST::GlobalConstant& expression) override;
+
+  void visit(const Frontend::AST::LocalUserTypeDef& expression) override;
+  void visit(const Frontend::AST::GlobalUserTypeDef& expression) override;
+
+  void visit(const Frontend::AST::IntegerType& expression) override{};
+  void visit(const Frontend::AST::BooleanType& expression) override{};
+  void visit(const Frontend::AST::CharacterType& expression) override{};
+  void visit(const Frontend::AST::UserType& expression) override{};
+  void visit(const Frontend::AST::ArrayType& expression) override{};
+
+private:
+  struct ArrayVariable {
+    // the global index or register of the first element
+    int32_t first;
+    int32_t lower;
+    // the bounds in Program::arrays
+    int32_t bounds;
+  };
+  // Operands of the element opcodes: the base the offset register is added to.
+  struct ElementAddress {
+    bool global;
+    int32_t base;
+    int32_t offset;
+    int32_t bounds;
+  };
+
+  int32_t emit(Bytecode::Opcode opcode, int32_t a = 0, int32_t b = 0, int32_t c = 0);
+  int32_t current_pc() const;
+  void patch_target(int32_t instruction, int32_t target);
+  int32_t allocate_register();
+  int32_t compile_expression(const Frontend::AST::Expression& expression);
+  void
+  compile_statements(const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements);
+  // Emits a branch to be patched later, taken when the condition evaluates to `when`.
+  int32_t compile_branch(const Frontend::AST::Expression& condition, bool when);
+  void store_variable(const std::string& name, int32_t source);
+  int32_t add_array_bounds(const std::string& name, int32_t first, int32_t lower, int64_t size);
+  ElementAddress compile_element_address(const Frontend::AST::IndexExpression& element);
+  int32_t load_element(const ElementAddress& address);
+  void store_element(const ElementAddress& address, int32_t source);
+  void move_result(int32_t destination, int32_t source);
+  bool get_case_label(const Frontend::AST::Expression& expression, int32_t& label);
+  Bytecode::CaseTable build_case_table(std::vector<Bytecode::CaseRange> ranges,
+                                       int32_t default_target);
+
+  bool short_circuit;
+  Bytecode::Program bytecode;
+  std::map<std::string, int32_t> function_indices;
+  std::map<std::string, int32_t> global_indices;
+  std::map<std::string, ArrayVariable> global_arrays;
+  // enum literals and constants by value
+  std::map<std::string, int32_t> global_user_def_type_consts;
+  std::map<std::string, int32_t> local_variables;
+  std::map<std::string, ArrayVariable> local_arrays;
+  std::map<std::string, int32_t> local_user_def_type_consts;
+  int32_t first_temporary = 0;
+  int32_t next_register = 0;
+  int32_t last_jump_target = -1;
+  int32_t frame_size = 0;
+  int32_t result_register = 0;
+};
+
+} // namespace Visitor
+} // namespace WinZigC
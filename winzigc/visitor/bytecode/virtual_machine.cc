@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <limits>
+
+#include "winzigc/visitor/bytecode/virtual_machine.h"
+#include "winzigc/runtime/wz_runtime.h"
+
+#include "glog/logging.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define WINZIGC_COMPUTED_GOTO
+#endif
+
+namespace WinZigC {
+namespace Bytecode {
+
+namespace {
+
+struct CallFrame {
+  const Instruction* return_pc;
+  size_t base;
+  int32_t frame_size;
+  int32_t destination;
+};
+
+int32_t lookup_case_target(const CaseTable& table, int32_t value) {
+  if (!table.dense_targets.empty()) {
+    uint32_t index = static_cast<uint32_t>(value) - static_cast<uint32_t>(table.low);
+    return index < table.dense_targets.size() ? table.dense_targets[index] : table.default_target;
+  }
+  auto range = std::upper_bound(
+      table.ranges.begin(), table.ranges.end(), value,
+      [](int32_t value, const CaseRange& range) { return value < range.low; });
+  if (range != table.ranges.begin() && value <= (range - 1)->high) {
+    return (range - 1)->target;
+  }
+  return table.default_target;
+}
+
+// Division and modulo by zero and INT_MIN / -1 are reported and yield 0, as in the interpreter.
+bool can_divide(int32_t lhs, int32_t rhs, const char* op) {
+  if (rhs != 0 && (lhs != std::numeric_limits<int32_t>::min() || rhs != -1)) {
+    return true;
+  }
+  LOG(ERROR) << (rhs == 0 ? "Division by zero: " : "Division overflow: ") << lhs << op << rhs;
+  return false;
+}
+
+} // namespace
+
+int VirtualMachine::run(const Program& program) {
+  std::vector<int32_t> globals(program.global_count, 0);
+  std::vector<int32_t> registers(std::max(program.main.frame_size, 1) + 256, 0);
+  std::vector<CallFrame> call_stack;
+
+  const Instruction* code = program.code.data();
+  const Instruction* pc = code + program.main.entry;
+  size_t base = 0;
+  int32_t frame_size = program.main.frame_size;
+  int32_t* r = registers.data();
+
+#ifdef WINZIGC_COMPUTED_GOTO
+  // must follow the declaration order of Opcode
+  static const void* dispatch_table[] = {
+      &&op_kLoadConst,
+      &&op_kMove,
+      &&op_kLoadGlobal,
+      &&op_kStoreGlobal,
+      &&op_kLoadGlobalElement,
+      &&op_kStoreGlobalElement,
+      &&op_kLoadElement,
+      &&op_kStoreElement,
+      &&op_kCheckIndex,
+      &&op_kAdd,
+      &&op_kAddImm,
+      &&op_kSub,
+      &&op_kMul,
+      &&op_kDiv,
+      &&op_kMod,
+      &&op_kNeg,
+      &&op_kNot,
+      &&op_kAnd,
+      &&op_kOr,
+      &&op_kLt,
+      &&op_kLe,
+      &&op_kGt,
+      &&op_kGe,
+      &&op_kEq,
+      &&op_kNe,
+      &&op_kJump,
+      &&op_kJumpIfTrue,
+      &&op_kJumpIfFalse,
+      &&op_kJumpIfLt,
+      &&op_kJumpIfLe,
+      &&op_kJumpIfGt,
+      &&op_kJumpIfGe,
+      &&op_kJumpIfEq,
+      &&op_kJumpIfNe,
+      &&op_kSwitch,
+      &&op_kCall,
+      &&op_kReturn,
+      &&op_kHalt,
+      &&op_kReadInt,
+      &&op_kReadChar,
+      &&op_kOutputInt,
+      &&op_kOutputChar,
+      &&op_kOutputText,
+      &&op_kOutputFormat,
+  };
+  static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) ==
+                    static_cast<size_t>(Opcode::kOutputFormat) + 1,
+                "dispatch table out of sync with Opcode");
+#define DISPATCH() goto* dispatch_table[static_cast<uint8_t>(pc->opcode)]
+#define TARGET(opcode) op_##opcode
+#else
+#define DISPATCH() continue
+#define TARGET(opcode) case Opcode::opcode
+#endif
+// no do/while wrapper: with the switch fallback DISPATCH() has to continue the dispatch loop
+#define NEXT()                                                                                     \
+  ++pc;                                                                                            \
+  DISPATCH()
+#define JUMP(target)                                                                               \
+  pc = code + (target);                                                                            \
+  DISPATCH()
+
+  for (;;) {
+#ifdef WINZIGC_COMPUTED_GOTO
+    DISPATCH();
+    {
+#else
+    switch (pc->opcode) {
+#endif
+    TARGET(kLoadConst):
+      r[pc->a] = pc->b;
+      NEXT();
+    TARGET(kMove):
+      r[pc->a] = r[pc->b];
+      NEXT();
+    TARGET(kLoadGlobal):
+      r[pc->a] = globals[pc->b];
+      NEXT();
+    TARGET(kStoreGlobal):
+      globals[pc->a] = r[pc->b];
+      NEXT();
+    TARGET(kLoadGlobalElement):
+      r[pc->a] = globals[static_cast<int64_t>(pc->b) + r[pc->c]];
+      NEXT();
+    TARGET(kStoreGlobalElement):
+      globals[static_cast<int64_t>(pc->a) + r[pc->b]] = r[pc->c];
+      NEXT();
+    TARGET(kLoadElement):
+      r[pc->a] = r[static_cast<int64_t>(pc->b) + r[pc->c]];
+      NEXT();
+    TARGET(kStoreElement):
+      r[static_cast<int64_t>(pc->a) + r[pc->b]] = r[pc->c];
+      NEXT();
+    TARGET(kCheckIndex): {
+      const Array& array = program.arrays[pc->c];
+      int64_t offset = static_cast<int64_t>(pc->b) + r[pc->a] - array.first;
+      if (offset >= 0 && offset < array.size) {
+        NEXT();
+      }
+      LOG(ERROR) << "Array index out of bounds: " << array.name << "[" << offset + array.lower
+                 << "]";
+      ++pc;
+      if (pc->opcode == Opcode::kLoadGlobalElement || pc->opcode == Opcode::kLoadElement) {
+        r[pc->a] = 0;
+      }
+      NEXT();
+    }
+
+    TARGET(kAdd):
+      r[pc->a] = static_cast<uint32_t>(r[pc->b]) + static_cast<uint32_t>(r[pc->c]);
+      NEXT();
+    TARGET(kAddImm):
+      r[pc->a] = static_cast<uint32_t>(r[pc->b]) + static_cast<uint32_t>(pc->c);
+      NEXT();
+    TARGET(kSub):
+      r[pc->a] = static_cast<uint32_t>(r[pc->b]) - static_cast<uint32_t>(r[pc->c]);
+      NEXT();
+    TARGET(kMul):
+      r[pc->a] = static_cast<uint32_t>(r[pc->b]) * static_cast<uint32_t>(r[pc->c]);
+      NEXT();
+    TARGET(kDiv):
+      r[pc->a] = can_divide(r[pc->b], r[pc->c], " / ") ? r[pc->b] / r[pc->c] : 0;
+      NEXT();
+    TARGET(kMod):
+      r[pc->a] = can_divide(r[pc->b], r[pc->c], " mod ") ? r[pc->b] % r[pc->c] : 0;
+      NEXT();
+    TARGET(kNeg):
+      r[pc->a] = 0u - static_cast<uint32_t>(r[pc->b]);
+      NEXT();
+    TARGET(kNot):
+      r[pc->a] = r[pc->b] ^ 1;
+      NEXT();
+    TARGET(kAnd):
+      r[pc->a] = r[pc->b] & r[pc->c];
+      NEXT();
+    TARGET(kOr):
+      r[pc->a] = r[pc->b] | r[pc->c];
+      NEXT();
+    TARGET(kLt):
+      r[pc->a] = r[pc->b] < r[pc->c];
+      NEXT();
+    TARGET(kLe):
+      r[pc->a] = r[pc->b] <= r[pc->c];
+      NEXT();
+    TARGET(kGt):
+      r[pc->a] = r[pc->b] > r[pc->c];
+      NEXT();
+    TARGET(kGe):
+      r[pc->a] = r[pc->b] >= r[pc->c];
+      NEXT();
+    TARGET(kEq):
+      r[pc->a] = r[pc->b] == r[pc->c];
+      NEXT();
+    TARGET(kNe):
+      r[pc->a] = r[pc->b] != r[pc->c];
+      NEXT();
+
+    TARGET(kJump):
+      JUMP(pc->a);
+    TARGET(kJumpIfTrue):
+      if (r[pc->a]) {
+        JUMP(pc->b);
+      }
+      NEXT();
+    TARGET(kJumpIfFalse):
+      if (!r[pc->a]) {
+        JUMP(pc->b);
+      }
+      NEXT();
+    TARGET(kJumpIfLt):
+      if (r[pc->a] < r[pc->b]) {
+        JUMP(pc->c);
+      }
+      NEXT();
+    TARGET(kJumpIfLe):
+      if (r[pc->a] <= r[pc->b]) {
+        JUMP(pc->c);
+      }
+      NEXT();
+    TARGET(kJumpIfGt):
+      if (r[pc->a] > r[pc->b]) {
+        JUMP(pc->c);
+      }
+      NEXT();
+    TARGET(kJumpIfGe):
+      if (r[pc->a] >= r[pc->b]) {
+        JUMP(pc->c);
+      }
+      NEXT();
+    TARGET(kJumpIfEq):
+      if (r[pc->a] == r[pc->b]) {
+        JUMP(pc->c);
+      }
+      NEXT();
+    TARGET(kJumpIfNe):
+      if (r[pc->a] != r[pc->b]) {
+        JUMP(pc->c);
+      }
+      NEXT();
+    TARGET(kSwitch):
+      JUMP(lookup_case_target(program.case_tables[pc->b], r[pc->a]));
+
+    TARGET(kCall): {
+      const Function& callee = program.functions[pc->b];
+      size_t callee_base = base + frame_size;
+      if (registers.size() < callee_base + callee.frame_size) {
+        registers.resize(std::max(registers.size() * 2, callee_base + callee.frame_size));
+        r = registers.data() + base;
+      }
+      int32_t* callee_registers = registers.data() + callee_base;
+      callee_registers[0] = 0;
+      std::copy(r + pc->c, r + pc->c + callee.param_count, callee_registers + 1);
+      std::fill(callee_registers + 1 + callee.param_count, callee_registers + callee.frame_size,
+                0);
+      call_stack.push_back({pc + 1, base, frame_size, pc->a});
+      base = callee_base;
+      frame_size = callee.frame_size;
+      r = callee_registers;
+      JUMP(callee.entry);
+    }
+    TARGET(kReturn): {
+      int32_t return_value = r[0];
+      const CallFrame& caller = call_stack.back();
+      pc = caller.return_pc;
+      base = caller.base;
+      frame_size = caller.frame_size;
+      r = registers.data() + base;
+      r[caller.destination] = return_value;
+      call_stack.pop_back();
+      DISPATCH();
+    }
+    TARGET(kHalt): {
+      wz_flush();
+      return 0;
+    }
+
+    TARGET(kReadInt): {
+      int32_t value;
+      if (wz_read_int(&value)) {
+        r[pc->a] = value;
+      }
+      NEXT();
+    }
+    TARGET(kReadChar): {
+      int8_t value;
+      if (wz_read_char(&value)) {
+        r[pc->a] = value;
+      }
+      NEXT();
+    }
+    TARGET(kOutputInt):
+      wz_out_int(r[pc->a]);
+      NEXT();
+    TARGET(kOutputChar):
+      wz_out_char(r[pc->a]);
+      NEXT();
+    TARGET(kOutputText):
+      wz_out_text(program.strings[pc->a].data(), program.strings[pc->a].size());
+      NEXT();
+    TARGET(kOutputFormat):
+      wz_out_format(program.strings[pc->a].data(), program.strings[pc->a].size(), r + pc->b);
+      NEXT();
+    }
+  }
+
+#undef JUMP
+#undef NEXT
+#undef TARGET
+#undef DISPATCH
+}
+
+} // namespace Bytecode
+} // namespace WinZigC
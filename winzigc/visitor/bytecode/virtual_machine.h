@@ -0,0 +1,19 @@
+#pragma once
+
+#include "winzigc/visitor/bytecode/bytecode.h"
+
+namespace WinZigC {
+namespace Bytecode {
+
+// Executes a bytecode program in-process. With GCC and Clang the dispatch loop threads the
+// instructions through computed gotos, other compilers fall back to a switch.
+class VirtualMachine {
+public:
+  VirtualMachine() = default;
+  ~VirtualMachine() = default;
+
+  int run(const Program& program);
+};
+
+} // namespace Bytecode
+} // namespace WinZigC
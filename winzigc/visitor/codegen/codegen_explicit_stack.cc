@@ -0,0 +1,279 @@
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+
+#include "glog/logging.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+// The allocas that may be read before they are written, at the start of every block. A store
+// overwrites a scalar and a memset of its whole size an array; every other use of an alloca, like
+// an element address or a `read` argument, counts as a read.
+static std::map<const llvm::BasicBlock*, llvm::BitVector>
+find_live_allocas(llvm::Function& function, const std::vector<llvm::AllocaInst*>& allocas) {
+  const llvm::DataLayout& data_layout = function.getParent()->getDataLayout();
+  std::map<const llvm::Value*, unsigned> alloca_indices;
+  for (unsigned index = 0; index < allocas.size(); index++) {
+    alloca_indices[allocas[index]] = index;
+  }
+  auto find_index = [&](const llvm::Value* value) {
+    auto found = alloca_indices.find(value);
+    return found == alloca_indices.end() ? -1 : static_cast<int>(found->second);
+  };
+
+  std::map<const llvm::BasicBlock*, llvm::BitVector> reads, writes, live;
+  for (const auto& block : function) {
+    llvm::BitVector& block_reads = reads[&block] = llvm::BitVector(allocas.size());
+    llvm::BitVector& block_writes = writes[&block] = llvm::BitVector(allocas.size());
+    live[&block] = llvm::BitVector(allocas.size());
+    for (const auto& instruction : block) {
+      int written = -1;
+      if (const auto* store = llvm::dyn_cast<llvm::StoreInst>(&instruction)) {
+        written = find_index(store->getPointerOperand());
+        if (written >= 0 && allocas[written]->getAllocatedType()->isArrayTy()) {
+          written = -1;
+        }
+      } else if (const auto* memset = llvm::dyn_cast<llvm::MemSetInst>(&instruction)) {
+        written = find_index(memset->getDest());
+        const auto* length = llvm::dyn_cast<llvm::ConstantInt>(memset->getLength());
+        if (written >= 0 &&
+            (!length || length->getZExtValue() !=
+                            data_layout.getTypeAllocSize(allocas[written]->getAllocatedType()))) {
+          written = -1;
+        }
+      }
+      for (const llvm::Value* operand : instruction.operands()) {
+        int index = find_index(operand);
+        if (index >= 0 && index != written && !block_writes.test(index)) {
+          block_reads.set(index);
+        }
+      }
+      if (written >= 0) {
+        block_writes.set(written);
+      }
+    }
+  }
+
+  // liveness flows backwards, visiting the blocks from the last one needs fewer rounds
+  std::vector<const llvm::BasicBlock*> blocks;
+  for (const auto& block : function) {
+    blocks.insert(blocks.begin(), &block);
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const llvm::BasicBlock* block : blocks) {
+      llvm::BitVector block_live(allocas.size());
+      for (const llvm::BasicBlock* successor : llvm::successors(block)) {
+        block_live |= live[successor];
+      }
+      block_live.reset(writes[block]);
+      block_live |= reads[block];
+      if (block_live != live[block]) {
+        live[block] = block_live;
+        changed = true;
+      }
+    }
+  }
+  return live;
+}
+
+// Turns the self calls left in the function, those not in tail position, into pushes on a frame
+// stack in memory mapped by the runtime library, so the depth of the recursion is not bounded by
+// the native stack. A call saves the variables and temporaries still to be read after it, along
+// with the index of the call, and starts the body over like a tail call. Returning pops the frame
+// of the pending call, restores its variables and resumes after it with the returned value, until
+// no call is pending.
+void CodeGenVisitor::codegen_explicit_stack(llvm::Function* function) {
+  std::vector<llvm::CallInst*> calls;
+  for (auto& block : *function) {
+    for (auto& instruction : block) {
+      auto* call = llvm::dyn_cast<llvm::CallInst>(&instruction);
+      if (call && call->getCalledFunction() == function) {
+        calls.push_back(call);
+      }
+    }
+  }
+  if (calls.empty()) {
+    return;
+  }
+
+  llvm::Type* int_type = llvm::Type::getInt32Ty(*context);
+  llvm::Type* int64_type = llvm::Type::getInt64Ty(*context);
+  llvm::Type* frames_type = llvm::Type::getInt8PtrTy(*context);
+  llvm::BasicBlock& entry_block = function->getEntryBlock();
+  llvm::IRBuilder<> entry_builder(entry_block.getTerminator());
+  llvm::AllocaInst* returned =
+      entry_builder.CreateAlloca(function->getReturnType(), nullptr, "returned");
+
+  // the code after a call resumes in a block of its own and finds the result of the call where
+  // the callee left it
+  std::vector<llvm::BasicBlock*> resume_blocks;
+  for (llvm::CallInst* call : calls) {
+    llvm::BasicBlock* resume_block =
+        call->getParent()->splitBasicBlock(call->getNextNode(), "resume");
+    builder->SetInsertPoint(&resume_block->front());
+    builder->SetCurrentDebugLocation(call->getDebugLoc());
+    call->replaceAllUsesWith(builder->CreateLoad(returned, "result"));
+    resume_blocks.push_back(resume_block);
+  }
+  // a resumed call does not come from the blocks before it, so values crossing blocks go through
+  // allocas that the frames can save
+  std::vector<llvm::Instruction*> crossing_values;
+  for (auto& block : *function) {
+    for (auto& instruction : block) {
+      if (!llvm::isa<llvm::AllocaInst>(instruction) && instruction.isUsedOutsideOfBlock(&block)) {
+        crossing_values.push_back(&instruction);
+      }
+    }
+  }
+  for (llvm::Instruction* value : crossing_values) {
+    llvm::DemoteRegToStack(*value);
+  }
+
+  std::vector<llvm::AllocaInst*> allocas;
+  for (auto& instruction : entry_block) {
+    auto* alloca = llvm::dyn_cast<llvm::AllocaInst>(&instruction);
+    if (alloca && alloca != returned) {
+      allocas.push_back(alloca);
+    }
+  }
+  auto live = find_live_allocas(*function, allocas);
+
+  // one frame layout for all calls: the call index, then every alloca live after any call
+  std::vector<llvm::Type*> frame_fields = {int_type};
+  std::map<llvm::AllocaInst*, unsigned> frame_field_indices;
+  for (llvm::BasicBlock* resume_block : resume_blocks) {
+    for (unsigned index : live[resume_block].set_bits()) {
+      if (!frame_field_indices.count(allocas[index])) {
+        frame_field_indices[allocas[index]] = frame_fields.size();
+        frame_fields.push_back(allocas[index]->getAllocatedType());
+      }
+    }
+  }
+  llvm::StructType* frame_type =
+      llvm::StructType::create(*context, frame_fields, function->getName().str() + ".frame");
+  llvm::Value* frame_size = llvm::ConstantInt::get(
+      int64_type, module->getDataLayout().getTypeAllocSize(frame_type).getFixedSize());
+
+  entry_builder.SetInsertPoint(entry_block.getTerminator());
+  llvm::AllocaInst* frames = entry_builder.CreateAlloca(frames_type, nullptr, "frames");
+  llvm::AllocaInst* capacity = entry_builder.CreateAlloca(int64_type, nullptr, "capacity");
+  llvm::AllocaInst* depth = entry_builder.CreateAlloca(int64_type, nullptr, "depth");
+  entry_builder.CreateStore(llvm::Constant::getNullValue(frames_type), frames);
+  entry_builder.CreateStore(llvm::ConstantInt::get(int64_type, 0), capacity);
+  entry_builder.CreateStore(llvm::ConstantInt::get(int64_type, 0), depth);
+
+  auto copy = [&](llvm::Value* to, llvm::Value* from, llvm::Type* type) {
+    if (type->isArrayTy()) {
+      builder->CreateMemCpy(to, llvm::MaybeAlign(), from, llvm::MaybeAlign(),
+                            module->getDataLayout().getTypeAllocSize(type).getFixedSize());
+    } else {
+      builder->CreateStore(builder->CreateLoad(from), to);
+    }
+  };
+  auto top_frame = [&](llvm::Value* index) {
+    llvm::Value* frame_array =
+        builder->CreatePointerCast(builder->CreateLoad(frames), frame_type->getPointerTo());
+    return builder->CreateInBoundsGEP(frame_array, index, "frame");
+  };
+
+  for (size_t call_index = 0; call_index < calls.size(); call_index++) {
+    llvm::CallInst* call = calls[call_index];
+    llvm::BasicBlock* call_block = call->getParent();
+    std::vector<llvm::Value*> args(call->arg_begin(), call->arg_end());
+    builder->SetCurrentDebugLocation(call->getDebugLoc());
+    call_block->getTerminator()->eraseFromParent();
+    call->eraseFromParent();
+
+    builder->SetInsertPoint(call_block);
+    llvm::Value* frame_index = builder->CreateLoad(depth);
+    llvm::BasicBlock* grow_block = llvm::BasicBlock::Create(*context, "grow", function);
+    llvm::BasicBlock* push_block = llvm::BasicBlock::Create(*context, "push", function);
+    builder->CreateCondBr(builder->CreateICmpEQ(frame_index, builder->CreateLoad(capacity)),
+                          grow_block, push_block);
+    builder->SetInsertPoint(grow_block);
+    builder->CreateStore(builder->CreateCall(module->getFunction("wz_frames_grow"),
+                                             {builder->CreateLoad(frames), capacity, frame_size}),
+                         frames);
+    builder->CreateBr(push_block);
+
+    builder->SetInsertPoint(push_block);
+    llvm::Value* frame = top_frame(frame_index);
+    builder->CreateStore(builder->getInt32(call_index), builder->CreateStructGEP(frame, 0));
+    for (unsigned index : live[resume_blocks[call_index]].set_bits()) {
+      llvm::AllocaInst* alloca = allocas[index];
+      copy(builder->CreateStructGEP(frame, frame_field_indices[alloca]), alloca,
+           alloca->getAllocatedType());
+    }
+    builder->CreateStore(builder->CreateAdd(frame_index, llvm::ConstantInt::get(int64_type, 1)),
+                         depth);
+    codegen_tail_recursion(args);
+  }
+
+  std::vector<llvm::ReturnInst*> returns;
+  for (auto& block : *function) {
+    if (auto* return_instruction = llvm::dyn_cast<llvm::ReturnInst>(block.getTerminator())) {
+      returns.push_back(return_instruction);
+    }
+  }
+  llvm::BasicBlock* pop_block = llvm::BasicBlock::Create(*context, "pop", function);
+  for (llvm::ReturnInst* return_instruction : returns) {
+    // a call returned from here goes on with the pending calls, it is not a tail call anymore
+    if (auto* tail_call =
+            llvm::dyn_cast_or_null<llvm::CallInst>(return_instruction->getPrevNode())) {
+      tail_call->setTailCallKind(llvm::CallInst::TCK_None);
+    }
+    builder->SetInsertPoint(return_instruction);
+    builder->SetCurrentDebugLocation(return_instruction->getDebugLoc());
+    builder->CreateStore(return_instruction->getReturnValue(), returned);
+    builder->CreateBr(pop_block);
+    return_instruction->eraseFromParent();
+  }
+
+  builder->SetInsertPoint(pop_block);
+  builder->SetCurrentDebugLocation(llvm::DebugLoc());
+  llvm::Value* pending = builder->CreateLoad(depth);
+  llvm::BasicBlock* return_block = llvm::BasicBlock::Create(*context, "return", function);
+  llvm::BasicBlock* restore_block = llvm::BasicBlock::Create(*context, "restore", function);
+  builder->CreateCondBr(builder->CreateICmpEQ(pending, llvm::ConstantInt::get(int64_type, 0)),
+                        return_block, restore_block);
+  builder->SetInsertPoint(return_block);
+  builder->CreateCall(module->getFunction("wz_frames_free"),
+                      {builder->CreateLoad(frames), builder->CreateLoad(capacity), frame_size});
+  builder->CreateRet(builder->CreateLoad(returned));
+
+  builder->SetInsertPoint(restore_block);
+  llvm::Value* frame_index = builder->CreateSub(pending, llvm::ConstantInt::get(int64_type, 1));
+  builder->CreateStore(frame_index, depth);
+  llvm::Value* frame = top_frame(frame_index);
+  llvm::Value* call_index_address = builder->CreateStructGEP(frame, 0);
+  llvm::Value* call_index = builder->CreateLoad(call_index_address, "call");
+  std::vector<llvm::BasicBlock*> restore_call_blocks;
+  for (size_t index = 0; index < calls.size(); index++) {
+    restore_call_blocks.push_back(llvm::BasicBlock::Create(*context, "restore_call", function));
+  }
+  llvm::SwitchInst* resume_switch =
+      builder->CreateSwitch(call_index, restore_call_blocks[0], calls.size() - 1);
+  for (size_t index = 1; index < calls.size(); index++) {
+    resume_switch->addCase(builder->getInt32(index), restore_call_blocks[index]);
+  }
+  for (size_t index = 0; index < calls.size(); index++) {
+    builder->SetInsertPoint(restore_call_blocks[index]);
+    for (unsigned alloca_index : live[resume_blocks[index]].set_bits()) {
+      llvm::AllocaInst* alloca = allocas[alloca_index];
+      copy(alloca, builder->CreateStructGEP(frame, frame_field_indices[alloca]),
+           alloca->getAllocatedType());
+    }
+    builder->CreateBr(resume_blocks[index]);
+  }
+}
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 
 #include "winzigc/visitor/codegen/codegen_visitor.h"
+#include "winzigc/common/case_ranges.h"
 
 #include "glog/logging.h"
 #include "llvm/IR/Constants.h"
@@ -53,12 +55,28 @@ void CodeGenVisitor::visit(const Frontend::AST::CallExpression& expression) {
   }
 
   std::vector<llvm::Value*> args;
+  if (!codegen_call_arguments(expression, args)) {
+    return;
+  }
+  if (llvm::Constant* folded = fold_pure_call(expression, args)) {
+    expression.set_codegen_value(folded);
+    return;
+  }
+  codegen_global_spill(expression.get_name(), false);
+  llvm::CallInst* codegen_value = builder->CreateCall(callee_func, args);
+  codegen_value->setCallingConv(callee_func->getCallingConv());
+  codegen_global_spill(expression.get_name(), true);
+  expression.set_codegen_value(codegen_value);
+}
+
+bool CodeGenVisitor::codegen_call_arguments(const Frontend::AST::CallExpression& expression,
+                                            std::vector<llvm::Value*>& args) {
   for (const auto& arg : expression.get_arguments()) {
     arg->accept(*this);
     llvm::Value* arg_val = arg->get_codegen_value();
     if (arg_val == nullptr) {
       LOG(ERROR) << "Unknown argument";
-      return;
+      return false;
     }
     llvm::Type* arg_type = arg_val->getType();
     if (arg_type->isPointerTy()) {
@@ -66,11 +84,14 @@ void CodeGenVisitor::visit(const Frontend::AST::CallExpression& expression) {
     }
     args.push_back(arg_val);
   }
-  llvm::Value* codegen_value = builder->CreateCall(callee_func, args);
-  expression.set_codegen_value(codegen_value);
+  return true;
 }
 
 void CodeGenVisitor::visit(const Frontend::AST::IdentifierExpression& expression) {
+  if (llvm::ConstantInt* constant = lookup_constant(expression.get_name())) {
+    expression.set_codegen_value(constant);
+    return;
+  }
   llvm::Value* var = lookup_variable(expression.get_name());
   if (!var) {
     LOG(ERROR) << "Unknown variable name";
@@ -81,8 +102,19 @@ void CodeGenVisitor::visit(const Frontend::AST::IdentifierExpression& expression
   expression.set_codegen_value(codegen_value);
 }
 
+void CodeGenVisitor::visit(const Frontend::AST::IndexExpression& expression) {
+  llvm::Value* element = codegen_variable_address(expression);
+  if (!element) {
+    LOG(ERROR) << "Unknown variable name";
+    return;
+  }
+  emit_location(&expression);
+  llvm::Value* codegen_value = builder->CreateLoad(element, expression.get_name());
+  expression.set_codegen_value(codegen_value);
+}
+
 void CodeGenVisitor::visit(const Frontend::AST::AssignmentExpression& expression) {
-  llvm::Value* var = lookup_variable(expression.get_name().get_name());
+  llvm::Value* var = codegen_variable_address(expression.get_name());
   if (!var) {
     LOG(ERROR) << "Unknown variable name";
     return;
@@ -94,8 +126,8 @@ void CodeGenVisitor::visit(const Frontend::AST::AssignmentExpression& expression
 }
 
 void CodeGenVisitor::visit(const Frontend::AST::SwapExpression& expression) {
-  llvm::Value* var1 = lookup_variable(expression.get_lhs().get_name());
-  llvm::Value* var2 = lookup_variable(expression.get_rhs().get_name());
+  llvm::Value* var1 = codegen_variable_address(expression.get_lhs());
+  llvm::Value* var2 = codegen_variable_address(expression.get_rhs());
   if (!var1 || !var2) {
     LOG(ERROR) << "Unknown variable name";
     return;
@@ -127,9 +159,7 @@ void CodeGenVisitor::visit(const Frontend::AST::IfExpression& expression) {
 
   // then block instructions
   builder->SetInsertPoint(then_block);
-  for (const auto& statement : expression.get_then_statement()) {
-    statement->accept(*this);
-  }
+  codegen_statements(expression.get_then_statement());
   // final block branched from then block does not end with a terminator
   if (!builder->GetInsertBlock()->getTerminator()) {
     add_merge_block = true;
@@ -139,9 +169,7 @@ void CodeGenVisitor::visit(const Frontend::AST::IfExpression& expression) {
   // else block instructions
   parent_function->getBasicBlockList().push_back(else_block);
   builder->SetInsertPoint(else_block);
-  for (const auto& statement : expression.get_else_statement()) {
-    statement->accept(*this);
-  }
+  codegen_statements(expression.get_else_statement());
   // final block branched from else block does not end with a terminator
   if (!builder->GetInsertBlock()->getTerminator()) {
     add_merge_block = true;
@@ -155,93 +183,25 @@ void CodeGenVisitor::visit(const Frontend::AST::IfExpression& expression) {
   }
 }
 
-void CodeGenVisitor::visit(const Frontend::AST::ForExpression& expression) {
-  emit_location(&expression);
-  llvm::Function* function = builder->GetInsertBlock()->getParent();
-
-  llvm::BasicBlock* cond_block = llvm::BasicBlock::Create(*context, "for_cond", function);
-  llvm::BasicBlock* body_block = llvm::BasicBlock::Create(*context, "for_body");
-  llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(*context, "for_exit");
-
-  expression.get_start_assignment().accept(*this);
-  builder->CreateBr(cond_block);
-
-  builder->SetInsertPoint(cond_block);
-  expression.get_condition().accept(*this);
-  llvm::Value* cond = expression.get_condition().get_codegen_value();
-  builder->CreateCondBr(cond, body_block, exit_block);
-
-  function->getBasicBlockList().push_back(body_block);
-  builder->SetInsertPoint(body_block);
-  for (const auto& statement : expression.get_body_statements()) {
-    statement->accept(*this);
-  }
-  expression.get_end_assignment().accept(*this);
-  builder->CreateBr(cond_block);
-
-  function->getBasicBlockList().push_back(exit_block);
-  builder->SetInsertPoint(exit_block);
-}
-
-void CodeGenVisitor::visit(const Frontend::AST::RepeatUntilExpression& expression) {
-  emit_location(&expression);
-  llvm::Function* function = builder->GetInsertBlock()->getParent();
-  llvm::BasicBlock* body_block = llvm::BasicBlock::Create(*context, "repeat_body", function);
-  llvm::BasicBlock* cond_block = llvm::BasicBlock::Create(*context, "repeat_cond");
-  llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(*context, "repeat_exit");
-
-  builder->CreateBr(body_block);
-
-  builder->SetInsertPoint(body_block);
-  for (const auto& statement : expression.get_body_statements()) {
-    statement->accept(*this);
-  }
-
-  builder->CreateBr(cond_block);
-  builder->SetInsertPoint(cond_block);
-  function->getBasicBlockList().push_back(cond_block);
-  expression.get_condition().accept(*this);
-  llvm::Value* cond = expression.get_condition().get_codegen_value();
-  builder->CreateCondBr(cond, exit_block, body_block);
-
-  function->getBasicBlockList().push_back(exit_block);
-  builder->SetInsertPoint(exit_block);
-}
-
-void CodeGenVisitor::visit(const Frontend::AST::WhileExpression& expression) {
-  emit_location(&expression);
-  llvm::Function* function = builder->GetInsertBlock()->getParent();
-  llvm::BasicBlock* cond_block = llvm::BasicBlock::Create(*context, "while_cond", function);
-  llvm::BasicBlock* body_block = llvm::BasicBlock::Create(*context, "while_body");
-  llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(*context, "while_exit");
-
-  builder->CreateBr(cond_block);
-  builder->SetInsertPoint(cond_block);
-
-  expression.get_condition().accept(*this);
-  llvm::Value* cond = expression.get_condition().get_codegen_value();
-  builder->CreateCondBr(cond, body_block, exit_block);
-
-  function->getBasicBlockList().push_back(body_block);
-  builder->SetInsertPoint(body_block);
-  for (const auto& statement : expression.get_body_statements()) {
-    statement->accept(*this);
-  }
-  builder->CreateBr(cond_block);
-
-  function->getBasicBlockList().push_back(exit_block);
-  builder->SetInsertPoint(exit_block);
-}
-
 void CodeGenVisitor::visit(const Frontend::AST::CaseExpression& expression) {
+  if (family_cases.find(&expression) != family_cases.end()) {
+    codegen_family_case(expression);
+    return;
+  }
   emit_location(&expression);
   llvm::Function* function = builder->GetInsertBlock()->getParent();
   llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(*context, "case_exit");
 
   expression.get_expression().accept(*this);
   llvm::Value* switch_val = expression.get_expression().get_codegen_value();
+  llvm::IntegerType* switch_type = llvm::cast<llvm::IntegerType>(switch_val->getType());
   llvm::SwitchInst* switch_inst =
       builder->CreateSwitch(switch_val, exit_block, expression.get_cases().size());
+  std::vector<LabelRange<llvm::BasicBlock*>> arm_ranges;
+  // booleans are held as 0 or 1
+  auto label_value = [](llvm::ConstantInt* label) -> int64_t {
+    return label->getBitWidth() == 1 ? label->getZExtValue() : label->getSExtValue();
+  };
 
   for (size_t i = 0; i < expression.get_cases().size(); i++) {
     const Frontend::AST::CaseClause& case_clause = expression.get_cases()[i];
@@ -250,72 +210,108 @@ void CodeGenVisitor::visit(const Frontend::AST::CaseExpression& expression) {
 
     const auto& case_value = case_clause.first;
     if (std::holds_alternative<std::unique_ptr<Frontend::AST::Expression>>(case_value)) {
-      Frontend::AST::Expression* value_expr =
-          std::get<std::unique_ptr<Frontend::AST::Expression>>(case_value).get();
-      llvm::Value* llvm_case_value = nullptr;
-      if (const Frontend::AST::IdentifierExpression* const_identifier =
-              dynamic_cast<const Frontend::AST::IdentifierExpression*>(value_expr)) {
-        std::string case_identifier = const_identifier->get_name();
-        uint32_t case_value = 0;
-        if (local_user_def_type_consts.find(case_identifier) != local_user_def_type_consts.end()) {
-          case_value = local_user_def_type_consts[case_identifier];
-        } else if (global_user_def_type_consts.find(case_identifier) !=
-                   global_user_def_type_consts.end()) {
-          case_value = global_user_def_type_consts[case_identifier];
-        } else {
-          LOG(ERROR) << "Unknown case value";
-          return;
-        }
-        llvm_case_value =
-            llvm::ConstantInt::getSigned(llvm::Type::getInt32Ty(*context), case_value);
-      } else {
-        value_expr->accept(*this);
-        llvm_case_value = value_expr->get_codegen_value();
+      llvm::ConstantInt* label = codegen_case_label(
+          *std::get<std::unique_ptr<Frontend::AST::Expression>>(case_value), switch_type);
+      if (!label) {
+        LOG(ERROR) << "Unknown case value";
+        return;
       }
-      llvm::ConstantInt* const_int = llvm::dyn_cast<llvm::ConstantInt>(llvm_case_value);
-      switch_inst->addCase(const_int, case_block);
+      arm_ranges.push_back({label_value(label), label_value(label), case_block});
     } else if (std::holds_alternative<std::pair<std::unique_ptr<Frontend::AST::Expression>,
                                                 std::unique_ptr<Frontend::AST::Expression>>>(
                    case_value)) {
       auto& exprPair = std::get<std::pair<std::unique_ptr<Frontend::AST::Expression>,
                                           std::unique_ptr<Frontend::AST::Expression>>>(case_value);
-      Frontend::AST::Expression* first_value_expr = exprPair.first.get();
-      Frontend::AST::Expression* second_value_expr = exprPair.second.get();
-
-      int first_value = 0;
-      int second_value = 0;
-
-      if (const Frontend::AST::IntegerExpression* first_int_expr =
-              dynamic_cast<const Frontend::AST::IntegerExpression*>(first_value_expr)) {
-        first_value = first_int_expr->get_value();
-      }
-      if (const Frontend::AST::IntegerExpression* second_int_expr =
-              dynamic_cast<const Frontend::AST::IntegerExpression*>(second_value_expr)) {
-        second_value = second_int_expr->get_value();
-      }
-      for (int i = first_value; i <= second_value; i++) {
-        llvm::Value* llvm_case_value =
-            llvm::ConstantInt::getSigned(llvm::Type::getInt32Ty(*context), i);
-        llvm::ConstantInt* const_int = llvm::dyn_cast<llvm::ConstantInt>(llvm_case_value);
-        switch_inst->addCase(const_int, case_block);
+      llvm::ConstantInt* low = codegen_case_label(*exprPair.first, switch_type);
+      llvm::ConstantInt* high = codegen_case_label(*exprPair.second, switch_type);
+      if (!low || !high) {
+        LOG(ERROR) << "Unknown case value";
+        return;
       }
+      arm_ranges.push_back({label_value(low), label_value(high), case_block});
     }
 
     builder->SetInsertPoint(case_block);
-    for (const auto& statement : case_clause.second) {
-      statement->accept(*this);
-    }
+    codegen_statements(case_clause.second);
 
     if (!builder->GetInsertBlock()->getTerminator()) {
       builder->CreateBr(exit_block);
     }
   }
 
+  // a label listed by more than one arm belongs to the first of them, as in the interpreter, so
+  // the switch and the range tree are built from disjoint ranges
+  std::vector<CaseRange> wide_ranges;
+  for (const auto& range : disjoint_label_ranges(arm_ranges)) {
+    if (range.high - range.low < kMaxSwitchCaseRange) {
+      // short ranges are left to the switch lowering, which builds jump tables and bit tests
+      for (int64_t value = range.low; value <= range.high; value++) {
+        switch_inst->addCase(llvm::ConstantInt::get(switch_type, value, true), range.target);
+      }
+    } else {
+      wide_ranges.push_back({llvm::ConstantInt::get(switch_type, range.low, true),
+                             llvm::ConstantInt::get(switch_type, range.high, true),
+                             range.target});
+    }
+  }
+
+  // values missed by the switch go through a balanced tree of compares over the wide ranges
+  if (!wide_ranges.empty()) {
+    llvm::BasicBlock* ranges_block = llvm::BasicBlock::Create(*context, "case_ranges", function);
+    switch_inst->setDefaultDest(ranges_block);
+    builder->SetInsertPoint(ranges_block);
+    codegen_case_range_tree(switch_val, wide_ranges, 0, wide_ranges.size(), exit_block);
+  }
+
   function->getBasicBlockList().push_back(exit_block);
   builder->SetInsertPoint(exit_block);
-  for (const auto& statement : expression.get_otherwise_clause()) {
-    statement->accept(*this);
+  codegen_statements(expression.get_otherwise_clause());
+}
+
+llvm::ConstantInt* CodeGenVisitor::codegen_case_label(const Frontend::AST::Expression& expression,
+                                                      llvm::IntegerType* type) {
+  if (const Frontend::AST::IdentifierExpression* const_identifier =
+          dynamic_cast<const Frontend::AST::IdentifierExpression*>(&expression)) {
+    llvm::ConstantInt* constant = lookup_constant(const_identifier->get_name(), false);
+    return constant ? llvm::ConstantInt::getSigned(type, constant->getSExtValue()) : nullptr;
   }
+  if (const Frontend::AST::IntegerExpression* int_expr =
+          dynamic_cast<const Frontend::AST::IntegerExpression*>(&expression))
+    return llvm::ConstantInt::getSigned(type, int_expr->get_value());
+  if (const Frontend::AST::CharacterExpression* char_expr =
+          dynamic_cast<const Frontend::AST::CharacterExpression*>(&expression))
+    return llvm::ConstantInt::getSigned(type, char_expr->get_character());
+  if (const Frontend::AST::BooleanExpression* bool_expr =
+          dynamic_cast<const Frontend::AST::BooleanExpression*>(&expression))
+    return llvm::ConstantInt::get(type, bool_expr->get_bool() ? 1 : 0);
+  return nullptr;
+}
+
+void CodeGenVisitor::codegen_case_range_tree(llvm::Value* switch_val,
+                                             const std::vector<CaseRange>& ranges, size_t begin,
+                                             size_t end, llvm::BasicBlock* default_block) {
+  if (end - begin == 1) {
+    // low <= value <= high folds into a single unsigned compare of value - low
+    const CaseRange& range = ranges[begin];
+    llvm::Value* offset = builder->CreateSub(switch_val, range.low, "range_offset");
+    llvm::Value* in_range = builder->CreateICmpULE(
+        offset, llvm::ConstantInt::get(switch_val->getType(),
+                                       range.high->getValue() - range.low->getValue()),
+        "in_range");
+    builder->CreateCondBr(in_range, range.block, default_block);
+    return;
+  }
+
+  llvm::Function* function = builder->GetInsertBlock()->getParent();
+  size_t middle = begin + (end - begin) / 2;
+  llvm::BasicBlock* lower_block = llvm::BasicBlock::Create(*context, "case_ranges_lt", function);
+  llvm::BasicBlock* upper_block = llvm::BasicBlock::Create(*context, "case_ranges_ge", function);
+  builder->CreateCondBr(builder->CreateICmpSLT(switch_val, ranges[middle].low), lower_block,
+                        upper_block);
+  builder->SetInsertPoint(lower_block);
+  codegen_case_range_tree(switch_val, ranges, begin, middle, default_block);
+  builder->SetInsertPoint(upper_block);
+  codegen_case_range_tree(switch_val, ranges, middle, end, default_block);
 }
 
 void CodeGenVisitor::visit(const Frontend::AST::ReturnExpression& expression) {
@@ -326,6 +322,12 @@ void CodeGenVisitor::visit(const Frontend::AST::ReturnExpression& expression) {
     LOG(ERROR) << "Unknown return variable name";
     return;
   }
+  if (const Frontend::AST::CallExpression* call =
+          dynamic_cast<const Frontend::AST::CallExpression*>(&expression.get_expression())) {
+    if (codegen_tail_call(*call)) {
+      return;
+    }
+  }
   expression.get_expression().accept(*this);
   llvm::Value* return_val = expression.get_expression().get_codegen_value();
   builder->CreateStore(return_val, return_var);
@@ -334,6 +336,11 @@ void CodeGenVisitor::visit(const Frontend::AST::ReturnExpression& expression) {
 
 void CodeGenVisitor::visit(const Frontend::AST::BinaryExpression& expression) {
   emit_location(&expression);
+  if (short_circuit && (expression.get_op() == Frontend::AST::BinaryOperation::kAnd ||
+                        expression.get_op() == Frontend::AST::BinaryOperation::kOr)) {
+    expression.set_codegen_value(codegen_short_circuit(expression));
+    return;
+  }
   expression.get_lhs().accept(*this);
   llvm::Value* lhs = expression.get_lhs().get_codegen_value();
   expression.get_rhs().accept(*this);
@@ -387,6 +394,73 @@ void CodeGenVisitor::visit(const Frontend::AST::BinaryExpression& expression) {
   expression.set_codegen_value(codegen_value);
 }
 
+// Whether evaluating the expression can be observed: user functions may print or assign
+// globals, a division may trap, and an element may be read out of the bounds of its array, as
+// in `(i <= 10) and (a[i] <> 0)`. Only constant indices are known to be within the bounds.
+static bool has_side_effects(const Frontend::AST::Expression& expression) {
+  if (dynamic_cast<const Frontend::AST::CallExpression*>(&expression)) {
+    return true;
+  } else if (const auto* element =
+                 dynamic_cast<const Frontend::AST::IndexExpression*>(&expression)) {
+    return !dynamic_cast<const Frontend::AST::IntegerExpression*>(&element->get_index());
+  } else if (const auto* binary =
+                 dynamic_cast<const Frontend::AST::BinaryExpression*>(&expression)) {
+    if (binary->get_op() == Frontend::AST::BinaryOperation::kDivide ||
+        binary->get_op() == Frontend::AST::BinaryOperation::kModulo) {
+      const auto* divisor =
+          dynamic_cast<const Frontend::AST::IntegerExpression*>(&binary->get_rhs());
+      if (!divisor || divisor->get_value() == 0) {
+        return true;
+      }
+    }
+    return has_side_effects(binary->get_lhs()) || has_side_effects(binary->get_rhs());
+  } else if (const auto* unary = dynamic_cast<const Frontend::AST::UnaryExpression*>(&expression)) {
+    return has_side_effects(unary->get_expression());
+  }
+  return false;
+}
+
+// The right operand of `and` and `or` only runs when the left one does not decide the result. It
+// is evaluated unconditionally and picked by a select when that cannot be observed, which keeps
+// guards branch free; otherwise it gets a block of its own and the results meet in a phi.
+llvm::Value*
+CodeGenVisitor::codegen_short_circuit(const Frontend::AST::BinaryExpression& expression) {
+  bool is_and = expression.get_op() == Frontend::AST::BinaryOperation::kAnd;
+  expression.get_lhs().accept(*this);
+  llvm::Value* lhs = expression.get_lhs().get_codegen_value();
+
+  if (!has_side_effects(expression.get_rhs())) {
+    expression.get_rhs().accept(*this);
+    llvm::Value* rhs = expression.get_rhs().get_codegen_value();
+    return is_and ? builder->CreateSelect(lhs, rhs, builder->getFalse(), "andtmp")
+                  : builder->CreateSelect(lhs, builder->getTrue(), rhs, "ortmp");
+  }
+
+  llvm::Function* function = builder->GetInsertBlock()->getParent();
+  llvm::BasicBlock* lhs_block = builder->GetInsertBlock();
+  llvm::BasicBlock* rhs_block =
+      llvm::BasicBlock::Create(*context, is_and ? "and_rhs" : "or_rhs", function);
+  llvm::BasicBlock* merge_block = llvm::BasicBlock::Create(*context, is_and ? "and_end" : "or_end");
+  if (is_and) {
+    builder->CreateCondBr(lhs, rhs_block, merge_block);
+  } else {
+    builder->CreateCondBr(lhs, merge_block, rhs_block);
+  }
+
+  builder->SetInsertPoint(rhs_block);
+  expression.get_rhs().accept(*this);
+  llvm::Value* rhs = expression.get_rhs().get_codegen_value();
+  llvm::BasicBlock* rhs_end_block = builder->GetInsertBlock();
+  builder->CreateBr(merge_block);
+
+  function->getBasicBlockList().push_back(merge_block);
+  builder->SetInsertPoint(merge_block);
+  llvm::PHINode* phi = builder->CreatePHI(builder->getInt1Ty(), 2, is_and ? "andtmp" : "ortmp");
+  phi->addIncoming(is_and ? builder->getFalse() : builder->getTrue(), lhs_block);
+  phi->addIncoming(rhs, rhs_end_block);
+  return phi;
+}
+
 void CodeGenVisitor::visit(const Frontend::AST::UnaryExpression& expression) {
   expression.get_expression().accept(*this);
   llvm::Value* operand = expression.get_expression().get_codegen_value();
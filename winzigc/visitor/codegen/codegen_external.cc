@@ -1,5 +1,7 @@
 #include "winzigc/visitor/codegen/codegen_visitor.h"
 
+#include <algorithm>
+
 #include "glog/logging.h"
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Constants.h"
@@ -8,37 +10,43 @@ namespace WinZigC {
 namespace Visitor {
 
 llvm::Value* CodeGenVisitor::codegen_read_call(const Frontend::AST::CallExpression& expression) {
-  llvm::Function* callee_func = module->getFunction("scanf");
-  if (!callee_func) {
-    LOG(ERROR) << "scanf function not found";
-    return nullptr;
-  }
-
   for (const auto& arg : expression.get_arguments()) {
-    std::vector<llvm::Value*> args;
     if (const Frontend::AST::IdentifierExpression* var_identifier =
             dynamic_cast<const Frontend::AST::IdentifierExpression*>(arg.get())) {
-      llvm::Value* var = lookup_variable(var_identifier->get_name());
+      llvm::Value* var = codegen_variable_address(*var_identifier);
       if (!var) {
         LOG(ERROR) << "Unknown variable name";
         return nullptr;
       }
-      llvm::ConstantInt* zero = llvm::ConstantInt::getSigned(llvm::Type::getInt64Ty(*context), 0);
-      llvm::Value* i_ptr = builder->CreateInBoundsGEP(var, zero);
-      args.push_back(i_ptr);
 
+      // the runtime parses straight into the variable and leaves it unchanged when the input does
+      // not match, like scanf
+      llvm::Function* callee_func = nullptr;
       if (var->getType()->isPointerTy() &&
           var->getType()->getPointerElementType()->isIntegerTy(32)) {
-        args.insert(args.begin(), builder->CreateGlobalStringPtr("%d"));
+        callee_func = module->getFunction("wz_read_int");
       } else if (var->getType()->isPointerTy() &&
                  var->getType()->getPointerElementType()->isIntegerTy(8)) {
-        args.insert(args.begin(), builder->CreateGlobalStringPtr("%c"));
+        callee_func = module->getFunction("wz_read_char");
       } else {
         LOG(ERROR) << "Unsupported variable type";
         return nullptr;
       }
 
-      builder->CreateCall(callee_func, args);
+      if (!optimize || !llvm::isa<llvm::AllocaInst>(var)) {
+        builder->CreateCall(callee_func, {var});
+        continue;
+      }
+      // a local whose address the runtime gets stays in memory, so it is read through a slot of
+      // its own and can still be promoted to registers
+      llvm::Function* function = builder->GetInsertBlock()->getParent();
+      llvm::IRBuilder<> entry_builder(&function->getEntryBlock(),
+                                      function->getEntryBlock().begin());
+      llvm::AllocaInst* slot = entry_builder.CreateAlloca(
+          llvm::cast<llvm::AllocaInst>(var)->getAllocatedType(), nullptr, "read_slot");
+      builder->CreateStore(builder->CreateLoad(var), slot);
+      builder->CreateCall(callee_func, {slot});
+      builder->CreateStore(builder->CreateLoad(slot), var);
     } else {
       LOG(ERROR) << "'read' called with non global variable";
     }
@@ -47,92 +55,164 @@ llvm::Value* CodeGenVisitor::codegen_read_call(const Frontend::AST::CallExpressi
 }
 
 llvm::Value* CodeGenVisitor::codegen_output_call(const Frontend::AST::CallExpression& expression) {
-  if (expression.get_arguments().size() > 1) {
-    codegen_output_many_call(expression);
-    return nullptr;
-  }
-  llvm::Function* callee_func = module->getFunction("printf");
-  if (!callee_func) {
-    LOG(ERROR) << "printf function not found";
-    return nullptr;
+  OutputFormat output_format;
+  if (append_output_call(expression, output_format)) {
+    emit_output_format(output_format);
   }
-  std::vector<llvm::Value*> args;
+  return nullptr;
+}
 
+// A single argument is printed on its own line. With more arguments, integers and booleans are
+// followed by a space, characters are printed as they are and a new line ends the output. Every
+// argument is evaluated before anything is printed.
+bool CodeGenVisitor::append_output_call(const Frontend::AST::CallExpression& expression,
+                                        OutputFormat& output_format) {
+  bool single = expression.get_arguments().size() == 1;
   for (const auto& arg : expression.get_arguments()) {
     arg->accept(*this);
     llvm::Value* arg_val = arg->get_codegen_value();
     if (arg_val == nullptr) {
       LOG(ERROR) << "Unknown argument";
-      return nullptr;
+      return false;
     }
-    llvm::Type* arg_type = arg_val->getType();
-    if (arg_type->isIntegerTy(8)) {
-      args.push_back(builder->CreateGlobalStringPtr("%c\n"));
-      if (arg_type->isPointerTy()) {
-        arg_val = builder->CreateLoad(arg_val);
+
+    // constant arguments become part of the text
+    llvm::ConstantInt* constant = llvm::dyn_cast<llvm::ConstantInt>(arg_val);
+    std::string separator = single ? "\n" : "";
+    if (arg_val->getType()->isIntegerTy(8)) {
+      if (constant) {
+        char character = static_cast<char>(constant->getSExtValue());
+        output_format.format += character == '%' ? "%%" : std::string(1, character);
+        output_format.text += character;
+      } else {
+        output_format.format += "%c";
+        output_format.values.push_back(
+            builder->CreateSExt(arg_val, llvm::Type::getInt32Ty(*context)));
       }
-      args.push_back(arg_val);
     } else {
-      args.push_back(builder->CreateGlobalStringPtr("%d\n"));
-      if (arg_type->isPointerTy()) {
-        arg_val = builder->CreateLoad(arg_val);
+      separator = single ? "\n" : " ";
+      if (constant) {
+        // booleans are printed as 0 or 1
+        std::string digits = std::to_string(arg_val->getType()->isIntegerTy(1)
+                                                ? constant->getZExtValue()
+                                                : constant->getSExtValue());
+        output_format.format += digits;
+        output_format.text += digits;
+      } else {
+        output_format.format += "%d";
+        output_format.values.push_back(
+            builder->CreateZExt(arg_val, llvm::Type::getInt32Ty(*context)));
       }
-      args.push_back(arg_val);
     }
-    builder->CreateCall(callee_func, args);
-    args.clear();
+    output_format.format += separator;
+    output_format.text += separator;
   }
-  return nullptr;
+  if (!single) {
+    output_format.format += "\n";
+    output_format.text += "\n";
+  }
+  return true;
 }
 
-llvm::Value*
-CodeGenVisitor::codegen_output_many_call(const Frontend::AST::CallExpression& expression) {
-  llvm::Function* callee_func = module->getFunction("printf");
-  if (!callee_func) {
-    LOG(ERROR) << "printf function not found";
-    return nullptr;
+void CodeGenVisitor::emit_output_format(const OutputFormat& output_format) {
+  llvm::Type* int_type = llvm::Type::getInt32Ty(*context);
+  if (output_format.values.empty()) {
+    builder->CreateCall(module->getFunction("wz_out_text"),
+                        {get_string_constant(output_format.text),
+                         llvm::ConstantInt::get(int_type, output_format.text.size())});
+    return;
+  }
+  if (output_format.values.size() == 1 && output_format.format == "%d\n") {
+    builder->CreateCall(module->getFunction("wz_out_int"), {output_format.values[0]});
+    return;
+  }
+  if (output_format.values.size() == 1 && output_format.format == "%c\n") {
+    builder->CreateCall(
+        module->getFunction("wz_out_char"),
+        {builder->CreateTrunc(output_format.values[0], llvm::Type::getInt8Ty(*context))});
+    return;
   }
-  std::vector<llvm::Value*> args;
-  std::string format_str = "";
-  std::string str_val = "";
-  bool isChar = false;
 
-  for (const auto& arg : expression.get_arguments()) {
-    arg->accept(*this);
-    llvm::Value* arg_val = arg->get_codegen_value();
-    if (arg_val == nullptr) {
-      LOG(ERROR) << "Unknown argument";
-      return nullptr;
-    }
-    llvm::Type* arg_type = arg_val->getType();
-    if (arg_type->isIntegerTy(8)) {
-      isChar = true;
-      llvm::ConstantInt* constInt = llvm::dyn_cast<llvm::ConstantInt>(arg_val);
-      if (constInt) {
-        char c = static_cast<char>(constInt->getZExtValue());
-        str_val += c;
-      }
-    } else {
-      if (arg_type->isPointerTy()) {
-        arg_val = builder->CreateLoad(arg_val);
-      }
-      args.push_back(arg_val);
-      format_str += "%d ";
-    }
+  // the values are passed in an array on the stack, allocated once in the entry block so that
+  // outputs in loops do not grow the stack
+  llvm::Function* function = builder->GetInsertBlock()->getParent();
+  llvm::IRBuilder<> entry_builder(&function->getEntryBlock(), function->getEntryBlock().begin());
+  llvm::ArrayType* values_type = llvm::ArrayType::get(int_type, output_format.values.size());
+  llvm::AllocaInst* values = entry_builder.CreateAlloca(values_type, nullptr, "output_values");
+  llvm::Value* zero = llvm::ConstantInt::get(int_type, 0);
+  for (size_t i = 0; i < output_format.values.size(); i++) {
+    llvm::Value* index = llvm::ConstantInt::get(int_type, i);
+    builder->CreateStore(output_format.values[i],
+                         builder->CreateInBoundsGEP(values, {zero, index}));
   }
+  builder->CreateCall(module->getFunction("wz_out_format"),
+                      {get_string_constant(output_format.format),
+                       llvm::ConstantInt::get(int_type, output_format.format.size()),
+                       builder->CreateInBoundsGEP(values, {zero, zero})});
+}
 
-  if (isChar) {
-    format_str = "%s\n";
-    llvm::Value* str_val_llvm = builder->CreateGlobalStringPtr(str_val);
-    args.insert(args.begin(), str_val_llvm);
-  } else {
-    format_str += "\n";
+// Whether the expression calls a user function that may print or change the values of later
+// outputs. Functions that access no globals and do no input or output cannot.
+static bool calls_impure_function(const Frontend::AST::Expression& expression,
+                                  const std::map<std::string, FunctionEffects>& effects) {
+  if (const auto* call = dynamic_cast<const Frontend::AST::CallExpression*>(&expression)) {
+    auto function_effects = effects.find(call->get_name());
+    if (function_effects == effects.end() || function_effects->second.accesses_memory()) {
+      return true;
+    }
+    const auto& arguments = call->get_arguments();
+    return std::any_of(arguments.begin(), arguments.end(),
+                       [&](const auto& arg) { return calls_impure_function(*arg, effects); });
+  } else if (const auto* element =
+                 dynamic_cast<const Frontend::AST::IndexExpression*>(&expression)) {
+    return calls_impure_function(element->get_index(), effects);
+  } else if (const auto* binary =
+                 dynamic_cast<const Frontend::AST::BinaryExpression*>(&expression)) {
+    return calls_impure_function(binary->get_lhs(), effects) ||
+           calls_impure_function(binary->get_rhs(), effects);
+  } else if (const auto* unary = dynamic_cast<const Frontend::AST::UnaryExpression*>(&expression)) {
+    return calls_impure_function(unary->get_expression(), effects);
   }
+  return false;
+}
 
-  llvm::Value* format_str_val = builder->CreateGlobalStringPtr(format_str);
-  args.insert(args.begin(), format_str_val);
+static const Frontend::AST::CallExpression*
+as_output_call(const Frontend::AST::Expression& statement) {
+  const auto* call = dynamic_cast<const Frontend::AST::CallExpression*>(&statement);
+  return call && call->get_name() == "output" ? call : nullptr;
+}
 
-  return builder->CreateCall(callee_func, args);
+void CodeGenVisitor::codegen_statements(
+    const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements) {
+  for (size_t i = 0; i < statements.size(); i++) {
+    // With optimizations, consecutive output statements are printed by one runtime call once all
+    // their arguments are evaluated. Only the first of them may call functions that are not pure,
+    // so that the evaluation of later arguments cannot print or see different values. Debug
+    // builds keep one call per statement to step through.
+    const Frontend::AST::CallExpression* output_call = as_output_call(*statements[i]);
+    if (!optimize || debug || !output_call) {
+      statements[i]->accept(*this);
+      continue;
+    }
+    OutputFormat output_format;
+    if (!append_output_call(*output_call, output_format)) {
+      return;
+    }
+    while (i + 1 < statements.size() && (output_call = as_output_call(*statements[i + 1]))) {
+      const auto& arguments = output_call->get_arguments();
+      if (std::any_of(arguments.begin(), arguments.end(),
+                      [&](const auto& arg) {
+                        return calls_impure_function(*arg, function_effects);
+                      })) {
+        break;
+      }
+      if (!append_output_call(*output_call, output_format)) {
+        return;
+      }
+      i++;
+    }
+    emit_output_format(output_format);
+  }
 }
 
 } // namespace Visitor
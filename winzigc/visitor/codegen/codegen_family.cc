@@ -0,0 +1,300 @@
+#include <algorithm>
+
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+
+#include "glog/logging.h"
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Value.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+namespace {
+
+void collect_case_statements(
+    const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements,
+    std::vector<const Frontend::AST::CaseExpression*>& cases) {
+  for (const auto& statement : statements) {
+    if (const auto* if_statement = dynamic_cast<const Frontend::AST::IfExpression*>(&*statement)) {
+      collect_case_statements(if_statement->get_then_statement(), cases);
+      collect_case_statements(if_statement->get_else_statement(), cases);
+    } else if (const auto* for_statement =
+                   dynamic_cast<const Frontend::AST::ForExpression*>(&*statement)) {
+      collect_case_statements(for_statement->get_body_statements(), cases);
+    } else if (const auto* while_statement =
+                   dynamic_cast<const Frontend::AST::WhileExpression*>(&*statement)) {
+      collect_case_statements(while_statement->get_body_statements(), cases);
+    } else if (const auto* repeat_statement =
+                   dynamic_cast<const Frontend::AST::RepeatUntilExpression*>(&*statement)) {
+      collect_case_statements(repeat_statement->get_body_statements(), cases);
+    } else if (const auto* case_statement =
+                   dynamic_cast<const Frontend::AST::CaseExpression*>(&*statement)) {
+      cases.push_back(case_statement);
+      for (const auto& case_clause : case_statement->get_cases()) {
+        collect_case_statements(case_clause.second, cases);
+      }
+      collect_case_statements(case_statement->get_otherwise_clause(), cases);
+    }
+  }
+}
+
+// Values stored by every arm have to be the same, they are evaluated once for the indexed store.
+bool same_value(const Frontend::AST::Expression& lhs, const Frontend::AST::Expression& rhs) {
+  if (dynamic_cast<const Frontend::AST::IndexExpression*>(&lhs) ||
+      dynamic_cast<const Frontend::AST::IndexExpression*>(&rhs)) {
+    return false;
+  }
+  if (const auto* identifier = dynamic_cast<const Frontend::AST::IdentifierExpression*>(&lhs)) {
+    const auto* other = dynamic_cast<const Frontend::AST::IdentifierExpression*>(&rhs);
+    return other && other->get_name() == identifier->get_name();
+  }
+  if (const auto* integer = dynamic_cast<const Frontend::AST::IntegerExpression*>(&lhs)) {
+    const auto* other = dynamic_cast<const Frontend::AST::IntegerExpression*>(&rhs);
+    return other && other->get_value() == integer->get_value();
+  }
+  if (const auto* character = dynamic_cast<const Frontend::AST::CharacterExpression*>(&lhs)) {
+    const auto* other = dynamic_cast<const Frontend::AST::CharacterExpression*>(&rhs);
+    return other && other->get_character() == character->get_character();
+  }
+  if (const auto* boolean = dynamic_cast<const Frontend::AST::BooleanExpression*>(&lhs)) {
+    const auto* other = dynamic_cast<const Frontend::AST::BooleanExpression*>(&rhs);
+    return other && other->get_bool() == boolean->get_bool();
+  }
+  return false;
+}
+
+// The global accessed by an arm that is `<global> := <value>` or `return (<global>)`, where every
+// arm of the case statement has the form of `first_arm`.
+const Frontend::AST::IdentifierExpression*
+get_arm_member(const Frontend::AST::Expression& arm, const Frontend::AST::Expression& first_arm) {
+  const Frontend::AST::IdentifierExpression* member = nullptr;
+  if (const auto* assignment = dynamic_cast<const Frontend::AST::AssignmentExpression*>(&arm)) {
+    const auto* first_assignment =
+        dynamic_cast<const Frontend::AST::AssignmentExpression*>(&first_arm);
+    if (!first_assignment ||
+        !same_value(assignment->get_expression(), first_assignment->get_expression())) {
+      return nullptr;
+    }
+    member = &assignment->get_name();
+  } else if (const auto* return_statement =
+                 dynamic_cast<const Frontend::AST::ReturnExpression*>(&arm)) {
+    if (!dynamic_cast<const Frontend::AST::ReturnExpression*>(&first_arm)) {
+      return nullptr;
+    }
+    member = dynamic_cast<const Frontend::AST::IdentifierExpression*>(
+        &return_statement->get_expression());
+  }
+  if (!member || dynamic_cast<const Frontend::AST::IndexExpression*>(member)) {
+    return nullptr;
+  }
+  return member;
+}
+
+} // namespace
+
+// Legacy programs simulate arrays with a family of globals and case statements like
+// `case index of 1: a1 := value; 2: a2 := value; ... end`. When every arm of a case statement
+// assigns the same value to, or returns, one member of a family of same typed globals selected
+// by consecutive integer labels, the members are stored as one array and the case statement
+// becomes a bounds checked access of it. A global belongs to one family at most, so a case
+// statement ordering members of a family differently keeps its switch.
+void CodeGenVisitor::find_scalar_families(const Frontend::AST::Program& program) {
+  std::map<std::string, const Frontend::AST::GlobalVariable*> globals;
+  for (const auto& var : program.get_variables()) {
+    if (!dynamic_cast<const Frontend::AST::ArrayType*>(&var->get_type())) {
+      globals[var->get_name()] = var.get();
+    }
+  }
+
+  auto find_family_cases =
+      [&](const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements,
+          const std::set<std::string>& local_names) {
+        std::vector<const Frontend::AST::CaseExpression*> cases;
+        collect_case_statements(statements, cases);
+        for (const Frontend::AST::CaseExpression* case_statement : cases) {
+          std::vector<std::string> members;
+          int64_t lower;
+          if (!match_family_case(*case_statement, globals, local_names, members, lower)) {
+            continue;
+          }
+          auto member = family_members.find(members.front());
+          size_t family = scalar_families.size();
+          if (member != family_members.end()) {
+            family = member->second.first;
+            if (scalar_families[family].members != members) {
+              continue;
+            }
+          } else if (std::any_of(members.begin(), members.end(), [&](const std::string& name) {
+                       return family_members.count(name) != 0;
+                     })) {
+            continue;
+          } else {
+            for (size_t position = 0; position < members.size(); position++) {
+              family_members[members[position]] = {family, position};
+            }
+            scalar_families.push_back({members});
+          }
+          family_cases[case_statement] = {family, lower};
+        }
+      };
+
+  find_family_cases(program.get_statements(), {});
+  for (const auto& function : program.get_functions()) {
+    // locals hide the globals of the same name
+    std::set<std::string> local_names = {function->get_name()};
+    for (const auto& param : function->get_parameters()) {
+      local_names.insert(param->get_name());
+    }
+    for (const auto& local_var : function->get_local_var_dclns()) {
+      local_names.insert(local_var->get_name());
+    }
+    for (const auto& constant : function->get_constants()) {
+      local_names.insert(constant->get_name());
+    }
+    for (const auto& type_def : function->get_type_defs()) {
+      local_names.insert(type_def->get_value_names().begin(), type_def->get_value_names().end());
+    }
+    find_family_cases(function->get_function_body_exprs(), local_names);
+  }
+}
+
+bool CodeGenVisitor::match_family_case(
+    const Frontend::AST::CaseExpression& case_statement,
+    const std::map<std::string, const Frontend::AST::GlobalVariable*>& globals,
+    const std::set<std::string>& local_names, std::vector<std::string>& members,
+    int64_t& lower) {
+  if (case_statement.get_expression().get_type_info() != "integer" ||
+      case_statement.get_cases().size() < 2) {
+    return false;
+  }
+  const Frontend::AST::Expression* first_arm = nullptr;
+  llvm::Type* member_type = nullptr;
+  std::map<int64_t, std::string> labeled_members;
+  std::set<std::string> member_names;
+  for (const auto& case_clause : case_statement.get_cases()) {
+    const auto* label_expression =
+        std::get_if<std::unique_ptr<Frontend::AST::Expression>>(&case_clause.first);
+    const auto* label =
+        label_expression
+            ? dynamic_cast<const Frontend::AST::IntegerExpression*>(label_expression->get())
+            : nullptr;
+    if (!label || case_clause.second.size() != 1) {
+      return false;
+    }
+    const Frontend::AST::Expression& arm = *case_clause.second.front();
+    if (!first_arm) {
+      first_arm = &arm;
+    }
+    const Frontend::AST::IdentifierExpression* member = get_arm_member(arm, *first_arm);
+    if (!member || local_names.count(member->get_name()) != 0) {
+      return false;
+    }
+    auto global = globals.find(member->get_name());
+    if (global == globals.end()) {
+      return false;
+    }
+    llvm::Type* type = get_type(global->second->get_type());
+    if (member_type && type != member_type) {
+      return false;
+    }
+    member_type = type;
+    if (!member_names.insert(member->get_name()).second ||
+        !labeled_members.emplace(label->get_value(), member->get_name()).second) {
+      return false;
+    }
+  }
+  lower = labeled_members.begin()->first;
+  if (labeled_members.rbegin()->first - lower + 1 != static_cast<int64_t>(labeled_members.size())) {
+    return false;
+  }
+  members.clear();
+  for (const auto& labeled_member : labeled_members) {
+    members.push_back(labeled_member.second);
+  }
+  return true;
+}
+
+// The members of a family are elements of one global array, created with the first of them; the
+// name of a member refers to its element.
+void CodeGenVisitor::codegen_family_member(const Frontend::AST::GlobalVariable& expression) {
+  auto [family_index, position] = family_members[expression.get_name()];
+  ScalarFamily& family = scalar_families[family_index];
+  llvm::Constant* default_value = get_default_value(expression.get_type());
+  if (!family.storage) {
+    llvm::ArrayType* storage_type =
+        llvm::ArrayType::get(default_value->getType(), family.members.size());
+    family.storage = new llvm::GlobalVariable(
+        *module, storage_type, false, llvm::GlobalValue::InternalLinkage,
+        llvm::ConstantAggregateZero::get(storage_type), family.members.front() + ".family");
+  }
+  llvm::Type* index_type = llvm::Type::getInt64Ty(*context);
+  llvm::Constant* element = llvm::ConstantExpr::getInBoundsGetElementPtr(
+      family.storage->getValueType(), family.storage,
+      llvm::ArrayRef<llvm::Constant*>{llvm::ConstantInt::get(index_type, 0),
+                                      llvm::ConstantInt::get(index_type, position)});
+  /* Debug Information Start */
+  if (debug) {
+    llvm::DIFile* unit =
+        debug_builder->createFile(compile_unit->getFilename(), compile_unit->getDirectory());
+    llvm::DIType* type = debug_get_type(expression.get_type());
+    uint64_t offset =
+        module->getDataLayout().getTypeAllocSize(default_value->getType()).getFixedSize() *
+        position;
+    llvm::DIExpression* location =
+        offset == 0 ? debug_builder->createExpression()
+                    : debug_builder->createExpression(
+                          llvm::ArrayRef<uint64_t>{llvm::dwarf::DW_OP_plus_uconst, offset});
+    family.storage->addDebugInfo(debug_builder->createGlobalVariableExpression(
+        compile_unit, expression.get_name(), expression.get_name(), unit, 1, type, false, true,
+        location));
+  }
+  /* Debug Information End   */
+  global_variables[llvm::StringRef(expression.get_name())] = element;
+}
+
+void CodeGenVisitor::codegen_family_case(const Frontend::AST::CaseExpression& expression) {
+  emit_location(&expression);
+  const FamilyCase& family_case = family_cases[&expression];
+  const ScalarFamily& family = scalar_families[family_case.family];
+  llvm::Function* function = builder->GetInsertBlock()->getParent();
+  llvm::BasicBlock* member_block = llvm::BasicBlock::Create(*context, "case_member", function);
+  llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(*context, "case_exit");
+
+  expression.get_expression().accept(*this);
+  llvm::Value* offset =
+      builder->CreateSub(builder->CreateSExt(expression.get_expression().get_codegen_value(),
+                                             builder->getInt64Ty()),
+                         builder->getInt64(family_case.lower), "member_index");
+  // labels outside the family select no arm, like the default of the switch
+  builder->CreateCondBr(builder->CreateICmpULT(offset, builder->getInt64(family.members.size())),
+                        member_block, exit_block);
+
+  builder->SetInsertPoint(member_block);
+  llvm::Value* member =
+      builder->CreateInBoundsGEP(family.storage, {builder->getInt64(0), offset}, "member");
+  const Frontend::AST::Expression& arm = *expression.get_cases().front().second.front();
+  if (const auto* assignment = dynamic_cast<const Frontend::AST::AssignmentExpression*>(&arm)) {
+    emit_location(assignment);
+    assignment->get_expression().accept(*this);
+    builder->CreateStore(assignment->get_expression().get_codegen_value(), member);
+    builder->CreateBr(exit_block);
+  } else {
+    emit_location(&arm);
+    llvm::Value* return_var = lookup_variable(function->getName().str());
+    if (!return_var) {
+      LOG(ERROR) << "Unknown return variable name";
+      return;
+    }
+    builder->CreateStore(builder->CreateLoad(member), return_var);
+    builder->CreateBr(function_exit_block);
+  }
+
+  function->getBasicBlockList().push_back(exit_block);
+  builder->SetInsertPoint(exit_block);
+  codegen_statements(expression.get_otherwise_clause());
+}
+
+} // namespace Visitor
+} // namespace WinZigC
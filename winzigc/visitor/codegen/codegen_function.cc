@@ -7,25 +7,57 @@ namespace WinZigC {
 namespace Visitor {
 
 void CodeGenVisitor::visit(const Frontend::AST::Function& function) {
-  // create function signature
-  llvm::FunctionType* func_type = codegen_func_dcln(function);
-  llvm::Function::Create(func_type, llvm::Function::ExternalLinkage, function.get_name(),
-                         module.get());
-
   // create function body
   codegen_func_def(function);
+  if (explicit_stack && !memoized_functions.count(function.get_name())) {
+    codegen_explicit_stack(module->getFunction(function.get_name()));
+  }
   local_variables.clear();
   local_user_def_type_consts.clear();
+  local_constants.clear();
   function_exit_block = nullptr;
+  function_body_block = nullptr;
+  current_function = nullptr;
+
+  if (memoized_functions.count(function.get_name())) {
+    codegen_memo_wrapper(function);
+  }
 }
 
-llvm::FunctionType* CodeGenVisitor::codegen_func_dcln(const Frontend::AST::Function& function) {
+// Every function is declared before the first body is generated, so that calls can go to the
+// functions defined later and functions can recurse mutually. Only main is called from outside
+// the module, which leaves the calling convention to us: fastcc lets the backend guarantee tail
+// calls between functions of different types, see codegen_tail_call.
+llvm::Function* CodeGenVisitor::codegen_func_dcln(const Frontend::AST::Function& function) {
   std::vector<llvm::Type*> param_types;
   for (const auto& param : function.get_parameters()) {
     param_types.push_back(get_type(param->get_type()));
   }
   llvm::Type* return_type = get_type(function.get_return_type());
-  return llvm::FunctionType::get(return_type, param_types, false);
+  llvm::FunctionType* func_type = llvm::FunctionType::get(return_type, param_types, false);
+  llvm::Function* llvm_function = llvm::Function::Create(
+      func_type, llvm::Function::InternalLinkage, function.get_name(), module.get());
+  llvm_function->setCallingConv(llvm::CallingConv::Fast);
+  add_function_attributes(llvm_function, function_effects[function.get_name()]);
+  return llvm_function;
+}
+
+// WinZig has no exceptions, everything else follows from the effect analysis. A function is only
+// known to return when neither it nor its callees loop or recurse.
+void CodeGenVisitor::add_function_attributes(llvm::Function* function,
+                                             const FunctionEffects& effects) {
+  function->setDoesNotThrow();
+  if (!effects.accesses_memory()) {
+    function->setDoesNotAccessMemory();
+  } else if (effects.only_reads_memory()) {
+    function->setOnlyReadsMemory();
+  }
+  if (!effects.recursive) {
+    function->setDoesNotRecurse();
+  }
+  if (!effects.may_diverge) {
+    function->addFnAttr(llvm::Attribute::WillReturn);
+  }
 }
 
 void CodeGenVisitor::codegen_func_def(const Frontend::AST::Function& function) {
@@ -84,6 +116,10 @@ void CodeGenVisitor::codegen_func_def(const Frontend::AST::Function& function) {
     builder->CreateStore(&param, alloca);
   }
 
+  for (const auto& constant : function.get_constants()) {
+    constant->accept(*this);
+  }
+
   for (const auto& type_def : function.get_type_defs()) {
     type_def->accept(*this);
   }
@@ -93,9 +129,13 @@ void CodeGenVisitor::codegen_func_def(const Frontend::AST::Function& function) {
   }
   builder->SetCurrentDebugLocation(llvm::DebugLoc());
 
-  for (const auto& expr : function.get_function_body_exprs()) {
-    expr->accept(*this);
-  }
+  // self tail calls start over from here, see codegen_tail_recursion
+  current_function = &function;
+  function_body_block = llvm::BasicBlock::Create(*context, "body", llvm_function);
+  builder->CreateBr(function_body_block);
+  builder->SetInsertPoint(function_body_block);
+
+  codegen_statements(function.get_function_body_exprs());
 
   if (!builder->GetInsertBlock()->getTerminator()) {
     builder->CreateBr(function_exit_block);
@@ -0,0 +1,159 @@
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+#include "winzigc/runtime/wz_runtime.h"
+
+#include "glog/logging.h"
+#include "llvm/ExecutionEngine/JITSymbol.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/Support/Error.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+llvm::Error CodeGenVisitor::define_runtime_symbols(llvm::orc::LLJIT& jit,
+                                                  llvm::orc::JITDylib& dylib) {
+  llvm::orc::SymbolMap runtime_symbols;
+  auto define = [&](const char* name, auto* address) {
+    runtime_symbols[jit.mangleAndIntern(name)] = llvm::JITEvaluatedSymbol(
+        llvm::pointerToJITTargetAddress(address), llvm::JITSymbolFlags::Exported);
+  };
+  define("wz_out_int", &wz_out_int);
+  define("wz_out_char", &wz_out_char);
+  define("wz_out_text", &wz_out_text);
+  define("wz_out_format", &wz_out_format);
+  define("wz_flush", &wz_flush);
+  define("wz_read_int", &wz_read_int);
+  define("wz_read_char", &wz_read_char);
+  define("wz_memo_find", &wz_memo_find);
+  define("wz_memo_insert", &wz_memo_insert);
+  define("wz_memo_report", &wz_memo_report);
+  define("wz_frames_grow", &wz_frames_grow);
+  define("wz_frames_free", &wz_frames_free);
+  return dylib.define(llvm::orc::absoluteSymbols(std::move(runtime_symbols)));
+}
+
+// Like the object files, JIT compiled code guarantees the fastcc tail calls.
+llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>> CodeGenVisitor::create_jit() {
+  auto target_machine_builder = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!target_machine_builder) {
+    return target_machine_builder.takeError();
+  }
+  target_machine_builder->getOptions().GuaranteedTailCallOpt = true;
+  return llvm::orc::LLJITBuilder()
+      .setJITTargetMachineBuilder(std::move(*target_machine_builder))
+      .create();
+}
+
+int CodeGenVisitor::run_jit() {
+  auto jit = create_jit();
+  if (!jit) {
+    LOG(ERROR) << "Could not create the JIT: " << llvm::toString(jit.takeError());
+    return 1;
+  }
+
+  // the runtime library is linked into the compiler, libc functions the optimizer may introduce are
+  // resolved from the host process
+  auto process_symbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      (*jit)->getDataLayout().getGlobalPrefix());
+  if (!process_symbols) {
+    LOG(ERROR) << "Could not load host process symbols: "
+               << llvm::toString(process_symbols.takeError());
+    return 1;
+  }
+  (*jit)->getMainJITDylib().addGenerator(std::move(*process_symbols));
+  if (auto error = define_runtime_symbols(**jit, (*jit)->getMainJITDylib())) {
+    LOG(ERROR) << "Could not define the runtime symbols: " << llvm::toString(std::move(error));
+    return 1;
+  }
+
+  // the JIT takes the ownership of the module together with its context, so anything still
+  // referring to the context has to go first
+  debug_builder.reset();
+  builder.reset();
+  module->setDataLayout((*jit)->getDataLayout());
+  llvm::orc::ThreadSafeModule thread_safe_module(std::move(module), std::move(context));
+  if (auto error = (*jit)->addIRModule(std::move(thread_safe_module))) {
+    LOG(ERROR) << "Could not add the module to the JIT: " << llvm::toString(std::move(error));
+    return 1;
+  }
+
+  auto main_symbol = (*jit)->lookup("main");
+  if (!main_symbol) {
+    LOG(ERROR) << "Could not find main: " << llvm::toString(main_symbol.takeError());
+    return 1;
+  }
+  auto* main_function = reinterpret_cast<int (*)()>(main_symbol->getAddress());
+  return main_function();
+}
+
+// Turns the program module into a tier up module: only the given functions keep their bodies,
+// the program globals become external declarations named `kTierGlobalPrefix + name` so that the
+// JIT can bind them to the interpreter storage, and every function gets an entry thunk taking its
+// arguments as an array of 32 bit slots.
+llvm::orc::ThreadSafeModule
+CodeGenVisitor::release_tier_module(const std::set<std::string>& functions) {
+  if (llvm::Function* main_function = module->getFunction("main")) {
+    main_function->eraseFromParent();
+  }
+
+  std::vector<llvm::Function*> unused_functions;
+  for (auto& function : *module) {
+    if (!function.isDeclaration() && functions.count(function.getName().str()) == 0) {
+      function.deleteBody();
+      unused_functions.push_back(&function);
+    }
+  }
+  for (llvm::Function* function : unused_functions) {
+    if (function->use_empty()) {
+      function->eraseFromParent();
+    }
+  }
+
+  for (auto& global : module->globals()) {
+    // format strings are constants and stay in the module
+    if (global.isConstant()) {
+      continue;
+    }
+    global.setName(kTierGlobalPrefix + global.getName().str());
+    global.setInitializer(nullptr);
+    global.setLinkage(llvm::GlobalValue::ExternalLinkage);
+  }
+
+  llvm::Type* slot_type = llvm::Type::getInt32Ty(*context);
+  llvm::FunctionType* entry_type =
+      llvm::FunctionType::get(slot_type, slot_type->getPointerTo(), false);
+  for (const auto& name : functions) {
+    llvm::Function* function = module->getFunction(name);
+    if (!function || function->isDeclaration()) {
+      continue;
+    }
+    llvm::Function* entry = llvm::Function::Create(entry_type, llvm::Function::ExternalLinkage,
+                                                   name + kTierEntrySuffix, module.get());
+    builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", entry));
+    std::vector<llvm::Value*> args;
+    for (auto& param : function->args()) {
+      llvm::Value* slot = builder->CreateInBoundsGEP(
+          entry->getArg(0), llvm::ConstantInt::get(slot_type, param.getArgNo()));
+      args.push_back(builder->CreateTrunc(builder->CreateLoad(slot), param.getType()));
+    }
+    llvm::CallInst* call = builder->CreateCall(function, args);
+    call->setCallingConv(function->getCallingConv());
+    // the interpreter holds characters sign extended and booleans as 0 or 1
+    llvm::Value* return_value = function->getReturnType()->isIntegerTy(8)
+                                    ? builder->CreateSExt(call, slot_type)
+                                    : builder->CreateZExt(call, slot_type);
+    builder->CreateRet(return_value);
+  }
+  run_module_optimizations(2);
+
+  debug_builder.reset();
+  builder.reset();
+  return llvm::orc::ThreadSafeModule(std::move(module), std::move(context));
+}
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -0,0 +1,402 @@
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+
+#include <limits>
+
+#include "glog/logging.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Metadata.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+namespace {
+
+void collect_accesses(const Frontend::AST::Expression& expression,
+                      CodeGenVisitor::LoopAccesses& accesses);
+
+void collect_accesses(const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements,
+                      CodeGenVisitor::LoopAccesses& accesses) {
+  for (const auto& statement : statements) {
+    collect_accesses(*statement, accesses);
+  }
+}
+
+void collect_variable(const Frontend::AST::IdentifierExpression& variable, bool write,
+                      CodeGenVisitor::LoopAccesses& accesses) {
+  (write ? accesses.writes : accesses.reads).insert(variable.get_name());
+  if (const auto* element = dynamic_cast<const Frontend::AST::IndexExpression*>(&variable)) {
+    collect_accesses(element->get_index(), accesses);
+  }
+}
+
+void collect_accesses(const Frontend::AST::Expression& expression,
+                      CodeGenVisitor::LoopAccesses& accesses) {
+  if (const auto* call = dynamic_cast<const Frontend::AST::CallExpression*>(&expression)) {
+    if (call->get_name() == "read") {
+      for (const auto& arg : call->get_arguments()) {
+        if (const auto* variable =
+                dynamic_cast<const Frontend::AST::IdentifierExpression*>(arg.get())) {
+          collect_variable(*variable, true, accesses);
+        }
+      }
+      return;
+    }
+    if (call->get_name() != "output") {
+      accesses.callees.insert(call->get_name());
+    }
+    collect_accesses(call->get_arguments(), accesses);
+  } else if (const auto* variable =
+                 dynamic_cast<const Frontend::AST::IdentifierExpression*>(&expression)) {
+    collect_variable(*variable, false, accesses);
+  } else if (const auto* assignment =
+                 dynamic_cast<const Frontend::AST::AssignmentExpression*>(&expression)) {
+    collect_variable(assignment->get_name(), true, accesses);
+    collect_accesses(assignment->get_expression(), accesses);
+  } else if (const auto* swap = dynamic_cast<const Frontend::AST::SwapExpression*>(&expression)) {
+    for (const auto* side : {&swap->get_lhs(), &swap->get_rhs()}) {
+      collect_variable(*side, false, accesses);
+      collect_variable(*side, true, accesses);
+    }
+  } else if (const auto* if_expr = dynamic_cast<const Frontend::AST::IfExpression*>(&expression)) {
+    collect_accesses(if_expr->get_condition(), accesses);
+    collect_accesses(if_expr->get_then_statement(), accesses);
+    collect_accesses(if_expr->get_else_statement(), accesses);
+  } else if (const auto* for_expr =
+                 dynamic_cast<const Frontend::AST::ForExpression*>(&expression)) {
+    collect_accesses(for_expr->get_start_assignment(), accesses);
+    collect_accesses(for_expr->get_condition(), accesses);
+    collect_accesses(for_expr->get_end_assignment(), accesses);
+    collect_accesses(for_expr->get_body_statements(), accesses);
+  } else if (const auto* repeat_expr =
+                 dynamic_cast<const Frontend::AST::RepeatUntilExpression*>(&expression)) {
+    collect_accesses(repeat_expr->get_condition(), accesses);
+    collect_accesses(repeat_expr->get_body_statements(), accesses);
+  } else if (const auto* while_expr =
+                 dynamic_cast<const Frontend::AST::WhileExpression*>(&expression)) {
+    collect_accesses(while_expr->get_condition(), accesses);
+    collect_accesses(while_expr->get_body_statements(), accesses);
+  } else if (const auto* case_expr =
+                 dynamic_cast<const Frontend::AST::CaseExpression*>(&expression)) {
+    // case labels are constants
+    collect_accesses(case_expr->get_expression(), accesses);
+    for (const auto& case_clause : case_expr->get_cases()) {
+      collect_accesses(case_clause.second, accesses);
+    }
+    collect_accesses(case_expr->get_otherwise_clause(), accesses);
+  } else if (const auto* return_expr =
+                 dynamic_cast<const Frontend::AST::ReturnExpression*>(&expression)) {
+    collect_accesses(return_expr->get_expression(), accesses);
+  } else if (const auto* binary_expr =
+                 dynamic_cast<const Frontend::AST::BinaryExpression*>(&expression)) {
+    collect_accesses(binary_expr->get_lhs(), accesses);
+    collect_accesses(binary_expr->get_rhs(), accesses);
+  } else if (const auto* unary_expr =
+                 dynamic_cast<const Frontend::AST::UnaryExpression*>(&expression)) {
+    collect_accesses(unary_expr->get_expression(), accesses);
+  }
+}
+
+const Frontend::AST::IdentifierExpression* as_scalar(const Frontend::AST::Expression& expression) {
+  const auto* variable = dynamic_cast<const Frontend::AST::IdentifierExpression*>(&expression);
+  if (!variable || dynamic_cast<const Frontend::AST::IndexExpression*>(variable)) {
+    return nullptr;
+  }
+  return variable;
+}
+
+const llvm::ConstantInt* as_integer_constant(const Frontend::AST::Expression& expression) {
+  const auto* constant = llvm::dyn_cast_or_null<llvm::ConstantInt>(expression.get_codegen_value());
+  return constant && constant->getBitWidth() == 32 ? constant : nullptr;
+}
+
+} // namespace
+
+// Loops are lowered in rotated form: a guard evaluates the condition once before the loop and
+// skips it when it fails, a preheader leads into the body, and the latch at the end of the body
+// evaluates the condition again and branches back, or to an exit block of the loop's own. Every
+// loop is entered and left in one place and runs its body before its first test, which is the
+// shape the loop passes of LLVM expect.
+void CodeGenVisitor::visit(const Frontend::AST::ForExpression& expression) {
+  emit_location(&expression);
+  llvm::Function* function = builder->GetInsertBlock()->getParent();
+  llvm::BasicBlock* preheader_block = llvm::BasicBlock::Create(*context, "for_preheader");
+  llvm::BasicBlock* body_block = llvm::BasicBlock::Create(*context, "for_body");
+  llvm::BasicBlock* latch_block = llvm::BasicBlock::Create(*context, "for_latch");
+  llvm::BasicBlock* loop_exit_block = llvm::BasicBlock::Create(*context, "for_loop_exit");
+  llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(*context, "for_exit");
+
+  LoopAccesses body_accesses;
+  collect_accesses(expression.get_condition(), body_accesses);
+  collect_accesses(expression.get_body_statements(), body_accesses);
+  LoopAccesses accesses = body_accesses;
+  collect_accesses(expression.get_end_assignment(), accesses);
+
+  expression.get_start_assignment().accept(*this);
+  expression.get_condition().accept(*this);
+  builder->CreateCondBr(expression.get_condition().get_codegen_value(), preheader_block,
+                        exit_block);
+
+  function->getBasicBlockList().push_back(preheader_block);
+  builder->SetInsertPoint(preheader_block);
+  std::vector<llvm::StringRef> hoisted = hoist_invariant_globals(accesses);
+  builder->CreateBr(body_block);
+
+  function->getBasicBlockList().push_back(body_block);
+  builder->SetInsertPoint(body_block);
+  codegen_statements(expression.get_body_statements());
+  if (!builder->GetInsertBlock()->getTerminator()) {
+    builder->CreateBr(latch_block);
+  }
+
+  function->getBasicBlockList().push_back(latch_block);
+  builder->SetInsertPoint(latch_block);
+  expression.get_end_assignment().accept(*this);
+  expression.get_condition().accept(*this);
+  llvm::BranchInst* latch_branch = builder->CreateCondBr(
+      expression.get_condition().get_codegen_value(), body_block, loop_exit_block);
+  if (optimize) {
+    set_loop_hints(latch_branch, get_trip_count(expression, body_accesses));
+  }
+  for (llvm::StringRef name : hoisted) {
+    local_variables.erase(name);
+  }
+
+  function->getBasicBlockList().push_back(loop_exit_block);
+  builder->SetInsertPoint(loop_exit_block);
+  builder->CreateBr(exit_block);
+  function->getBasicBlockList().push_back(exit_block);
+  builder->SetInsertPoint(exit_block);
+}
+
+void CodeGenVisitor::visit(const Frontend::AST::RepeatUntilExpression& expression) {
+  emit_location(&expression);
+  llvm::Function* function = builder->GetInsertBlock()->getParent();
+  llvm::BasicBlock* preheader_block =
+      llvm::BasicBlock::Create(*context, "repeat_preheader", function);
+  llvm::BasicBlock* body_block = llvm::BasicBlock::Create(*context, "repeat_body");
+  llvm::BasicBlock* cond_block = llvm::BasicBlock::Create(*context, "repeat_cond");
+  llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(*context, "repeat_exit");
+
+  LoopAccesses accesses;
+  collect_accesses(expression.get_body_statements(), accesses);
+  collect_accesses(expression.get_condition(), accesses);
+
+  builder->CreateBr(preheader_block);
+  builder->SetInsertPoint(preheader_block);
+  std::vector<llvm::StringRef> hoisted = hoist_invariant_globals(accesses);
+  builder->CreateBr(body_block);
+
+  function->getBasicBlockList().push_back(body_block);
+  builder->SetInsertPoint(body_block);
+  codegen_statements(expression.get_body_statements());
+  if (!builder->GetInsertBlock()->getTerminator()) {
+    builder->CreateBr(cond_block);
+  }
+
+  function->getBasicBlockList().push_back(cond_block);
+  builder->SetInsertPoint(cond_block);
+  expression.get_condition().accept(*this);
+  llvm::Value* cond = expression.get_condition().get_codegen_value();
+  builder->CreateCondBr(cond, exit_block, body_block);
+  for (llvm::StringRef name : hoisted) {
+    local_variables.erase(name);
+  }
+
+  function->getBasicBlockList().push_back(exit_block);
+  builder->SetInsertPoint(exit_block);
+}
+
+void CodeGenVisitor::visit(const Frontend::AST::WhileExpression& expression) {
+  emit_location(&expression);
+  llvm::Function* function = builder->GetInsertBlock()->getParent();
+  llvm::BasicBlock* preheader_block = llvm::BasicBlock::Create(*context, "while_preheader");
+  llvm::BasicBlock* body_block = llvm::BasicBlock::Create(*context, "while_body");
+  llvm::BasicBlock* latch_block = llvm::BasicBlock::Create(*context, "while_latch");
+  llvm::BasicBlock* loop_exit_block = llvm::BasicBlock::Create(*context, "while_loop_exit");
+  llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(*context, "while_exit");
+
+  LoopAccesses accesses;
+  collect_accesses(expression.get_condition(), accesses);
+  collect_accesses(expression.get_body_statements(), accesses);
+
+  expression.get_condition().accept(*this);
+  builder->CreateCondBr(expression.get_condition().get_codegen_value(), preheader_block,
+                        exit_block);
+
+  function->getBasicBlockList().push_back(preheader_block);
+  builder->SetInsertPoint(preheader_block);
+  std::vector<llvm::StringRef> hoisted = hoist_invariant_globals(accesses);
+  builder->CreateBr(body_block);
+
+  function->getBasicBlockList().push_back(body_block);
+  builder->SetInsertPoint(body_block);
+  codegen_statements(expression.get_body_statements());
+  if (!builder->GetInsertBlock()->getTerminator()) {
+    builder->CreateBr(latch_block);
+  }
+
+  function->getBasicBlockList().push_back(latch_block);
+  builder->SetInsertPoint(latch_block);
+  expression.get_condition().accept(*this);
+  builder->CreateCondBr(expression.get_condition().get_codegen_value(), body_block,
+                        loop_exit_block);
+  for (llvm::StringRef name : hoisted) {
+    local_variables.erase(name);
+  }
+
+  function->getBasicBlockList().push_back(loop_exit_block);
+  builder->SetInsertPoint(loop_exit_block);
+  builder->CreateBr(exit_block);
+  function->getBasicBlockList().push_back(exit_block);
+  builder->SetInsertPoint(exit_block);
+}
+
+// With optimizations, the scalar globals a loop reads but neither writes nor calls a function
+// touching are loaded once in the preheader, into locals standing for them until the loop ends.
+// The optimizer cannot tell which globals a called function touches, only whether it touches
+// any. Returns the names bound to these locals.
+std::vector<llvm::StringRef> CodeGenVisitor::hoist_invariant_globals(const LoopAccesses& accesses) {
+  std::vector<llvm::StringRef> hoisted;
+  if (!optimize) {
+    return hoisted;
+  }
+  std::set<std::string> touched_by_callees;
+  for (const auto& callee : accesses.callees) {
+    const auto& globals = function_effects[callee].globals;
+    touched_by_callees.insert(globals.begin(), globals.end());
+  }
+  llvm::Function* function = builder->GetInsertBlock()->getParent();
+  llvm::IRBuilder<> entry_builder(&function->getEntryBlock(), function->getEntryBlock().begin());
+  for (const auto& name : accesses.reads) {
+    auto global_variable = global_variables.find(llvm::StringRef(name));
+    // main keeps the globals in locals already, and a local hides the global of its name
+    if (global_variable == global_variables.end() ||
+        local_variables.count(global_variable->first) || accesses.writes.count(name) ||
+        touched_by_callees.count(name)) {
+      continue;
+    }
+    auto* global = llvm::dyn_cast<llvm::GlobalVariable>(global_variable->second);
+    if (!global || global->getValueType()->isArrayTy()) {
+      continue;
+    }
+    llvm::AllocaInst* alloca =
+        entry_builder.CreateAlloca(global->getValueType(), nullptr, name + ".invariant");
+    builder->CreateStore(builder->CreateLoad(global), alloca);
+    local_variables[global_variable->first] = alloca;
+    hoisted.push_back(global_variable->first);
+  }
+  return hoisted;
+}
+
+// The number of times `for (i := first; i <= bound; i := i + step)` runs its body, with `<`, `>`
+// or `>=` in place of `<=` and `-` in place of `+` as well, when first, bound and step are
+// constants and nothing else in the loop assigns the counter. Counters that would wrap around
+// past the bound are left alone.
+std::optional<int64_t> CodeGenVisitor::get_trip_count(const Frontend::AST::ForExpression& loop,
+                                                      const LoopAccesses& body_accesses) {
+  const auto* start = dynamic_cast<const Frontend::AST::AssignmentExpression*>(
+      &loop.get_start_assignment());
+  const auto* condition =
+      dynamic_cast<const Frontend::AST::BinaryExpression*>(&loop.get_condition());
+  const auto* end =
+      dynamic_cast<const Frontend::AST::AssignmentExpression*>(&loop.get_end_assignment());
+  if (!start || !condition || !end) {
+    return std::nullopt;
+  }
+  const auto* increment =
+      dynamic_cast<const Frontend::AST::BinaryExpression*>(&end->get_expression());
+  if (!increment || (increment->get_op() != Frontend::AST::BinaryOperation::kAdd &&
+                     increment->get_op() != Frontend::AST::BinaryOperation::kSubtract)) {
+    return std::nullopt;
+  }
+  const std::string& counter = start->get_name().get_name();
+  for (const auto* variable : {as_scalar(start->get_name()), as_scalar(condition->get_lhs()),
+                               as_scalar(end->get_name()), as_scalar(increment->get_lhs())}) {
+    if (!variable || variable->get_name() != counter) {
+      return std::nullopt;
+    }
+  }
+  if (body_accesses.writes.count(counter)) {
+    return std::nullopt;
+  }
+  // a function called in the loop may assign a global counter, also one main keeps in a local
+  if (!local_variables.count(counter) || main_globals.count(counter)) {
+    for (const auto& callee : body_accesses.callees) {
+      if (function_effects[callee].globals.count(counter)) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  const llvm::ConstantInt* first = as_integer_constant(start->get_expression());
+  const llvm::ConstantInt* bound = as_integer_constant(condition->get_rhs());
+  const llvm::ConstantInt* step = as_integer_constant(increment->get_rhs());
+  if (!first || !bound || !step || step->isZero()) {
+    return std::nullopt;
+  }
+  int64_t first_value = first->getSExtValue();
+  int64_t last_value = bound->getSExtValue();
+  int64_t step_value = step->getSExtValue();
+  if (increment->get_op() == Frontend::AST::BinaryOperation::kSubtract) {
+    step_value = -step_value;
+  }
+  switch (condition->get_op()) {
+  case Frontend::AST::BinaryOperation::kLessThan:
+    last_value--;
+    [[fallthrough]];
+  case Frontend::AST::BinaryOperation::kLessThanOrEqual:
+    if (step_value < 0) {
+      return std::nullopt;
+    }
+    break;
+  case Frontend::AST::BinaryOperation::kGreaterThan:
+    last_value++;
+    [[fallthrough]];
+  case Frontend::AST::BinaryOperation::kGreaterThanOrEqual:
+    if (step_value > 0) {
+      return std::nullopt;
+    }
+    break;
+  default:
+    return std::nullopt;
+  }
+  int64_t distance = step_value > 0 ? last_value - first_value : first_value - last_value;
+  int64_t trip_count = distance < 0 ? 0 : distance / std::abs(step_value) + 1;
+  // the value failing the condition has to be reached without wrapping around
+  int64_t exit_value = first_value + trip_count * step_value;
+  if (exit_value < std::numeric_limits<int32_t>::min() ||
+      exit_value > std::numeric_limits<int32_t>::max()) {
+    return std::nullopt;
+  }
+  return trip_count;
+}
+
+// A known trip count becomes the weights of the latch branch, which LLVM estimates trip counts
+// from, and loops running at most kMaxFullUnrollTripCount times are marked to be unrolled fully.
+void CodeGenVisitor::set_loop_hints(llvm::BranchInst* latch_branch,
+                                    std::optional<int64_t> trip_count) {
+  if (!trip_count || *trip_count < 1) {
+    return;
+  }
+  llvm::MDBuilder md_builder(*context);
+  latch_branch->setMetadata(
+      llvm::LLVMContext::MD_prof,
+      md_builder.createBranchWeights(static_cast<uint32_t>(std::min<int64_t>(
+                                         *trip_count - 1, std::numeric_limits<uint32_t>::max())),
+                                     1));
+  if (*trip_count > kMaxFullUnrollTripCount) {
+    return;
+  }
+  llvm::TempMDTuple placeholder = llvm::MDNode::getTemporary(*context, llvm::None);
+  llvm::Metadata* unroll_full =
+      llvm::MDNode::get(*context, llvm::MDString::get(*context, "llvm.loop.unroll.full"));
+  llvm::MDNode* loop_id = llvm::MDNode::getDistinct(*context, {placeholder.get(), unroll_full});
+  loop_id->replaceOperandWith(0, loop_id);
+  latch_branch->setMetadata(llvm::LLVMContext::MD_loop, loop_id);
+}
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -0,0 +1,147 @@
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+
+#include "glog/logging.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Value.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+// Only functions computing their result from their arguments alone can be cached, and only the
+// recursive ones call themselves often enough with the same arguments to make it pay. A recursion
+// made only of tail calls never calls with the same arguments twice, and going through the
+// wrapper would give each of its calls a frame of its own, see codegen_tail_call.
+bool CodeGenVisitor::is_memoizable(const Frontend::AST::Function& function) const {
+  auto effects = function_effects.find(function.get_name());
+  return effects != function_effects.end() && !effects->second.accesses_memory() &&
+         effects->second.recursive && !effects->second.tail_recursive;
+}
+
+// Moves the generated function to `<name><kMemoBodySuffix>` and puts a wrapper under its name
+// that looks the arguments up before calling it, so recursive calls go through the cache too.
+// Arguments and results are widened to 32 bits. When the arguments are booleans and characters
+// with few combinations, the cache is a zero initialized table of 64 bit slots indexed by them,
+// holding the result and a set bit 32; otherwise it is a hash table of the runtime library.
+void CodeGenVisitor::codegen_memo_wrapper(const Frontend::AST::Function& function) {
+  const std::string& name = function.get_name();
+  llvm::Function* body = module->getFunction(name);
+  llvm::Function* wrapper = llvm::Function::Create(
+      body->getFunctionType(), llvm::Function::InternalLinkage, "", module.get());
+  wrapper->setCallingConv(body->getCallingConv());
+  add_function_attributes(wrapper, function_effects[name]);
+  body->replaceAllUsesWith(wrapper);
+  body->setName(name + kMemoBodySuffix);
+  wrapper->setName(name);
+
+  llvm::Type* int_type = llvm::Type::getInt32Ty(*context);
+  llvm::Type* int64_type = llvm::Type::getInt64Ty(*context);
+  llvm::Function* find_function = module->getFunction("wz_memo_find");
+  llvm::Type* table_type =
+      find_function->getFunctionType()->getParamType(0)->getPointerElementType();
+  llvm::GlobalVariable* table = new llvm::GlobalVariable(
+      *module, table_type, false, llvm::GlobalValue::InternalLinkage,
+      llvm::Constant::getNullValue(table_type), name + ".memo");
+  memo_tables.emplace_back(name, table);
+
+  // the wrapper has no debug information of its own
+  builder->SetCurrentDebugLocation(llvm::DebugLoc());
+  builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", wrapper));
+  auto widen = [&](llvm::Value* value) {
+    return value->getType()->isIntegerTy(8) ? builder->CreateSExt(value, int_type)
+                                            : builder->CreateZExtOrTrunc(value, int_type);
+  };
+  auto count = [&](unsigned field) {
+    if (!memoize_stats) {
+      return;
+    }
+    llvm::Value* counter = builder->CreateStructGEP(table, field);
+    builder->CreateStore(builder->CreateAdd(builder->CreateLoad(counter),
+                                            llvm::ConstantInt::get(int64_type, 1)),
+                         counter);
+  };
+
+  std::vector<llvm::Value*> args;
+  int64_t combinations = 1;
+  for (auto& arg : wrapper->args()) {
+    args.push_back(&arg);
+    if (arg.getType()->isIntegerTy(1)) {
+      combinations *= 2;
+    } else if (arg.getType()->isIntegerTy(8)) {
+      combinations *= 256;
+    } else {
+      combinations = kMaxMemoDirectEntries + 1;
+    }
+    combinations = std::min(combinations, kMaxMemoDirectEntries + 1);
+  }
+
+  llvm::BasicBlock* hit_block = llvm::BasicBlock::Create(*context, "memo_hit", wrapper);
+  llvm::BasicBlock* miss_block = llvm::BasicBlock::Create(*context, "memo_miss", wrapper);
+  llvm::Type* return_type = body->getReturnType();
+  if (combinations <= kMaxMemoDirectEntries) {
+    llvm::ArrayType* entries_type = llvm::ArrayType::get(int64_type, combinations);
+    llvm::GlobalVariable* entries = new llvm::GlobalVariable(
+        *module, entries_type, false, llvm::GlobalValue::InternalLinkage,
+        llvm::Constant::getNullValue(entries_type), name + ".memo.entries");
+    llvm::Value* index = llvm::ConstantInt::get(int_type, 0);
+    for (llvm::Value* arg : args) {
+      int64_t values = arg->getType()->isIntegerTy(1) ? 2 : 256;
+      llvm::Value* offset = arg->getType()->isIntegerTy(1)
+                                ? widen(arg)
+                                : builder->CreateAdd(widen(arg), builder->getInt32(128));
+      index = builder->CreateAdd(builder->CreateMul(index, builder->getInt32(values)), offset);
+    }
+    llvm::Value* slot = builder->CreateInBoundsGEP(entries, {builder->getInt32(0), index});
+    llvm::Value* cached = builder->CreateLoad(slot, "cached");
+    builder->CreateCondBr(builder->CreateICmpNE(cached, llvm::ConstantInt::get(int64_type, 0)),
+                          hit_block, miss_block);
+
+    builder->SetInsertPoint(hit_block);
+    count(3);
+    builder->CreateRet(builder->CreateTrunc(cached, return_type));
+
+    builder->SetInsertPoint(miss_block);
+    count(4);
+    llvm::CallInst* result = builder->CreateCall(body, args);
+    result->setCallingConv(body->getCallingConv());
+    llvm::Value* entry = builder->CreateOr(builder->CreateZExt(widen(result), int64_type),
+                                           llvm::ConstantInt::get(int64_type, 1ll << 32));
+    builder->CreateStore(entry, slot);
+    builder->CreateRet(result);
+    return;
+  }
+
+  llvm::Value* arg_count = builder->getInt32(args.size());
+  llvm::Value* key = builder->CreateAlloca(int_type, arg_count, "key");
+  for (size_t arg_index = 0; arg_index < args.size(); ++arg_index) {
+    builder->CreateStore(widen(args[arg_index]),
+                         builder->CreateInBoundsGEP(key, builder->getInt32(arg_index)));
+  }
+  llvm::Value* cached = builder->CreateAlloca(int_type, nullptr, "cached");
+  llvm::Value* found = builder->CreateCall(find_function, {table, key, arg_count, cached});
+  builder->CreateCondBr(builder->CreateICmpNE(found, builder->getInt32(0)), hit_block, miss_block);
+
+  builder->SetInsertPoint(hit_block);
+  count(3);
+  builder->CreateRet(builder->CreateTrunc(builder->CreateLoad(cached), return_type));
+
+  builder->SetInsertPoint(miss_block);
+  count(4);
+  llvm::CallInst* result = builder->CreateCall(body, args);
+  result->setCallingConv(body->getCallingConv());
+  builder->CreateCall(module->getFunction("wz_memo_insert"),
+                      {table, key, arg_count, widen(result)});
+  builder->CreateRet(result);
+}
+
+// Runs at the end of main, after the program output was flushed.
+void CodeGenVisitor::codegen_memo_report() {
+  for (const auto& [name, table] : memo_tables) {
+    builder->CreateCall(module->getFunction("wz_memo_report"),
+                        {get_string_constant(name), builder->getInt32(name.size()), table});
+  }
+}
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -0,0 +1,71 @@
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+
+#include "glog/logging.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+// A program whose main body reads no input prints the same every time it runs, so the
+// interpreter runs it at compile time and the compiled main body prints what it printed, with one
+// write. Programs that read input, fail at run time or run for more than kPrecomputeSteps calls
+// and loop iterations are compiled as they are. Profiles are collected and applied on the module
+// as generated, and the debugged program and the cache statistics need the code of the program,
+// so these keep it whole.
+void CodeGenVisitor::precompute_program(const Frontend::AST::Program& program) {
+  if (profile_generate || !profile_use_path.empty() || memoize_stats) {
+    return;
+  }
+  constant_evaluator = std::make_unique<InterpreterVisitor>();
+  constant_evaluator->set_short_circuit(short_circuit);
+  constant_evaluator->load_program(program);
+  if (debug) {
+    return;
+  }
+  std::string output;
+  uint64_t steps = kPrecomputeSteps;
+  if (constant_evaluator->evaluate_main(program, steps, kMaxPrecomputedOutput, output)) {
+    precomputed_output = std::move(output);
+  }
+}
+
+// A call of a function that accesses no globals and does no input or output returns the same for
+// the same arguments. With constant arguments only, the call is replaced by its result when the
+// interpreter computes it within the steps left of kFoldCallSteps.
+llvm::Constant* CodeGenVisitor::fold_pure_call(const Frontend::AST::CallExpression& call,
+                                               const std::vector<llvm::Value*>& args) {
+  if (!constant_evaluator) {
+    return nullptr;
+  }
+  auto effects = function_effects.find(call.get_name());
+  if (effects == function_effects.end() || effects->second.accesses_memory()) {
+    return nullptr;
+  }
+  std::vector<int32_t> values;
+  for (llvm::Value* arg : args) {
+    auto* constant = llvm::dyn_cast<llvm::ConstantInt>(arg);
+    if (!constant) {
+      return nullptr;
+    }
+    // booleans are held as 0 or 1, characters sign extended
+    values.push_back(constant->getBitWidth() == 1 ? constant->getZExtValue()
+                                                  : constant->getSExtValue());
+  }
+
+  auto folded = folded_calls.find({call.get_name(), values});
+  if (folded != folded_calls.end()) {
+    return folded->second;
+  }
+  llvm::Constant* result = nullptr;
+  int32_t return_value;
+  if (constant_evaluator->evaluate_call(call.get_name(), values, fold_call_steps, return_value)) {
+    result = llvm::ConstantInt::get(module->getFunction(call.get_name())->getReturnType(),
+                                    static_cast<int64_t>(return_value), true);
+  }
+  folded_calls[{call.get_name(), values}] = result;
+  return result;
+}
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -0,0 +1,214 @@
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "glog/logging.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+// Whether a branch, a switch or a select decides on the value, directly or through the
+// comparisons, conversions and arithmetic computing the condition, or through the parameter of
+// a function it is passed to.
+static bool reaches_branch(const llvm::Value* value, int depth = 0) {
+  if (depth > 4) {
+    return false;
+  }
+  for (const llvm::User* user : value->users()) {
+    if (llvm::isa<llvm::BranchInst>(user) || llvm::isa<llvm::SwitchInst>(user)) {
+      return true;
+    }
+    if (const auto* select = llvm::dyn_cast<llvm::SelectInst>(user)) {
+      if (select->getCondition() == value) {
+        return true;
+      }
+    } else if (const auto* call = llvm::dyn_cast<llvm::CallInst>(user)) {
+      const llvm::Function* callee = call->getCalledFunction();
+      if (!callee || callee->isDeclaration() || callee == call->getFunction()) {
+        continue;
+      }
+      for (unsigned arg_index = 0; arg_index < call->arg_size(); arg_index++) {
+        if (call->getArgOperand(arg_index) == value &&
+            reaches_branch(callee->getArg(arg_index), depth + 1)) {
+          return true;
+        }
+      }
+    } else if ((llvm::isa<llvm::CmpInst>(user) || llvm::isa<llvm::CastInst>(user) ||
+                llvm::isa<llvm::BinaryOperator>(user)) &&
+               reaches_branch(user, depth + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static int64_t count_instructions(const llvm::Function& function) {
+  int64_t count = 0;
+  for (const auto& block : function) {
+    count += block.sizeWithoutDebug();
+  }
+  return count;
+}
+
+// Only calls between functions of the same type can be `musttail`, the others stay guaranteed
+// tail calls of the fast calling convention, see codegen_tail_call.
+static void relax_tail_call(llvm::CallInst* call) {
+  if (call->isMustTailCall() &&
+      call->getFunctionType() != call->getFunction()->getFunctionType()) {
+    call->setTailCallKind(llvm::CallInst::TCK_Tail);
+  }
+}
+
+// Interprocedural constant propagation for the optimized functions. A call passing constants,
+// literals and enum literals alike, to parameters that decide branches goes to a copy of the
+// callee with the constants in place of these parameters, and the copy is optimized again so the
+// branches fold away. Copies are shared by the calls passing the same constants and are
+// specialized in turn, until kSpecializationBudget instructions were added; functions larger than
+// kMaxSpecializedSize are never copied. Copies that end up as a few instructions, like those
+// selecting which function to call, are then inlined into their callers, and the functions no
+// call is left to are removed.
+void CodeGenVisitor::specialize_functions(llvm::legacy::FunctionPassManager& fpm) {
+  std::map<std::pair<llvm::Function*, std::vector<llvm::Constant*>>, llvm::Function*>
+      specializations;
+  std::vector<llvm::Function*> specialized_functions;
+  int64_t budget = kSpecializationBudget;
+  // the caches belong to the wrappers and their bodies as they are
+  auto is_memoized = [&](llvm::StringRef name) {
+    name.consume_back(kMemoBodySuffix);
+    return memoized_functions.count(name.str()) > 0;
+  };
+
+  std::deque<llvm::Function*> callers;
+  for (auto& function : *module) {
+    if (!function.isDeclaration()) {
+      callers.push_back(&function);
+    }
+  }
+  while (!callers.empty()) {
+    llvm::Function* caller = callers.front();
+    callers.pop_front();
+    std::vector<llvm::CallInst*> calls;
+    for (auto& block : *caller) {
+      for (auto& instruction : block) {
+        if (auto* call = llvm::dyn_cast<llvm::CallInst>(&instruction)) {
+          calls.push_back(call);
+        }
+      }
+    }
+
+    for (llvm::CallInst* call : calls) {
+      llvm::Function* callee = call->getCalledFunction();
+      if (!callee || callee->isDeclaration() || !callee->hasInternalLinkage() ||
+          is_memoized(callee->getName())) {
+        continue;
+      }
+      std::vector<llvm::Constant*> constants;
+      bool any_constant = false;
+      for (unsigned arg_index = 0; arg_index < call->arg_size(); arg_index++) {
+        auto* constant = llvm::dyn_cast<llvm::ConstantInt>(call->getArgOperand(arg_index));
+        if (constant && !reaches_branch(callee->getArg(arg_index))) {
+          constant = nullptr;
+        }
+        constants.push_back(constant);
+        any_constant |= constant != nullptr;
+      }
+      if (!any_constant) {
+        continue;
+      }
+
+      llvm::Function*& specialized = specializations[{callee, constants}];
+      if (!specialized) {
+        int64_t size = count_instructions(*callee);
+        if (size > kMaxSpecializedSize || size > budget) {
+          continue;
+        }
+        budget -= size;
+        llvm::ValueToValueMapTy constant_args;
+        for (unsigned arg_index = 0; arg_index < constants.size(); arg_index++) {
+          if (constants[arg_index]) {
+            constant_args[callee->getArg(arg_index)] = constants[arg_index];
+          }
+        }
+        specialized = llvm::CloneFunction(callee, constant_args);
+        specialized->setName(callee->getName() + ".specialized");
+        for (auto& block : *specialized) {
+          for (auto& instruction : block) {
+            if (auto* inner_call = llvm::dyn_cast<llvm::CallInst>(&instruction)) {
+              relax_tail_call(inner_call);
+            }
+          }
+        }
+        fpm.run(*specialized);
+        specialized_functions.push_back(specialized);
+        callers.push_back(specialized);
+      }
+
+      std::vector<llvm::Value*> args;
+      for (unsigned arg_index = 0; arg_index < constants.size(); arg_index++) {
+        if (!constants[arg_index]) {
+          args.push_back(call->getArgOperand(arg_index));
+        }
+      }
+      llvm::CallInst* specialized_call = llvm::CallInst::Create(specialized, args, "", call);
+      specialized_call->setCallingConv(call->getCallingConv());
+      specialized_call->setTailCallKind(call->getTailCallKind());
+      specialized_call->setDebugLoc(call->getDebugLoc());
+      relax_tail_call(specialized_call);
+      specialized_call->takeName(call);
+      call->replaceAllUsesWith(specialized_call);
+      call->eraseFromParent();
+    }
+  }
+
+  std::set<llvm::Function*> inlined_into;
+  for (llvm::Function* specialized : specialized_functions) {
+    if (specialized->size() != 1 || count_instructions(*specialized) > kMaxForwarderSize) {
+      continue;
+    }
+    std::vector<llvm::CallInst*> calls;
+    for (llvm::User* user : specialized->users()) {
+      auto* call = llvm::dyn_cast<llvm::CallInst>(user);
+      if (call && call->getCalledFunction() == specialized && !call->isMustTailCall() &&
+          call->getFunction() != specialized) {
+        calls.push_back(call);
+      }
+    }
+    for (llvm::CallInst* call : calls) {
+      llvm::Function* caller = call->getFunction();
+      llvm::InlineFunctionInfo inline_info;
+      if (llvm::InlineFunction(*call, inline_info).isSuccess()) {
+        inlined_into.insert(caller);
+      }
+    }
+  }
+  for (llvm::Function* caller : inlined_into) {
+    fpm.run(*caller);
+  }
+
+  // a function only calling itself is not called either, and removing a function can leave
+  // others without callers
+  bool removed = true;
+  while (removed) {
+    removed = false;
+    for (auto function = module->begin(); function != module->end();) {
+      llvm::Function& current = *function++;
+      bool called = std::any_of(current.user_begin(), current.user_end(), [&](llvm::User* user) {
+        auto* instruction = llvm::dyn_cast<llvm::Instruction>(user);
+        return !instruction || instruction->getFunction() != &current;
+      });
+      if (!current.isDeclaration() && current.hasInternalLinkage() && !called) {
+        current.dropAllReferences();
+        current.eraseFromParent();
+        removed = true;
+      }
+    }
+  }
+}
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -0,0 +1,66 @@
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+
+#include "glog/logging.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Value.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+// Nothing is left to do after the call of `return (f(...))`, so the call does not need a frame
+// of its own. A function calling itself jumps back to its body instead. Other calls return the
+// result of the callee directly: `musttail` when both functions have the same type, which every
+// backend honors, otherwise a fastcc `tail` call that the backend turns into a jump when tail
+// calls are guaranteed, see initialize_target_machine. Memoized functions keep calling
+// themselves, through their cache.
+bool CodeGenVisitor::codegen_tail_call(const Frontend::AST::CallExpression& call) {
+  if (!current_function || call.get_name() == "read" || call.get_name() == "output") {
+    return false;
+  }
+  llvm::Function* caller = builder->GetInsertBlock()->getParent();
+  llvm::Function* callee = module->getFunction(call.get_name());
+  if (!callee || callee->getCallingConv() != caller->getCallingConv()) {
+    return false;
+  }
+
+  std::vector<llvm::Value*> args;
+  if (!codegen_call_arguments(call, args)) {
+    return false;
+  }
+  if (llvm::Constant* folded = fold_pure_call(call, args)) {
+    builder->CreateStore(folded, local_variables[llvm::StringRef(current_function->get_name())]);
+    builder->CreateBr(function_exit_block);
+    return true;
+  }
+  if (callee == caller && !memoized_functions.count(call.get_name())) {
+    codegen_tail_recursion(args);
+    return true;
+  }
+  llvm::CallInst* tail_call = builder->CreateCall(callee, args);
+  tail_call->setCallingConv(callee->getCallingConv());
+  tail_call->setTailCallKind(callee->getFunctionType() == caller->getFunctionType()
+                                 ? llvm::CallInst::TCK_MustTail
+                                 : llvm::CallInst::TCK_Tail);
+  builder->CreateRet(tail_call);
+  return true;
+}
+
+// The arguments are all evaluated before the first parameter is overwritten. The return variable
+// and the local variables start over from their default values, as in a new call.
+void CodeGenVisitor::codegen_tail_recursion(const std::vector<llvm::Value*>& args) {
+  const auto& params = current_function->get_parameters();
+  for (size_t param_index = 0; param_index < params.size(); param_index++) {
+    builder->CreateStore(args[param_index],
+                         local_variables[llvm::StringRef(params[param_index]->get_name())]);
+  }
+  initialize_local_variable(local_variables[llvm::StringRef(current_function->get_name())]);
+  for (const auto& local_var : current_function->get_local_var_dclns()) {
+    initialize_local_variable(local_variables[llvm::StringRef(local_var->get_name())]);
+  }
+  builder->CreateBr(function_body_block);
+}
+
+} // namespace Visitor
+} // namespace WinZigC
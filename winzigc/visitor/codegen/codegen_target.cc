@@ -0,0 +1,113 @@
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+
+#include "glog/logging.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+void CodeGenVisitor::set_target_cpu(const std::string& cpu) {
+  if (cpu == "native") {
+    target_cpu = llvm::sys::getHostCPUName().str();
+    llvm::StringMap<bool> host_features;
+    if (llvm::sys::getHostCPUFeatures(host_features)) {
+      std::vector<std::string> features;
+      for (const auto& feature : host_features) {
+        features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+      }
+      target_features = llvm::join(features, ",");
+    }
+    return;
+  }
+  target_cpu = cpu;
+  target_features.clear();
+}
+
+void CodeGenVisitor::initialize_target_machine() {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  std::string target_triple = llvm::sys::getDefaultTargetTriple();
+  std::string error;
+  const llvm::Target* target = llvm::TargetRegistry::lookupTarget(target_triple, error);
+  if (!target) {
+    LOG(ERROR) << "Could not find target for " << target_triple << ": " << error;
+    return;
+  }
+
+  std::unique_ptr<llvm::MCSubtargetInfo> subtarget_info(
+      target->createMCSubtargetInfo(target_triple, "", ""));
+  if (target_cpu != "generic" && !subtarget_info->isCPUStringValid(target_cpu)) {
+    LOG(ERROR) << "Unknown CPU '" << target_cpu << "' for " << target_triple
+               << ", generating code for a generic one";
+    target_cpu = "generic";
+    target_features.clear();
+  }
+
+  llvm::TargetOptions options;
+  // fastcc tail calls become jumps even when the callee takes other arguments than the caller
+  options.GuaranteedTailCallOpt = true;
+  target_machine.reset(target->createTargetMachine(
+      target_triple, target_cpu, target_features, options,
+      llvm::Optional<llvm::Reloc::Model>(llvm::Reloc::PIC_), llvm::None,
+      optimize ? llvm::CodeGenOpt::Aggressive : llvm::CodeGenOpt::Default));
+
+  // the optimizer and the backend both rely on the module describing the target it is built for
+  module->setTargetTriple(target_triple);
+  module->setDataLayout(target_machine->createDataLayout());
+}
+
+// The CPU is also recorded on every function, so that bitcode optimized and compiled later by
+// the LTO linker targets it as well.
+void CodeGenVisitor::set_target_attributes() {
+  if (target_cpu == "generic") {
+    return;
+  }
+  for (auto& function : *module) {
+    if (function.isDeclaration()) {
+      continue;
+    }
+    function.addFnAttr("target-cpu", target_cpu);
+    if (!target_features.empty()) {
+      function.addFnAttr("target-features", target_features);
+    }
+  }
+}
+
+bool CodeGenVisitor::emit_object_file(std::string output_path) const {
+  if (!target_machine) {
+    LOG(ERROR) << "No target machine available to emit an object file";
+    return false;
+  }
+
+  std::error_code error;
+  llvm::raw_fd_ostream dest(output_path, error, llvm::sys::fs::OF_None);
+  if (error) {
+    LOG(ERROR) << "Could not open file: " << error.message();
+    return false;
+  }
+
+  llvm::legacy::PassManager pass_manager;
+  if (target_machine->addPassesToEmitFile(pass_manager, dest, nullptr, llvm::CGFT_ObjectFile)) {
+    LOG(ERROR) << "Target machine can not emit an object file";
+    return false;
+  }
+  pass_manager.run(*module);
+  dest.flush();
+  return true;
+}
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -7,29 +7,77 @@
 namespace WinZigC {
 namespace Visitor {
 
+// Enum literals take no storage, references to them become immediates, see lookup_constant.
 void CodeGenVisitor::visit(const Frontend::AST::GlobalUserTypeDef& expression) {
   for (size_t value_index = 0; value_index < expression.get_value_names().size(); value_index++) {
-    llvm::Constant* const_value = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context),
-                                                         llvm::APInt(32, value_index, true));
-    llvm::GlobalVariable* global_const = new llvm::GlobalVariable(
-        *module, const_value->getType(), true, llvm::GlobalValue::InternalLinkage, const_value,
-        expression.get_value_names().at(value_index));
-    global_variables[llvm::StringRef(expression.get_value_names().at(value_index))] = global_const;
     global_user_def_type_consts[expression.get_value_names().at(value_index)] = value_index;
   }
 }
 
 void CodeGenVisitor::visit(const Frontend::AST::LocalUserTypeDef& expression) {
   for (size_t value_index = 0; value_index < expression.get_value_names().size(); value_index++) {
-    llvm::Constant* const_value = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context),
-                                                         llvm::APInt(32, value_index, true));
-    llvm::AllocaInst* alloca = builder->CreateAlloca(llvm::Type::getInt32Ty(*context), nullptr,
-                                                     expression.get_value_names().at(value_index));
-    builder->CreateStore(const_value, alloca);
-    local_variables[llvm::StringRef(expression.get_value_names().at(value_index))] = alloca;
     local_user_def_type_consts[expression.get_value_names().at(value_index)] = value_index;
   }
 }
 
+// Constants take no storage either. They are typed by their value, a literal or the name of an
+// enum literal or of an earlier constant.
+void CodeGenVisitor::visit(const Frontend::AST::GlobalConstant& expression) {
+  global_constants[expression.get_name()] = get_constant_value(expression.get_value());
+}
+
+void CodeGenVisitor::visit(const Frontend::AST::LocalConstant& expression) {
+  local_constants[expression.get_name()] = get_constant_value(expression.get_value());
+}
+
+llvm::ConstantInt* CodeGenVisitor::get_constant_value(const Frontend::AST::Expression& value) {
+  if (const auto* integer = dynamic_cast<const Frontend::AST::IntegerExpression*>(&value)) {
+    return llvm::ConstantInt::getSigned(llvm::Type::getInt32Ty(*context), integer->get_value());
+  }
+  if (const auto* character = dynamic_cast<const Frontend::AST::CharacterExpression*>(&value)) {
+    return llvm::ConstantInt::getSigned(llvm::Type::getInt8Ty(*context),
+                                        character->get_character());
+  }
+  if (const auto* boolean = dynamic_cast<const Frontend::AST::BooleanExpression*>(&value)) {
+    return boolean->get_bool() ? llvm::ConstantInt::getTrue(*context)
+                               : llvm::ConstantInt::getFalse(*context);
+  }
+  if (const auto* identifier = dynamic_cast<const Frontend::AST::IdentifierExpression*>(&value)) {
+    if (llvm::ConstantInt* constant = lookup_constant(identifier->get_name())) {
+      return constant;
+    }
+  }
+  LOG(ERROR) << "Unknown constant value";
+  return llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), 0);
+}
+
+// Local constants and literals hide the globals of the same name, like local variables do, and
+// variables hide the global ones. Case labels only name constants, so nothing hides them there.
+llvm::ConstantInt* CodeGenVisitor::lookup_constant(const std::string& name,
+                                                   bool hidden_by_variables) {
+  auto local_constant = local_constants.find(name);
+  if (local_constant != local_constants.end()) {
+    return local_constant->second;
+  }
+  auto local_literal = local_user_def_type_consts.find(name);
+  if (local_literal != local_user_def_type_consts.end()) {
+    return llvm::ConstantInt::getSigned(llvm::Type::getInt32Ty(*context), local_literal->second);
+  }
+  if (hidden_by_variables &&
+      (local_variables.find(llvm::StringRef(name)) != local_variables.end() ||
+       global_variables.find(llvm::StringRef(name)) != global_variables.end())) {
+    return nullptr;
+  }
+  auto global_constant = global_constants.find(name);
+  if (global_constant != global_constants.end()) {
+    return global_constant->second;
+  }
+  auto global_literal = global_user_def_type_consts.find(name);
+  if (global_literal != global_user_def_type_consts.end()) {
+    return llvm::ConstantInt::getSigned(llvm::Type::getInt32Ty(*context), global_literal->second);
+  }
+  return nullptr;
+}
+
 } // namespace Visitor
 } // namespace WinZigC
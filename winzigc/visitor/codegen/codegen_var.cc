@@ -8,6 +8,10 @@ namespace WinZigC {
 namespace Visitor {
 
 void CodeGenVisitor::visit(const Frontend::AST::GlobalVariable& expression) {
+  if (family_members.find(expression.get_name()) != family_members.end()) {
+    codegen_family_member(expression);
+    return;
+  }
   llvm::Constant* default_value = get_default_value(expression.get_type());
   llvm::GlobalVariable* global_variable = new llvm::GlobalVariable(
       *module, default_value->getType(), false, llvm::GlobalValue::InternalLinkage, default_value,
@@ -23,13 +27,17 @@ void CodeGenVisitor::visit(const Frontend::AST::GlobalVariable& expression) {
   }
   /* Debug Information End   */
   global_variables[llvm::StringRef(expression.get_name())] = global_variable;
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&expression.get_type())) {
+    array_lower_bounds[global_variable] = array_type->get_lower();
+  }
 }
 
 void CodeGenVisitor::visit(const Frontend::AST::LocalVariable& expression) {
   llvm::Constant* default_value = get_default_value(expression.get_type());
   llvm::AllocaInst* alloca =
       builder->CreateAlloca(default_value->getType(), nullptr, expression.get_name());
-  builder->CreateStore(default_value, alloca);
+  initialize_local_variable(alloca);
   /* Debug Information Start */
   if (debug) {
     llvm::DIFile* unit =
@@ -44,6 +52,62 @@ void CodeGenVisitor::visit(const Frontend::AST::LocalVariable& expression) {
   }
   /* Debug Information End   */
   local_variables[llvm::StringRef(expression.get_name())] = alloca;
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&expression.get_type())) {
+    array_lower_bounds[alloca] = array_type->get_lower();
+  }
+}
+
+// With optimizations main keeps the scalar globals in locals, which become SSA values, instead of
+// loading and storing them around every call. A global is only written back before a call of a
+// function reading or writing it, the function itself or the functions it calls, and loaded again
+// after the call; those no function touches live in registers throughout. Arrays and the members
+// of scalar families stay in memory, and debug builds keep every global where the debugger looks.
+void CodeGenVisitor::codegen_main_globals() {
+  if (!optimize || debug) {
+    return;
+  }
+  for (const auto& [name, variable] : global_variables) {
+    auto* global = llvm::dyn_cast<llvm::GlobalVariable>(variable);
+    if (!global || global->getValueType()->isArrayTy()) {
+      continue;
+    }
+    llvm::AllocaInst* alloca = builder->CreateAlloca(global->getValueType(), nullptr, name);
+    builder->CreateStore(global->getInitializer(), alloca);
+    local_variables[name] = alloca;
+    main_globals[name.str()] = {global, alloca};
+  }
+}
+
+void CodeGenVisitor::codegen_global_spill(const std::string& callee, bool reload) {
+  if (current_function || main_globals.empty()) {
+    return;
+  }
+  for (const auto& name : function_effects[callee].globals) {
+    auto main_global = main_globals.find(name);
+    if (main_global == main_globals.end()) {
+      continue;
+    }
+    auto [global, alloca] = main_global->second;
+    if (reload) {
+      builder->CreateStore(builder->CreateLoad(global), alloca);
+    } else {
+      builder->CreateStore(builder->CreateLoad(alloca), global);
+    }
+  }
+}
+
+// Every type defaults to zero.
+void CodeGenVisitor::initialize_local_variable(llvm::AllocaInst* alloca) {
+  llvm::Type* type = alloca->getAllocatedType();
+  if (type->isArrayTy()) {
+    // a memset stays one call however long the array is
+    builder->CreateMemSet(alloca, builder->getInt8(0),
+                          module->getDataLayout().getTypeAllocSize(type).getFixedSize(),
+                          alloca->getAlign());
+    return;
+  }
+  builder->CreateStore(llvm::Constant::getNullValue(type), alloca);
 }
 
 llvm::Constant* CodeGenVisitor::get_default_value(const Frontend::AST::Type& type) {
@@ -59,11 +123,32 @@ llvm::Constant* CodeGenVisitor::get_default_value(const Frontend::AST::Type& typ
   if (const Frontend::AST::UserType* integer_type =
           dynamic_cast<const Frontend::AST::UserType*>(&type))
     return llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), llvm::APInt(32, 0, true));
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&type))
+    return llvm::ConstantAggregateZero::get(get_type(*array_type));
 
   LOG(ERROR) << "Unable to generate default value for unknown type";
   return nullptr;
 }
 
+// The address a variable is read from and stored to; for an array element the index is
+// evaluated and offset by the lower bound of the array.
+llvm::Value*
+CodeGenVisitor::codegen_variable_address(const Frontend::AST::IdentifierExpression& variable) {
+  llvm::Value* var = lookup_variable(variable.get_name());
+  const Frontend::AST::IndexExpression* element =
+      dynamic_cast<const Frontend::AST::IndexExpression*>(&variable);
+  if (!var || !element) {
+    return var;
+  }
+  element->get_index().accept(*this);
+  llvm::Value* index = element->get_index().get_codegen_value();
+  llvm::Value* offset = builder->CreateSub(builder->CreateSExt(index, builder->getInt64Ty()),
+                                           builder->getInt64(array_lower_bounds[var]));
+  return builder->CreateInBoundsGEP(var, {builder->getInt64(0), offset},
+                                    variable.get_name() + ".element");
+}
+
 llvm::Value* CodeGenVisitor::lookup_variable(std::string var_name) {
   if (local_variables.find(llvm::StringRef(var_name)) != local_variables.end()) {
     return local_variables[llvm::StringRef(var_name)];
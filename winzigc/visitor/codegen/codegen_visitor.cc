@@ -2,6 +2,8 @@
 
 #include "winzigc/visitor/codegen/codegen_visitor.h"
 
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
@@ -10,7 +12,11 @@
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Instrumentation.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/DCE.h"
 #include "llvm/Transforms/Scalar/TailRecursionElimination.h"
@@ -20,26 +26,52 @@
 namespace WinZigC {
 namespace Visitor {
 
-CodeGenVisitor::CodeGenVisitor(bool optimize, bool debug)
-    : optimize(optimize), debug(debug), context(std::make_unique<llvm::LLVMContext>()),
+CodeGenVisitor::CodeGenVisitor(bool optimize, bool debug, bool short_circuit, bool memoize,
+                               bool memoize_stats)
+    : optimize(optimize), debug(debug), short_circuit(short_circuit),
+      memoize(memoize || memoize_stats), memoize_stats(memoize_stats),
+      context(std::make_unique<llvm::LLVMContext>()),
       builder(std::make_unique<llvm::IRBuilder<>>(*context)) {}
 
 CodeGenVisitor::~CodeGenVisitor() {}
 
-void CodeGenVisitor::print_llvm_ir(std::string output_path) const {
+bool CodeGenVisitor::print_llvm_ir(std::string output_path) const {
   std::error_code error;
-  llvm::raw_fd_ostream dest(output_path + ".ll", error);
+  llvm::raw_fd_ostream dest(output_path, error);
 
   if (error) {
     LOG(ERROR) << "Could not open file: " << error.message();
-    return;
+    return false;
   }
 
   module->print(dest, nullptr);
+  return true;
+}
+
+bool CodeGenVisitor::write_bitcode(std::string output_path, bool thin_lto) const {
+  std::error_code error;
+  llvm::raw_fd_ostream dest(output_path, error, llvm::sys::fs::OF_None);
+
+  if (error) {
+    LOG(ERROR) << "Could not open file: " << error.message();
+    return false;
+  }
+
+  if (thin_lto) {
+    // the ThinLTO writer computes the module summary index and embeds it next to the IR
+    llvm::legacy::PassManager pass_manager;
+    pass_manager.add(llvm::createWriteThinLTOBitcodePass(dest));
+    pass_manager.run(*module);
+  } else {
+    llvm::WriteBitcodeToFile(*module, dest);
+  }
+  dest.flush();
+  return true;
 }
 
 void CodeGenVisitor::codegen(const Frontend::AST::Program& program, std::string program_path) {
   module = std::make_unique<llvm::Module>(program.get_name(), *context);
+  initialize_target_machine();
   /* Debug Information Start */
   if (debug) {
     module->addModuleFlag(llvm::Module::Warning, "Debug Info Version",
@@ -61,17 +93,61 @@ void CodeGenVisitor::codegen(const Frontend::AST::Program& program, std::string
 }
 
 void CodeGenVisitor::visit(const Frontend::AST::Program& program) {
+  EffectVisitor effect_visitor;
+  function_effects = effect_visitor.analyze(program);
+  if (memoize) {
+    for (const auto& function : program.get_functions()) {
+      if (is_memoizable(*function)) {
+        memoized_functions.insert(function->get_name());
+      }
+    }
+    // the caches are written by the functions and by everything calling them
+    function_effects = effect_visitor.add_global_writes(memoized_functions);
+  }
+  if (explicit_stack) {
+    // the frame stacks are mapped and grown by the runtime library, which flushes the output and
+    // exits when out of memory, see codegen_explicit_stack
+    std::set<std::string> frame_stack_functions;
+    for (const auto& [name, effects] : function_effects) {
+      if (effects.recursive && !memoized_functions.count(name)) {
+        frame_stack_functions.insert(name);
+      }
+    }
+    function_effects = effect_visitor.add_global_writes(frame_stack_functions);
+  }
+  if (optimize) {
+    precompute_program(program);
+  }
   codegen_external_func_dclns();
+  for (const auto& constant : program.get_constants()) {
+    constant->accept(*this);
+  }
   codegen_global_user_types(program.get_user_types());
+  if (optimize) {
+    find_scalar_families(program);
+  }
   codegen_global_vars(program);
 
+  for (const auto& function : program.get_functions()) {
+    codegen_func_dcln(*function);
+  }
   for (const auto& function : program.get_functions()) {
     function->accept(*this);
   }
 
   codegen_main_body(program.get_statements());
+  set_target_attributes();
+  // profiles are collected and applied on the module as generated, both builds are optimized so
+  // the instrumented and the optimized build see the same control flow
+  if (profile_generate || !profile_use_path.empty()) {
+    run_profile_passes();
+  }
   if (optimize) {
     run_optimizations(program.get_functions());
+    if (!profile_use_path.empty()) {
+      // the profile weighted inliner and the rest of the -O2 pipeline
+      run_module_optimizations(2);
+    }
   }
 
   /* Debug Information Start */
@@ -100,8 +176,12 @@ void CodeGenVisitor::codegen_main_body(
   llvm::FunctionType* func_type = llvm::FunctionType::get(llvm::Type::getInt32Ty(*context), false);
   llvm::Function* main_func =
       llvm::Function::Create(func_type, llvm::Function::ExternalLinkage, "main", module.get());
+  // nothing in a program can call main
+  main_func->setDoesNotThrow();
+  main_func->setDoesNotRecurse();
   llvm::BasicBlock* entry_block = llvm::BasicBlock::Create(*context, "entry", main_func);
   builder->SetInsertPoint(entry_block);
+  codegen_main_globals();
 
   /* Debug Information Start */
   if (debug) {
@@ -126,8 +206,10 @@ void CodeGenVisitor::codegen_main_body(
   }
   /* Debug Information End   */
 
-  for (const auto& statement : statements) {
-    statement->accept(*this);
+  if (!precomputed_output) {
+    codegen_statements(statements);
+  } else if (!precomputed_output->empty()) {
+    emit_output_format({"", *precomputed_output, {}});
   }
 
   /* Debug Information Start */
@@ -135,33 +217,177 @@ void CodeGenVisitor::codegen_main_body(
     lexical_blocks.pop();
   }
   /* Debug Information End   */
+  builder->CreateCall(module->getFunction("wz_flush"));
+  if (memoize_stats) {
+    codegen_memo_report();
+  }
   builder->CreateRet(llvm::ConstantInt::getSigned(llvm::Type::getInt32Ty(*context), 0));
 }
 
 void CodeGenVisitor::codegen_external_func_dclns() {
+  llvm::Type* void_type = llvm::Type::getVoidTy(*context);
+  llvm::Type* int_type = llvm::Type::getInt32Ty(*context);
+  llvm::Type* char_type = llvm::Type::getInt8Ty(*context);
+  module->getOrInsertFunction("wz_out_int", llvm::FunctionType::get(void_type, int_type, false));
+  module->getOrInsertFunction("wz_out_char", llvm::FunctionType::get(void_type, char_type, false));
   module->getOrInsertFunction(
-      "printf", llvm::FunctionType::get(llvm::IntegerType::getInt32Ty(*context),
-                                        llvm::Type::getInt8Ty(*context)->getPointerTo(), true));
+      "wz_out_text",
+      llvm::FunctionType::get(void_type, {char_type->getPointerTo(), int_type}, false));
   module->getOrInsertFunction(
-      "scanf", llvm::FunctionType::get(llvm::IntegerType::getInt32Ty(*context),
-                                       llvm::Type::getInt8Ty(*context)->getPointerTo(), true));
+      "wz_out_format",
+      llvm::FunctionType::get(void_type,
+                              {char_type->getPointerTo(), int_type, int_type->getPointerTo()},
+                              false));
+  module->getOrInsertFunction("wz_flush", llvm::FunctionType::get(void_type, false));
+  module->getOrInsertFunction("wz_read_int",
+                              llvm::FunctionType::get(int_type, int_type->getPointerTo(), false));
+  module->getOrInsertFunction("wz_read_char",
+                              llvm::FunctionType::get(int_type, char_type->getPointerTo(), false));
+  if (explicit_stack) {
+    llvm::Type* int64_type = llvm::Type::getInt64Ty(*context);
+    llvm::Type* frames_type = char_type->getPointerTo();
+    module->getOrInsertFunction(
+        "wz_frames_grow",
+        llvm::FunctionType::get(frames_type, {frames_type, int64_type->getPointerTo(), int64_type},
+                                false));
+    module->getOrInsertFunction(
+        "wz_frames_free",
+        llvm::FunctionType::get(void_type, {frames_type, int64_type, int64_type}, false));
+  }
+  if (memoize) {
+    // matches wz_memo_table in wz_runtime.h
+    llvm::Type* int64_type = llvm::Type::getInt64Ty(*context);
+    llvm::StructType* table_type =
+        llvm::StructType::create(*context,
+                                 {int_type->getPointerTo(), int_type, int_type, int64_type,
+                                  int64_type},
+                                 "wz_memo_table");
+    llvm::Type* table_ptr_type = table_type->getPointerTo();
+    llvm::Type* int_ptr_type = int_type->getPointerTo();
+    module->getOrInsertFunction(
+        "wz_memo_find",
+        llvm::FunctionType::get(int_type, {table_ptr_type, int_ptr_type, int_type, int_ptr_type},
+                                false));
+    module->getOrInsertFunction(
+        "wz_memo_insert",
+        llvm::FunctionType::get(void_type, {table_ptr_type, int_ptr_type, int_type, int_type},
+                                false));
+    module->getOrInsertFunction(
+        "wz_memo_report",
+        llvm::FunctionType::get(void_type, {char_type->getPointerTo(), int_type, table_ptr_type},
+                                false));
+  }
+}
+
+llvm::Constant* CodeGenVisitor::get_string_constant(const std::string& text) {
+  auto string_constant = string_constants.find(text);
+  if (string_constant != string_constants.end()) {
+    return string_constant->second;
+  }
+  llvm::Constant* constant = builder->CreateGlobalStringPtr(text, "str");
+  string_constants[text] = constant;
+  return constant;
+}
+
+// Without the target's cost model the passes fall back to a generic one that, e.g., does not know
+// which instructions are cheap on the CPU.
+void CodeGenVisitor::add_target_analysis(llvm::legacy::PassManagerBase& pass_manager) {
+  if (target_machine) {
+    pass_manager.add(
+        llvm::createTargetTransformInfoWrapperPass(target_machine->getTargetIRAnalysis()));
+  }
 }
 
 void CodeGenVisitor::run_optimizations(
     const std::vector<std::unique_ptr<Frontend::AST::Function>>& functions) {
   llvm::legacy::FunctionPassManager fpm(module.get());
+  add_target_analysis(fpm);
+  fpm.add(llvm::createPromoteMemoryToRegisterPass());
   fpm.add(llvm::createDeadCodeEliminationPass());
   fpm.add(llvm::createInstructionCombiningPass());
   fpm.add(llvm::createReassociatePass());
   fpm.add(llvm::createGVNPass());
   fpm.add(llvm::createCFGSimplificationPass());
+  // rotated loops run their body at least once, so LICM can hoist the calls the function
+  // attributes mark as pure out of it
+  fpm.add(llvm::createLoopRotatePass());
+  fpm.add(llvm::createLICMPass());
+  // only loops marked by set_loop_hints, their copies of the body are combined afterwards
+  fpm.add(llvm::createLoopUnrollPass(2, /*OnlyWhenForced=*/true));
+  fpm.add(llvm::createInstructionCombiningPass());
+  fpm.add(llvm::createCFGSimplificationPass());
   fpm.add(llvm::createTailCallEliminationPass());
   fpm.doInitialization();
   for (const auto& function : functions) {
     fpm.run(*module->getFunction(function->get_name()));
   }
+  for (const auto& name : memoized_functions) {
+    fpm.run(*module->getFunction(name + kMemoBodySuffix));
+  }
   llvm::Function* main_function = module->getFunction(llvm::StringRef("main"));
   fpm.run(*main_function);
+  specialize_functions(fpm);
+}
+
+void CodeGenVisitor::set_profile_generate(const std::string& output_path) {
+  profile_generate = true;
+  profile_output_path = output_path;
+}
+
+void CodeGenVisitor::set_profile_use(const std::string& profile_path) {
+  profile_use_path = profile_path;
+}
+
+void CodeGenVisitor::set_explicit_stack(bool enable) { explicit_stack = enable; }
+
+// An instrumented program counts how often every edge of the control flow graph is taken and the
+// profile runtime of LLVM writes the counts to a .profraw file at exit. A profile merged by
+// llvm-profdata turns into branch weights and function entry counts.
+void CodeGenVisitor::run_profile_passes() {
+  llvm::legacy::PassManager mpm;
+  if (profile_generate) {
+    mpm.add(llvm::createPGOInstrumentationGenLegacyPass());
+    llvm::InstrProfOptions options;
+    options.InstrProfileOutput = profile_output_path;
+    mpm.add(llvm::createInstrProfilingLegacyPass(options));
+  }
+  if (!profile_use_path.empty()) {
+    mpm.add(llvm::createPGOInstrumentationUseLegacyPass(profile_use_path));
+  }
+  mpm.run(*module);
+  // main runs once in every training run, so it has a count unless the profile was collected on
+  // different control flow, which the pass drops
+  llvm::Function* main_function = module->getFunction("main");
+  if (!profile_use_path.empty() && main_function && !main_function->getEntryCount()) {
+    LOG(ERROR) << "The profile " << profile_use_path
+               << " does not match the program and was not applied. Build the instrumented "
+                  "program with the same flags.";
+  }
+}
+
+void CodeGenVisitor::run_module_optimizations(unsigned opt_level) {
+  llvm::PassManagerBuilder pass_builder;
+  pass_builder.OptLevel = opt_level;
+  pass_builder.Inliner = llvm::createFunctionInliningPass(opt_level, 0, false);
+  pass_builder.LoopVectorize = opt_level >= 2;
+  pass_builder.SLPVectorize = opt_level >= 2;
+  if (target_machine) {
+    target_machine->adjustPassManager(pass_builder);
+  }
+
+  llvm::legacy::FunctionPassManager fpm(module.get());
+  llvm::legacy::PassManager mpm;
+  add_target_analysis(fpm);
+  add_target_analysis(mpm);
+  pass_builder.populateFunctionPassManager(fpm);
+  pass_builder.populateModulePassManager(mpm);
+
+  fpm.doInitialization();
+  for (auto& function : *module) {
+    fpm.run(function);
+  }
+  fpm.doFinalization();
+  mpm.run(*module);
 }
 
 llvm::Type* CodeGenVisitor::get_type(const Frontend::AST::Type& type) {
@@ -174,12 +400,15 @@ llvm::Type* CodeGenVisitor::get_type(const Frontend::AST::Type& type) {
   if (const Frontend::AST::CharacterType* char_type =
           dynamic_cast<const Frontend::AST::CharacterType*>(&type))
     return llvm::Type::getInt8Ty(*context);
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&type))
+    return llvm::ArrayType::get(get_type(array_type->get_element_type()), array_type->get_size());
   // otherwise, assume it is a user type
   return llvm::Type::getInt32Ty(*context);
 }
 
 /* Debug Information Start */
-llvm::DIBasicType* CodeGenVisitor::debug_get_type(const Frontend::AST::Type& type) {
+llvm::DIType* CodeGenVisitor::debug_get_type(const Frontend::AST::Type& type) {
   if (const Frontend::AST::IntegerType* integer_type =
           dynamic_cast<const Frontend::AST::IntegerType*>(&type))
     return debug_builder->createBasicType("integer", 32, llvm::dwarf::DW_ATE_signed);
@@ -189,6 +418,15 @@ llvm::DIBasicType* CodeGenVisitor::debug_get_type(const Frontend::AST::Type& typ
   if (const Frontend::AST::CharacterType* char_type =
           dynamic_cast<const Frontend::AST::CharacterType*>(&type))
     return debug_builder->createBasicType("char", 8, llvm::dwarf::DW_ATE_signed_char);
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&type)) {
+    llvm::DIType* element_type = debug_get_type(array_type->get_element_type());
+    llvm::Metadata* subrange =
+        debug_builder->getOrCreateSubrange(array_type->get_lower(), array_type->get_size());
+    return debug_builder->createArrayType(element_type->getSizeInBits() * array_type->get_size(),
+                                          0, element_type,
+                                          debug_builder->getOrCreateArray(subrange));
+  }
   // otherwise, assume it is a user type
   return debug_builder->createBasicType("integer", 32, llvm::dwarf::DW_ATE_signed);
 }
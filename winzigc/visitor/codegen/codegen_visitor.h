@@ -1,9 +1,13 @@
 #pragma once
 
 #include <map>
+#include <optional>
+#include <set>
 #include <stack>
 
 #include "winzigc/frontend/ast/visitor.h"
+#include "winzigc/visitor/effect/effect_visitor.h"
+#include "winzigc/visitor/interpreter/interpreter_visitor.h"
 
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/IRBuilder.h"
@@ -12,6 +16,9 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Value.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Target/TargetMachine.h"
 #include "glog/logging.h"
 
 namespace WinZigC {
@@ -19,62 +26,198 @@ namespace Visitor {
 
 class CodeGenVisitor : public Frontend::AST::Visitor {
 public:
-  CodeGenVisitor(bool optimize = false, bool debug = false);
+  // Tiered execution binds the program globals by these names and calls functions through
+  // `<function><kTierEntrySuffix>(const int32_t* args)` thunks.
+  static constexpr const char* kTierGlobalPrefix = "wz.global.";
+  static constexpr const char* kTierEntrySuffix = ".tier";
+  // Case range arms with more values than this are lowered to range compares instead of one
+  // switch case per value.
+  static constexpr int64_t kMaxSwitchCaseRange = 64;
+  // A memoized function keeps its body under this suffix, its name goes to the caching wrapper.
+  static constexpr const char* kMemoBodySuffix = ".uncached";
+  // Memoized functions whose arguments take at most this many combinations, counting booleans
+  // and characters only, cache their results in a table indexed by the arguments.
+  static constexpr int64_t kMaxMemoDirectEntries = 1 << 16;
+  // Copies of functions specialized for constant arguments add at most this many instructions to
+  // the module, and functions with more than kMaxSpecializedSize instructions are not copied.
+  // Copies left with at most kMaxForwarderSize instructions are inlined into their callers.
+  static constexpr int64_t kSpecializationBudget = 2000;
+  static constexpr int64_t kMaxSpecializedSize = 300;
+  static constexpr int64_t kMaxForwarderSize = 8;
+  // Optimized programs are run at compile time, see codegen_precompute.cc: the main body for at
+  // most kPrecomputeSteps calls and loop iterations printing at most kMaxPrecomputedOutput bytes,
+  // and the calls of pure functions with constant arguments for kFoldCallSteps in total.
+  static constexpr uint64_t kPrecomputeSteps = 1000000;
+  static constexpr size_t kMaxPrecomputedOutput = 1 << 20;
+  static constexpr uint64_t kFoldCallSteps = 1000000;
+  // Optimized `for` loops with a constant trip count up to this are unrolled fully.
+  static constexpr int64_t kMaxFullUnrollTripCount = 16;
+
+  // Globals that case statements select by consecutive labels, stored as one array, see
+  // codegen_family.cc.
+  struct ScalarFamily {
+    std::vector<std::string> members;
+    llvm::GlobalVariable* storage = nullptr;
+  };
+  // A case statement accessing the member `label - lower` of a family.
+  struct FamilyCase {
+    size_t family;
+    int64_t lower;
+  };
+
+  struct CaseRange {
+    llvm::ConstantInt* low;
+    llvm::ConstantInt* high;
+    llvm::BasicBlock* block;
+  };
+
+  // The variables the statements of a loop read and write, by name, and the functions they call.
+  struct LoopAccesses {
+    std::set<std::string> reads;
+    std::set<std::string> writes;
+    std::set<std::string> callees;
+  };
+
+  // What one or more output calls print, emitted as a single runtime call. `format` uses the
+  // directives of wz_out_format, `text` is the same output without them while there are no
+  // `values` to print.
+  struct OutputFormat {
+    std::string format;
+    std::string text;
+    std::vector<llvm::Value*> values;
+  };
+
+  // `short_circuit` selects whether `and` and `or` skip their right operand when the left one
+  // decides the result, or always evaluate both operands. `memoize` caches the results of pure
+  // recursive functions, `memoize_stats` also prints the cache hits and misses at exit.
+  CodeGenVisitor(bool optimize = false, bool debug = false, bool short_circuit = true,
+                 bool memoize = false, bool memoize_stats = false);
   ~CodeGenVisitor();
 
-  void print_llvm_ir(std::string output_path = "") const;
+  // Profile guided optimization, both have to be set before `codegen`. An empty output path
+  // leaves the name of the .profraw file to the profile runtime (default.profraw, or
+  // $LLVM_PROFILE_FILE).
+  void set_profile_generate(const std::string& output_path);
+  void set_profile_use(const std::string& profile_path);
+  // CPU to generate code for, "native" for the one running the compiler, has to be set before
+  // `codegen`. The default "generic" CPU runs on every machine of the target architecture.
+  void set_target_cpu(const std::string& cpu);
+  // Runs the self recursion of every function that is not memoized on a frame stack on the heap
+  // instead of the native stack, see codegen_explicit_stack.cc. Has to be set before `codegen`.
+  void set_explicit_stack(bool enable);
+
+  bool print_llvm_ir(std::string output_path) const;
+  bool emit_object_file(std::string output_path) const;
+  bool write_bitcode(std::string output_path, bool thin_lto = false) const;
+  // Hands the module over to an ORC JIT and runs its main function, returns the exit status.
+  int run_jit();
+  static llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>> create_jit();
+  // Binds the runtime library entry points linked into the compiler to their addresses in `dylib`.
+  static llvm::Error define_runtime_symbols(llvm::orc::LLJIT& jit, llvm::orc::JITDylib& dylib);
+  // Strips the module down to the given functions for tiered execution, see codegen_jit.cc.
+  llvm::orc::ThreadSafeModule release_tier_module(const std::set<std::string>& functions);
 
   void visit(const Frontend::AST::Program& program) override;
   void codegen(const Frontend::AST::Program& program, std::string program_path);
   void codegen_global_user_types(
       const std::vector<std::unique_ptr<Frontend::AST::GlobalUserTypeDef>>& user_types);
   void codegen_global_vars(const Frontend::AST::Program& program);
+  void find_scalar_families(const Frontend::AST::Program& program);
+  bool match_family_case(const Frontend::AST::CaseExpression& case_statement,
+                         const std::map<std::string, const Frontend::AST::GlobalVariable*>& globals,
+                         const std::set<std::string>& local_names,
+                         std::vector<std::string>& members, int64_t& lower);
+  void codegen_family_member(const Frontend::AST::GlobalVariable& expression);
+  void codegen_family_case(const Frontend::AST::CaseExpression& expression);
   void codegen_main_body(const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements);
+  void
+  codegen_statements(const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements);
   void codegen_external_func_dclns();
+  llvm::Constant* get_string_constant(const std::string& text);
   void run_optimizations(const std::vector<std::unique_ptr<Frontend::AST::Function>>& functions);
+  void specialize_functions(llvm::legacy::FunctionPassManager& fpm);
+  void precompute_program(const Frontend::AST::Program& program);
+  llvm::Constant* fold_pure_call(const Frontend::AST::CallExpression& call,
+                                 const std::vector<llvm::Value*>& args);
+  void run_module_optimizations(unsigned opt_level);
+  void run_profile_passes();
+  void add_target_analysis(llvm::legacy::PassManagerBase& pass_manager);
+  void initialize_target_machine();
+  void set_target_attributes();
 
   void visit(const Frontend::AST::Function& function) override;
-  llvm::FunctionType* codegen_func_dcln(const Frontend::AST::Function& function);
+  llvm::Function* codegen_func_dcln(const Frontend::AST::Function& function);
   void codegen_func_def(const Frontend::AST::Function& function);
+  void add_function_attributes(llvm::Function* function, const FunctionEffects& effects);
+  bool is_memoizable(const Frontend::AST::Function& function) const;
+  void codegen_memo_wrapper(const Frontend::AST::Function& function);
+  void codegen_memo_report();
+  void codegen_explicit_stack(llvm::Function* function);
 
   void visit(const Frontend::AST::IntegerExpression& expression) override;
   void visit(const Frontend::AST::BooleanExpression& expression) override;
   void visit(const Frontend::AST::CharacterExpression& expression) override;
 
   void visit(const Frontend::AST::CallExpression& expression) override;
+  bool codegen_call_arguments(const Frontend::AST::CallExpression& expression,
+                              std::vector<llvm::Value*>& args);
   llvm::Value* codegen_read_call(const Frontend::AST::CallExpression& expression);
   llvm::Value* codegen_output_call(const Frontend::AST::CallExpression& expression);
-  llvm::Value* codegen_output_many_call(const Frontend::AST::CallExpression& expression);
+  bool append_output_call(const Frontend::AST::CallExpression& expression,
+                          OutputFormat& output_format);
+  void emit_output_format(const OutputFormat& output_format);
 
   void visit(const Frontend::AST::IdentifierExpression& expression) override;
+  void visit(const Frontend::AST::IndexExpression& expression) override;
+  llvm::Value* codegen_variable_address(const Frontend::AST::IdentifierExpression& variable);
   void visit(const Frontend::AST::AssignmentExpression& expression) override;
   void visit(const Frontend::AST::SwapExpression& expression) override;
   void visit(const Frontend::AST::IfExpression& expression) override;
   void visit(const Frontend::AST::ForExpression& expression) override;
   void visit(const Frontend::AST::RepeatUntilExpression& expression) override;
   void visit(const Frontend::AST::WhileExpression& expression) override;
+  std::vector<llvm::StringRef> hoist_invariant_globals(const LoopAccesses& accesses);
+  std::optional<int64_t> get_trip_count(const Frontend::AST::ForExpression& loop,
+                                        const LoopAccesses& body_accesses);
+  void set_loop_hints(llvm::BranchInst* latch_branch, std::optional<int64_t> trip_count);
   void visit(const Frontend::AST::CaseExpression& expression) override;
+  llvm::ConstantInt* codegen_case_label(const Frontend::AST::Expression& expression,
+                                        llvm::IntegerType* type);
+  void codegen_case_range_tree(llvm::Value* switch_val, const std::vector<CaseRange>& ranges,
+                               size_t begin, size_t end, llvm::BasicBlock* default_block);
   void visit(const Frontend::AST::ReturnExpression& expression) override;
+  bool codegen_tail_call(const Frontend::AST::CallExpression& call);
+  void codegen_tail_recursion(const std::vector<llvm::Value*>& args);
   void visit(const Frontend::AST::BinaryExpression& expression) override;
+  llvm::Value* codegen_short_circuit(const Frontend::AST::BinaryExpression& expression);
   void visit(const Frontend::AST::UnaryExpression& expression) override;
 
   void visit(const Frontend::AST::LocalVariable& expression) override;
+  void initialize_local_variable(llvm::AllocaInst* alloca);
+  void codegen_main_globals();
+  void codegen_global_spill(const std::string& callee, bool reload);
   void visit(const Frontend::AST::GlobalVariable& expression) override;
   llvm::Constant* get_default_value(const Frontend::AST::Type& type);
   llvm::Value* lookup_variable(std::string var_name);
 
+  void visit(const Frontend::AST::LocalConstant& expression) override;
+  void visit(const Frontend::AST::GlobalConstant& expression) override;
+  llvm::ConstantInt* get_constant_value(const Frontend::AST::Expression& value);
+
   void visit(const Frontend::AST::LocalUserTypeDef& expression) override;
   void visit(const Frontend::AST::GlobalUserTypeDef& expression) override;
+  llvm::ConstantInt* lookup_constant(const std::string& name, bool hidden_by_variables = true);
 
   llvm::Type* get_type(const Frontend::AST::Type& type);
   void visit(const Frontend::AST::IntegerType& expression) override{};
   void visit(const Frontend::AST::BooleanType& expression) override{};
   void visit(const Frontend::AST::CharacterType& expression) override{};
   void visit(const Frontend::AST::UserType& expression) override{};
+  void visit(const Frontend::AST::ArrayType& expression) override{};
 
   /* Debug Information Start */
   llvm::DISubroutineType* debug_create_function_type(const Frontend::AST::Function& function);
-  llvm::DIBasicType* debug_get_type(const Frontend::AST::Type& type);
+  llvm::DIType* debug_get_type(const Frontend::AST::Type& type);
 
   void emit_location(const Frontend::AST::Expression* expression);
   /* Debug Information End   */
@@ -82,14 +225,50 @@ public:
 private:
   bool optimize;
   bool debug;
+  bool short_circuit;
+  bool memoize;
+  bool memoize_stats;
+  bool explicit_stack = false;
+  bool profile_generate = false;
+  std::string profile_output_path;
+  std::string profile_use_path;
+  std::string target_cpu = "generic";
+  std::string target_features;
   std::unique_ptr<llvm::LLVMContext> context;
   std::unique_ptr<llvm::IRBuilder<>> builder;
   std::unique_ptr<llvm::Module> module;
-  std::map<llvm::StringRef, llvm::GlobalVariable*> global_variables;
+  std::unique_ptr<llvm::TargetMachine> target_machine;
+  // globals and the elements standing for the members of scalar families
+  std::map<llvm::StringRef, llvm::Constant*> global_variables;
   std::map<llvm::StringRef, llvm::AllocaInst*> local_variables;
+  // the scalar globals main keeps in locals, see codegen_main_globals
+  std::map<std::string, std::pair<llvm::GlobalVariable*, llvm::AllocaInst*>> main_globals;
+  // the lower bound of every array variable, indices are offset by it
+  std::map<const llvm::Value*, int64_t> array_lower_bounds;
+  std::vector<ScalarFamily> scalar_families;
+  // the family and the position in it of every member
+  std::map<std::string, std::pair<size_t, size_t>> family_members;
+  std::map<const Frontend::AST::CaseExpression*, FamilyCase> family_cases;
   std::map<std::string, int32_t> local_user_def_type_consts;
   std::map<std::string, int32_t> global_user_def_type_consts;
+  std::map<std::string, llvm::ConstantInt*> local_constants;
+  std::map<std::string, llvm::ConstantInt*> global_constants;
+  std::map<std::string, llvm::Constant*> string_constants;
+  std::map<std::string, FunctionEffects> function_effects;
+  std::set<std::string> memoized_functions;
+  // runs the program at compile time while optimizing
+  std::unique_ptr<InterpreterVisitor> constant_evaluator;
+  uint64_t fold_call_steps = kFoldCallSteps;
+  // the result of every call folded so far, null when the call could not be evaluated
+  std::map<std::pair<std::string, std::vector<int32_t>>, llvm::Constant*> folded_calls;
+  // what the main body prints, when it ran at compile time
+  std::optional<std::string> precomputed_output;
+  // the cache of every memoized function, in the order the functions are defined
+  std::vector<std::pair<std::string, llvm::GlobalVariable*>> memo_tables;
   llvm::BasicBlock* function_exit_block;
+  // the code of the current function after its prologue
+  llvm::BasicBlock* function_body_block = nullptr;
+  const Frontend::AST::Function* current_function = nullptr;
 
   std::unique_ptr<llvm::DIBuilder> debug_builder;
   llvm::DICompileUnit* compile_unit;
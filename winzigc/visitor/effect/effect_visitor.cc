@@ -0,0 +1,273 @@
+#include "winzigc/visitor/effect/effect_visitor.h"
+
+#include <vector>
+
+namespace WinZigC {
+namespace Visitor {
+
+std::map<std::string, FunctionEffects>
+EffectVisitor::analyze(const Frontend::AST::Program& program) {
+  program.accept(*this);
+  return effects;
+}
+
+std::map<std::string, FunctionEffects>
+EffectVisitor::add_global_writes(const std::set<std::string>& functions) {
+  for (const auto& name : functions) {
+    effects.at(name).writes_globals = true;
+  }
+  propagate_effects();
+  return effects;
+}
+
+void EffectVisitor::visit(const Frontend::AST::Program& program) {
+  for (const auto& constant : program.get_constants()) {
+    constant->accept(*this);
+  }
+  for (const auto& user_type : program.get_user_types()) {
+    user_type->accept(*this);
+  }
+  for (const auto& function : program.get_functions()) {
+    function->accept(*this);
+  }
+
+  for (auto& [name, function_effects] : effects) {
+    function_effects.recursive = reaches(name, name);
+    function_effects.tail_recursive =
+        function_effects.recursive && recurses_in_tail_calls(name);
+    function_effects.may_diverge |= function_effects.recursive;
+  }
+  propagate_effects();
+}
+
+void EffectVisitor::visit(const Frontend::AST::Function& function) {
+  current_function_name = function.get_name();
+  current_effects = &effects[current_function_name];
+  callees[current_function_name];
+  local_names = {current_function_name};
+  for (const auto& param : function.get_parameters()) {
+    param->accept(*this);
+  }
+  for (const auto& constant : function.get_constants()) {
+    constant->accept(*this);
+  }
+  for (const auto& type_def : function.get_type_defs()) {
+    type_def->accept(*this);
+  }
+  for (const auto& var : function.get_local_var_dclns()) {
+    var->accept(*this);
+  }
+  visit_statements(function.get_function_body_exprs());
+  current_effects = nullptr;
+}
+
+void EffectVisitor::visit_statements(
+    const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements) {
+  for (const auto& statement : statements) {
+    statement->accept(*this);
+  }
+}
+
+bool EffectVisitor::is_global(const std::string& name) const {
+  return local_names.count(name) == 0 && global_user_def_type_consts.count(name) == 0;
+}
+
+bool EffectVisitor::reaches(const std::string& from, const std::string& to) const {
+  std::set<std::string> visited;
+  std::vector<std::string> worklist = {from};
+  while (!worklist.empty()) {
+    std::string name = worklist.back();
+    worklist.pop_back();
+    auto found = callees.find(name);
+    if (found == callees.end()) {
+      continue;
+    }
+    for (const auto& callee : found->second) {
+      if (callee == to) {
+        return true;
+      }
+      if (visited.insert(callee).second) {
+        worklist.push_back(callee);
+      }
+    }
+  }
+  return false;
+}
+
+// Whether no call between the functions on a cycle through `name` is made outside tail position.
+// Those calls keep the stack flat, see codegen_tail_call.
+bool EffectVisitor::recurses_in_tail_calls(const std::string& name) const {
+  for (const auto& [caller, caller_callees] : non_tail_callees) {
+    if (caller != name && !(reaches(name, caller) && reaches(caller, name))) {
+      continue;
+    }
+    for (const auto& callee : caller_callees) {
+      if (callee == name || (reaches(name, callee) && reaches(callee, name))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Every function inherits the effects of its callees. The call graph of a WinZig program is
+// small, so the effects are simply merged again until they stop growing.
+void EffectVisitor::propagate_effects() {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto& [name, function_effects] : effects) {
+      for (const auto& callee : callees[name]) {
+        const FunctionEffects& callee_effects = effects.at(callee);
+        FunctionEffects merged = function_effects;
+        merged.reads_globals |= callee_effects.reads_globals;
+        merged.writes_globals |= callee_effects.writes_globals;
+        merged.does_io |= callee_effects.does_io;
+        merged.may_diverge |= callee_effects.may_diverge;
+        merged.globals.insert(callee_effects.globals.begin(), callee_effects.globals.end());
+        if (merged.reads_globals != function_effects.reads_globals ||
+            merged.writes_globals != function_effects.writes_globals ||
+            merged.does_io != function_effects.does_io ||
+            merged.may_diverge != function_effects.may_diverge ||
+            merged.globals.size() != function_effects.globals.size()) {
+          function_effects = merged;
+          changed = true;
+        }
+      }
+    }
+  }
+}
+
+void EffectVisitor::visit(const Frontend::AST::CallExpression& expression) {
+  if (expression.get_name() == "output") {
+    current_effects->does_io = true;
+    visit_statements(expression.get_arguments());
+    return;
+  } else if (expression.get_name() == "read") {
+    current_effects->does_io = true;
+    for (const auto& argument : expression.get_arguments()) {
+      const auto& identifier =
+          dynamic_cast<const Frontend::AST::IdentifierExpression&>(*argument.get());
+      access_global(identifier.get_name(), true);
+      visit_index(identifier);
+    }
+    return;
+  }
+  callees[current_function_name].insert(expression.get_name());
+  if (&expression != tail_call) {
+    non_tail_callees[current_function_name].insert(expression.get_name());
+  }
+  visit_statements(expression.get_arguments());
+}
+
+void EffectVisitor::visit(const Frontend::AST::IdentifierExpression& expression) {
+  access_global(expression.get_name(), false);
+}
+
+void EffectVisitor::visit(const Frontend::AST::IndexExpression& expression) {
+  access_global(expression.get_name(), false);
+  expression.get_index().accept(*this);
+}
+
+// The index of an assigned array element is evaluated like any other expression.
+void EffectVisitor::visit_index(const Frontend::AST::IdentifierExpression& variable) {
+  if (const auto* element = dynamic_cast<const Frontend::AST::IndexExpression*>(&variable)) {
+    element->get_index().accept(*this);
+  }
+}
+
+void EffectVisitor::access_global(const std::string& name, bool write) {
+  if (!is_global(name)) {
+    return;
+  }
+  (write ? current_effects->writes_globals : current_effects->reads_globals) = true;
+  current_effects->globals.insert(name);
+}
+
+void EffectVisitor::visit(const Frontend::AST::AssignmentExpression& expression) {
+  access_global(expression.get_name().get_name(), true);
+  visit_index(expression.get_name());
+  expression.get_expression().accept(*this);
+}
+
+void EffectVisitor::visit(const Frontend::AST::SwapExpression& expression) {
+  for (const auto* identifier : {&expression.get_lhs(), &expression.get_rhs()}) {
+    access_global(identifier->get_name(), false);
+    access_global(identifier->get_name(), true);
+    visit_index(*identifier);
+  }
+}
+
+void EffectVisitor::visit(const Frontend::AST::IfExpression& expression) {
+  expression.get_condition().accept(*this);
+  visit_statements(expression.get_then_statement());
+  visit_statements(expression.get_else_statement());
+}
+
+// Loops are not proven to terminate, a function running one may not return.
+void EffectVisitor::visit(const Frontend::AST::ForExpression& expression) {
+  current_effects->may_diverge = true;
+  expression.get_start_assignment().accept(*this);
+  expression.get_condition().accept(*this);
+  expression.get_end_assignment().accept(*this);
+  visit_statements(expression.get_body_statements());
+}
+
+void EffectVisitor::visit(const Frontend::AST::RepeatUntilExpression& expression) {
+  current_effects->may_diverge = true;
+  visit_statements(expression.get_body_statements());
+  expression.get_condition().accept(*this);
+}
+
+void EffectVisitor::visit(const Frontend::AST::WhileExpression& expression) {
+  current_effects->may_diverge = true;
+  expression.get_condition().accept(*this);
+  visit_statements(expression.get_body_statements());
+}
+
+// case labels are literals or enum literals and read nothing
+void EffectVisitor::visit(const Frontend::AST::CaseExpression& expression) {
+  expression.get_expression().accept(*this);
+  for (const auto& case_clause : expression.get_cases()) {
+    visit_statements(case_clause.second);
+  }
+  visit_statements(expression.get_otherwise_clause());
+}
+
+void EffectVisitor::visit(const Frontend::AST::ReturnExpression& expression) {
+  tail_call = dynamic_cast<const Frontend::AST::CallExpression*>(&expression.get_expression());
+  expression.get_expression().accept(*this);
+}
+
+void EffectVisitor::visit(const Frontend::AST::BinaryExpression& expression) {
+  expression.get_lhs().accept(*this);
+  expression.get_rhs().accept(*this);
+}
+
+void EffectVisitor::visit(const Frontend::AST::UnaryExpression& expression) {
+  expression.get_expression().accept(*this);
+}
+
+void EffectVisitor::visit(const Frontend::AST::LocalVariable& expression) {
+  local_names.insert(expression.get_name());
+}
+
+void EffectVisitor::visit(const Frontend::AST::LocalConstant& expression) {
+  local_names.insert(expression.get_name());
+}
+
+void EffectVisitor::visit(const Frontend::AST::GlobalConstant& expression) {
+  global_user_def_type_consts.insert(expression.get_name());
+}
+
+void EffectVisitor::visit(const Frontend::AST::LocalUserTypeDef& expression) {
+  local_names.insert(expression.get_value_names().begin(), expression.get_value_names().end());
+}
+
+void EffectVisitor::visit(const Frontend::AST::GlobalUserTypeDef& expression) {
+  global_user_def_type_consts.insert(expression.get_value_names().begin(),
+                                     expression.get_value_names().end());
+}
+
+} // namespace Visitor
+} // namespace WinZigC
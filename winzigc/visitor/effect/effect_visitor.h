@@ -0,0 +1,103 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "winzigc/frontend/ast/visitor.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+// What calling a function may do, including everything done by the functions it calls.
+struct FunctionEffects {
+  bool reads_globals = false;
+  bool writes_globals = false;
+  bool does_io = false;
+  // the function can reach itself through the call graph
+  bool recursive = false;
+  // every call on the way back to the function is the returned call of a `return (f(...))`
+  bool tail_recursive = false;
+  // a loop or a recursion on the way may keep the function from returning
+  bool may_diverge = false;
+  // the globals read or written
+  std::set<std::string> globals;
+
+  bool accesses_memory() const { return reads_globals || writes_globals || does_io; }
+  bool only_reads_memory() const { return !writes_globals && !does_io; }
+};
+
+// Classifies every function of a checked program by the globals it touches, whether it reads or
+// prints and whether it recurses. Effects are first collected per function body and then
+// propagated along the call graph until nothing changes.
+class EffectVisitor : public Frontend::AST::Visitor {
+public:
+  EffectVisitor() = default;
+  ~EffectVisitor() = default;
+
+  std::map<std::string, FunctionEffects> analyze(const Frontend::AST::Program& program);
+  // Marks the analyzed functions as writing globals, for state the code generator adds to them,
+  // and returns the effects of all functions with that taken into account.
+  std::map<std::string, FunctionEffects> add_global_writes(const std::set<std::string>& functions);
+
+  void visit(const Frontend::AST::Program& program) override;
+  void visit(const Frontend::AST::Function& function) override;
+
+  void visit(const Frontend::AST::IntegerExpression& expression) override{};
+  void visit(const Frontend::AST::BooleanExpression& expression) override{};
+  void visit(const Frontend::AST::CharacterExpression& expression) override{};
+
+  void visit(const Frontend::AST::CallExpression& expression) override;
+
+  void visit(const Frontend::AST::IdentifierExpression& expression) override;
+  void visit(const Frontend::AST::IndexExpression& expression) override;
+  void visit(const Frontend::AST::AssignmentExpression& expression) override;
+  void visit(const Frontend::AST::SwapExpression& expression) override;
+  void visit(const Frontend::AST::IfExpression& expression) override;
+  void visit(const Frontend::AST::ForExpression& expression) override;
+  void visit(const Frontend::AST::RepeatUntilExpression& expression) override;
+  void visit(const Frontend::AST::WhileExpression& expression) override;
+  void visit(const Frontend::AST::CaseExpression& expression) override;
+  void visit(const Frontend::AST::ReturnExpression& expression) override;
+  void visit(const Frontend::AST::BinaryExpression& expression) override;
+  void visit(const Frontend::AST::UnaryExpression& expression) override;
+
+  void visit(const Frontend::AST::LocalVariable& expression) override;
+  void visit(const Frontend::AST::GlobalVariable& expression) override{};
+
+  void visit(const Frontend::AST::LocalConstant& expression) override;
+  void visit(const Frontend::AST::GlobalConstant& expression) override;
+
+  void visit(const Frontend::AST::LocalUserTypeDef& expression) override;
+  void visit(const Frontend::AST::GlobalUserTypeDef& expression) override;
+
+  void visit(const Frontend::AST::IntegerType& expression) override{};
+  void visit(const Frontend::AST::BooleanType& expression) override{};
+  void visit(const Frontend::AST::CharacterType& expression) override{};
+  void visit(const Frontend::AST::UserType& expression) override{};
+  void visit(const Frontend::AST::ArrayType& expression) override{};
+
+private:
+  void visit_statements(const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements);
+  void visit_index(const Frontend::AST::IdentifierExpression& variable);
+  void access_global(const std::string& name, bool write);
+  bool is_global(const std::string& name) const;
+  bool reaches(const std::string& from, const std::string& to) const;
+  bool recurses_in_tail_calls(const std::string& name) const;
+  void propagate_effects();
+
+  std::map<std::string, FunctionEffects> effects;
+  std::map<std::string, std::set<std::string>> callees;
+  // the callees called at least once other than as the returned call of a `return (f(...))`
+  std::map<std::string, std::set<std::string>> non_tail_callees;
+  const Frontend::AST::CallExpression* tail_call = nullptr;
+  // global constants and enum literals, they are not memory
+  std::set<std::string> global_user_def_type_consts;
+  // parameters, local constants, variables and enum literals and the return variable
+  std::set<std::string> local_names;
+  FunctionEffects* current_effects = nullptr;
+  std::string current_function_name;
+};
+
+} // namespace Visitor
+} // namespace WinZigC
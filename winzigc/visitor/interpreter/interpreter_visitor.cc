@@ -0,0 +1,838 @@
+#include <deque>
+#include <limits>
+
+#include "winzigc/visitor/interpreter/interpreter_visitor.h"
+#include "winzigc/runtime/wz_runtime.h"
+
+#include "glog/logging.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+namespace {
+
+void collect_callees(const Frontend::AST::Expression& expression, std::set<std::string>& callees);
+
+void collect_callees(const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements,
+                     std::set<std::string>& callees) {
+  for (const auto& statement : statements) {
+    collect_callees(*statement, callees);
+  }
+}
+
+void collect_callees(const Frontend::AST::Expression& expression, std::set<std::string>& callees) {
+  if (const auto* call = dynamic_cast<const Frontend::AST::CallExpression*>(&expression)) {
+    if (call->get_name() != "output" && call->get_name() != "read") {
+      callees.insert(call->get_name());
+    }
+    collect_callees(call->get_arguments(), callees);
+  } else if (const auto* element =
+                 dynamic_cast<const Frontend::AST::IndexExpression*>(&expression)) {
+    collect_callees(element->get_index(), callees);
+  } else if (const auto* assignment =
+                 dynamic_cast<const Frontend::AST::AssignmentExpression*>(&expression)) {
+    collect_callees(assignment->get_name(), callees);
+    collect_callees(assignment->get_expression(), callees);
+  } else if (const auto* swap = dynamic_cast<const Frontend::AST::SwapExpression*>(&expression)) {
+    collect_callees(swap->get_lhs(), callees);
+    collect_callees(swap->get_rhs(), callees);
+  } else if (const auto* if_expr = dynamic_cast<const Frontend::AST::IfExpression*>(&expression)) {
+    collect_callees(if_expr->get_condition(), callees);
+    collect_callees(if_expr->get_then_statement(), callees);
+    collect_callees(if_expr->get_else_statement(), callees);
+  } else if (const auto* for_expr =
+                 dynamic_cast<const Frontend::AST::ForExpression*>(&expression)) {
+    collect_callees(for_expr->get_start_assignment(), callees);
+    collect_callees(for_expr->get_condition(), callees);
+    collect_callees(for_expr->get_end_assignment(), callees);
+    collect_callees(for_expr->get_body_statements(), callees);
+  } else if (const auto* repeat_expr =
+                 dynamic_cast<const Frontend::AST::RepeatUntilExpression*>(&expression)) {
+    collect_callees(repeat_expr->get_condition(), callees);
+    collect_callees(repeat_expr->get_body_statements(), callees);
+  } else if (const auto* while_expr =
+                 dynamic_cast<const Frontend::AST::WhileExpression*>(&expression)) {
+    collect_callees(while_expr->get_condition(), callees);
+    collect_callees(while_expr->get_body_statements(), callees);
+  } else if (const auto* case_expr =
+                 dynamic_cast<const Frontend::AST::CaseExpression*>(&expression)) {
+    collect_callees(case_expr->get_expression(), callees);
+    for (const auto& case_clause : case_expr->get_cases()) {
+      collect_callees(case_clause.second, callees);
+    }
+    collect_callees(case_expr->get_otherwise_clause(), callees);
+  } else if (const auto* return_expr =
+                 dynamic_cast<const Frontend::AST::ReturnExpression*>(&expression)) {
+    collect_callees(return_expr->get_expression(), callees);
+  } else if (const auto* binary_expr =
+                 dynamic_cast<const Frontend::AST::BinaryExpression*>(&expression)) {
+    collect_callees(binary_expr->get_lhs(), callees);
+    collect_callees(binary_expr->get_rhs(), callees);
+  } else if (const auto* unary_expr =
+                 dynamic_cast<const Frontend::AST::UnaryExpression*>(&expression)) {
+    collect_callees(unary_expr->get_expression(), callees);
+  }
+}
+
+} // namespace
+
+InterpreterVisitor::InterpreterVisitor(TierUpCompiler* tier_up_compiler, uint64_t tier_up_threshold)
+    : tier_up_compiler(tier_up_compiler), tier_up_threshold(tier_up_threshold) {}
+
+void InterpreterVisitor::set_tier_up_compiler(TierUpCompiler* compiler, uint64_t threshold) {
+  tier_up_compiler = compiler;
+  tier_up_threshold = threshold;
+}
+
+void InterpreterVisitor::set_short_circuit(bool enabled) { short_circuit = enabled; }
+
+bool InterpreterVisitor::get_short_circuit() const { return short_circuit; }
+
+// What the program printed before it went too deep is still written out.
+int InterpreterVisitor::run(const Frontend::AST::Program& program) {
+  int status = 0;
+  try {
+    program.accept(*this);
+  } catch (const CallDepthExceeded&) {
+    status = 1;
+  }
+  wz_flush();
+  return status;
+}
+
+void* InterpreterVisitor::get_global_address(const std::string& name) const {
+  auto global = global_indices.find(name);
+  if (global == global_indices.end()) {
+    return nullptr;
+  }
+  return &global_slots[global->second];
+}
+
+std::set<std::string>
+InterpreterVisitor::get_callee_closure(const std::string& function_name) const {
+  std::set<std::string> closure = {function_name};
+  std::deque<std::string> worklist = {function_name};
+  while (!worklist.empty()) {
+    auto function = functions.find(worklist.front());
+    worklist.pop_front();
+    if (function == functions.end()) {
+      continue;
+    }
+    for (const auto& callee : function->second->callees) {
+      if (closure.insert(callee).second) {
+        worklist.push_back(callee);
+      }
+    }
+  }
+  return closure;
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::Program& program) {
+  load_program(program);
+  frames.emplace_back(nullptr);
+  execute(program.get_statements());
+  frames.pop_back();
+}
+
+void InterpreterVisitor::load_program(const Frontend::AST::Program& program) {
+  for (const auto& constant : program.get_constants()) {
+    constant->accept(*this);
+  }
+  for (const auto& user_type : program.get_user_types()) {
+    user_type->accept(*this);
+  }
+
+  // every global lives in its own 32 bit slots so that tiered up code can address it directly
+  size_t slot_count = 1;
+  for (const auto& var : program.get_variables()) {
+    slot_count += get_slot_count(var->get_type());
+  }
+  global_slots = std::make_unique<int32_t[]>(slot_count);
+  program.get_discard_variable()->accept(*this);
+  for (const auto& var : program.get_variables()) {
+    var->accept(*this);
+  }
+
+  for (const auto& function : program.get_functions()) {
+    function->accept(*this);
+  }
+}
+
+bool InterpreterVisitor::evaluate_main(const Frontend::AST::Program& program,
+                                       uint64_t& step_budget, size_t max_output_size,
+                                       std::string& output) {
+  this->max_output_size = max_output_size;
+  captured_output = &output;
+  return evaluate_bounded(step_budget, [&] {
+    frames.emplace_back(nullptr);
+    execute(program.get_statements());
+    frames.pop_back();
+  });
+}
+
+bool InterpreterVisitor::evaluate_call(const std::string& function_name,
+                                       const std::vector<int32_t>& args, uint64_t& step_budget,
+                                       int32_t& return_value) {
+  auto function = functions.find(function_name);
+  if (function == functions.end()) {
+    return false;
+  }
+  return evaluate_bounded(step_budget,
+                          [&] { return_value = call(*function->second, args); });
+}
+
+// The evaluation runs as the interpreter would run the program, only what goes wrong at run time
+// throws out of it instead, leaving the frames it entered behind.
+bool InterpreterVisitor::evaluate_bounded(uint64_t& step_budget,
+                                          const std::function<void()>& evaluation) {
+  size_t frame_count = frames.size();
+  evaluating = true;
+  steps_left = step_budget;
+  bool completed = true;
+  try {
+    evaluation();
+  } catch (const EvaluationAbandoned&) {
+    frames.erase(frames.begin() + frame_count, frames.end());
+    returning = false;
+    completed = false;
+  }
+  step_budget = steps_left;
+  evaluating = false;
+  captured_output = nullptr;
+  return completed;
+}
+
+void InterpreterVisitor::count_step() {
+  if (!evaluating) {
+    return;
+  }
+  if (steps_left == 0 || frames.size() > kMaxEvaluationDepth) {
+    throw EvaluationAbandoned();
+  }
+  steps_left--;
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::Function& function) {
+  auto function_info = std::make_unique<FunctionInfo>();
+  function_info->function = &function;
+  collect_callees(function.get_function_body_exprs(), function_info->callees);
+  functions[function.get_name()] = std::move(function_info);
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::GlobalVariable& expression) {
+  size_t slot = global_kinds.size();
+  ValueKind kind = get_value_kind(expression.get_type());
+  global_kinds.insert(global_kinds.end(), get_slot_count(expression.get_type()), kind);
+  global_slots[slot] = 0;
+  global_indices[expression.get_name()] = slot;
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&expression.get_type())) {
+    global_arrays[expression.get_name()] = {array_type->get_lower(),
+                                            static_cast<int32_t>(array_type->get_size()), kind,
+                                            &global_slots[slot]};
+  }
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::LocalVariable& expression) {
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&expression.get_type())) {
+    Frame& frame = frames.back();
+    frame.array_storage.push_back(std::make_unique<int32_t[]>(get_slot_count(*array_type)));
+    frame.arrays[expression.get_name()] = {
+        array_type->get_lower(), static_cast<int32_t>(array_type->get_size()),
+        get_value_kind(*array_type), frame.array_storage.back().get()};
+    return;
+  }
+  frames.back().variables[expression.get_name()] = 0;
+}
+
+// Global constants are evaluated before any frame exists, their value is a literal or an earlier
+// global constant.
+void InterpreterVisitor::visit(const Frontend::AST::GlobalConstant& expression) {
+  const auto* aliased =
+      dynamic_cast<const Frontend::AST::IdentifierExpression*>(&expression.get_value());
+  global_user_def_type_consts[expression.get_name()] =
+      aliased ? global_user_def_type_consts[aliased->get_name()] : evaluate(expression.get_value());
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::LocalConstant& expression) {
+  frames.back().variables[expression.get_name()] = evaluate(expression.get_value());
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::GlobalUserTypeDef& expression) {
+  for (size_t value_index = 0; value_index < expression.get_value_names().size(); value_index++) {
+    global_user_def_type_consts[expression.get_value_names().at(value_index)] = value_index;
+  }
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::LocalUserTypeDef& expression) {
+  // local enum literals live in the frame with the variables, set to their index, so that they
+  // hide the globals of the same name; the compiled code uses their index as an immediate
+  for (size_t value_index = 0; value_index < expression.get_value_names().size(); value_index++) {
+    frames.back().variables[expression.get_value_names().at(value_index)] = value_index;
+  }
+}
+
+InterpreterVisitor::ValueKind InterpreterVisitor::get_value_kind(const Frontend::AST::Type& type) {
+  if (const auto* array_type = dynamic_cast<const Frontend::AST::ArrayType*>(&type))
+    return get_value_kind(array_type->get_element_type());
+  if (dynamic_cast<const Frontend::AST::BooleanType*>(&type))
+    return ValueKind::kBoolean;
+  if (dynamic_cast<const Frontend::AST::CharacterType*>(&type))
+    return ValueKind::kCharacter;
+  // integers and user types
+  return ValueKind::kInteger;
+}
+
+int32_t InterpreterVisitor::normalize(ValueKind kind, int32_t value) {
+  switch (kind) {
+  case ValueKind::kBoolean:
+    return value & 1;
+  case ValueKind::kCharacter:
+    return static_cast<int8_t>(value);
+  default:
+    return value;
+  }
+}
+
+size_t InterpreterVisitor::get_slot_count(const Frontend::AST::Type& type) {
+  const auto* array_type = dynamic_cast<const Frontend::AST::ArrayType*>(&type);
+  if (!array_type) {
+    return 1;
+  }
+  size_t element_size = get_value_kind(type) == ValueKind::kInteger ? 4 : 1;
+  return (array_type->get_size() * element_size + 3) / 4;
+}
+
+int32_t InterpreterVisitor::load_value(ValueKind kind, const void* address) {
+  switch (kind) {
+  case ValueKind::kBoolean:
+    return *static_cast<const uint8_t*>(address) & 1;
+  case ValueKind::kCharacter:
+    return *static_cast<const int8_t*>(address);
+  default:
+    return *static_cast<const int32_t*>(address);
+  }
+}
+
+void InterpreterVisitor::store_value(ValueKind kind, void* address, int32_t value) {
+  switch (kind) {
+  case ValueKind::kBoolean:
+    *static_cast<uint8_t*>(address) = value & 1;
+    break;
+  case ValueKind::kCharacter:
+    *static_cast<int8_t*>(address) = static_cast<int8_t>(value);
+    break;
+  default:
+    *static_cast<int32_t*>(address) = value;
+  }
+}
+
+int32_t InterpreterVisitor::evaluate(const Frontend::AST::Expression& expression) {
+  expression.accept(*this);
+  return result;
+}
+
+void InterpreterVisitor::execute(
+    const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements) {
+  for (const auto& statement : statements) {
+    statement->accept(*this);
+    if (returning) {
+      return;
+    }
+  }
+}
+
+int32_t InterpreterVisitor::call(FunctionInfo& function_info, const std::vector<int32_t>& args) {
+  function_info.calls++;
+  count_step();
+  if (frames.size() > kMaxCallDepth) {
+    LOG(ERROR) << "Call depth exceeded: " << function_info.function->get_name()
+               << " called more than " << kMaxCallDepth << " calls deep";
+    throw CallDepthExceeded();
+  }
+  if (tier_up_compiler && !function_info.tier_up_failed &&
+      !function_info.native_entry.load(std::memory_order_acquire) &&
+      function_info.calls + function_info.back_edges >= tier_up_threshold) {
+    tier_up(function_info);
+  }
+  if (NativeEntry native_entry = function_info.native_entry.load(std::memory_order_acquire)) {
+    return native_entry(args.data());
+  }
+
+  const Frontend::AST::Function& function = *function_info.function;
+  frames.emplace_back(&function_info);
+  Frame& frame = frames.back();
+  frame.variables[function.get_name()] = 0;
+  for (size_t param_index = 0; param_index < function.get_parameters().size(); param_index++) {
+    const auto& param = function.get_parameters().at(param_index);
+    frame.variables[param->get_name()] =
+        normalize(get_value_kind(param->get_type()), args.at(param_index));
+  }
+  for (const auto& constant : function.get_constants()) {
+    constant->accept(*this);
+  }
+  for (const auto& type_def : function.get_type_defs()) {
+    type_def->accept(*this);
+  }
+  for (const auto& local_var : function.get_local_var_dclns()) {
+    local_var->accept(*this);
+  }
+
+  execute(function.get_function_body_exprs());
+  returning = false;
+  int32_t return_value = normalize(get_value_kind(function.get_return_type()),
+                                   frames.back().variables[function.get_name()]);
+  frames.pop_back();
+  return return_value;
+}
+
+void InterpreterVisitor::tier_up(FunctionInfo& function_info) {
+  const std::string& name = function_info.function->get_name();
+  std::map<std::string, NativeEntry> native_entries =
+      tier_up_compiler->compile(get_callee_closure(name));
+  if (native_entries.empty()) {
+    LOG(WARNING) << "Could not tier up " << name << ", it stays interpreted";
+    function_info.tier_up_failed = true;
+    return;
+  }
+  for (const auto& native_entry : native_entries) {
+    auto function = functions.find(native_entry.first);
+    if (function == functions.end()) {
+      continue;
+    }
+    NativeEntry expected = nullptr;
+    function->second->native_entry.compare_exchange_strong(expected, native_entry.second,
+                                                           std::memory_order_acq_rel);
+  }
+}
+
+void InterpreterVisitor::count_back_edge() {
+  count_step();
+  if (FunctionInfo* function_info = frames.back().function_info) {
+    function_info->back_edges++;
+  }
+}
+
+int32_t InterpreterVisitor::load(const std::string& name) {
+  auto& variables = frames.back().variables;
+  auto local = variables.find(name);
+  if (local != variables.end()) {
+    return local->second;
+  }
+  auto global = global_indices.find(name);
+  if (global != global_indices.end()) {
+    return load_value(global_kinds[global->second], &global_slots[global->second]);
+  }
+  auto global_const = global_user_def_type_consts.find(name);
+  if (global_const != global_user_def_type_consts.end()) {
+    return global_const->second;
+  }
+  LOG(ERROR) << "Unknown variable: " << name;
+  return 0;
+}
+
+void InterpreterVisitor::store(const std::string& name, int32_t value) {
+  auto& variables = frames.back().variables;
+  auto local = variables.find(name);
+  if (local != variables.end()) {
+    local->second = value;
+    return;
+  }
+  auto global = global_indices.find(name);
+  if (global != global_indices.end()) {
+    // stores have the width of the compiled global so native code reads the same value back
+    store_value(global_kinds[global->second], &global_slots[global->second], value);
+    return;
+  }
+  LOG(ERROR) << "Unknown variable: " << name;
+}
+
+InterpreterVisitor::Location
+InterpreterVisitor::locate(const Frontend::AST::IdentifierExpression& variable) {
+  const auto* element = dynamic_cast<const Frontend::AST::IndexExpression*>(&variable);
+  if (!element) {
+    return {&variable.get_name(), ValueKind::kInteger, nullptr};
+  }
+  int32_t index = evaluate(element->get_index());
+  auto& arrays = frames.back().arrays;
+  auto array = arrays.find(variable.get_name());
+  if (array == arrays.end()) {
+    array = global_arrays.find(variable.get_name());
+    if (array == global_arrays.end()) {
+      LOG(ERROR) << "Unknown array: " << variable.get_name();
+      return {nullptr, ValueKind::kInteger, nullptr};
+    }
+  }
+  const ArrayVariable& array_variable = array->second;
+  int64_t offset = static_cast<int64_t>(index) - array_variable.lower;
+  if (offset < 0 || offset >= array_variable.size) {
+    if (evaluating) {
+      throw EvaluationAbandoned();
+    }
+    LOG(ERROR) << "Array index out of bounds: " << variable.get_name() << "[" << index << "]";
+    return {nullptr, array_variable.kind, nullptr};
+  }
+  size_t element_size = array_variable.kind == ValueKind::kInteger ? 4 : 1;
+  return {&variable.get_name(), array_variable.kind,
+          static_cast<char*>(array_variable.elements) + offset * element_size};
+}
+
+int32_t InterpreterVisitor::load(const Location& location) {
+  if (location.element) {
+    return load_value(location.kind, location.element);
+  }
+  return location.name ? load(*location.name) : 0;
+}
+
+void InterpreterVisitor::store(const Location& location, int32_t value) {
+  if (location.element) {
+    store_value(location.kind, location.element, value);
+  } else if (location.name) {
+    store(*location.name, value);
+  }
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::IntegerExpression& expression) {
+  result = expression.get_value();
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::BooleanExpression& expression) {
+  result = expression.get_bool() ? 1 : 0;
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::CharacterExpression& expression) {
+  result = static_cast<int8_t>(expression.get_character());
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::CallExpression& expression) {
+  if (expression.get_name() == "output") {
+    interpret_output_call(expression);
+    return;
+  } else if (expression.get_name() == "read") {
+    interpret_read_call(expression);
+    return;
+  }
+
+  auto function = functions.find(expression.get_name());
+  if (function == functions.end()) {
+    LOG(ERROR) << "Unknown function referenced";
+    result = 0;
+    return;
+  }
+  std::vector<int32_t> args;
+  for (const auto& arg : expression.get_arguments()) {
+    args.push_back(evaluate(*arg));
+  }
+  result = call(*function->second, args);
+}
+
+void InterpreterVisitor::interpret_read_call(const Frontend::AST::CallExpression& expression) {
+  if (evaluating) {
+    // the input is only known when the program runs
+    throw EvaluationAbandoned();
+  }
+  for (const auto& arg : expression.get_arguments()) {
+    const Frontend::AST::IdentifierExpression* var_identifier =
+        dynamic_cast<const Frontend::AST::IdentifierExpression*>(arg.get());
+    if (!var_identifier) {
+      LOG(ERROR) << "'read' called with non global variable";
+      continue;
+    }
+    if (var_identifier->get_type_info() == "integer") {
+      Location target = locate(*var_identifier);
+      int32_t value;
+      if (wz_read_int(&value)) {
+        store(target, value);
+      }
+    } else if (var_identifier->get_type_info() == "char") {
+      Location target = locate(*var_identifier);
+      int8_t value;
+      if (wz_read_char(&value)) {
+        store(target, value);
+      }
+    } else {
+      LOG(ERROR) << "Unsupported variable type";
+      return;
+    }
+  }
+}
+
+void InterpreterVisitor::interpret_output_call(const Frontend::AST::CallExpression& expression) {
+  const auto& arguments = expression.get_arguments();
+  if (arguments.size() == 1) {
+    int32_t value = evaluate(*arguments[0]);
+    if (captured_output) {
+      print((arguments[0]->get_type_info() == "char" ? std::string(1, static_cast<char>(value))
+                                                     : std::to_string(value)) +
+            "\n");
+    } else if (arguments[0]->get_type_info() == "char") {
+      wz_out_char(value);
+    } else {
+      wz_out_int(value);
+    }
+    return;
+  }
+
+  // same layout as the compiled output call: integers followed by a space, characters as they are
+  // and a new line at the end
+  std::string format;
+  std::vector<int32_t> values;
+  for (const auto& arg : arguments) {
+    values.push_back(evaluate(*arg));
+    format += arg->get_type_info() == "char" ? "%c" : "%d ";
+  }
+  format += "\n";
+  if (!captured_output) {
+    wz_out_format(format.data(), format.size(), values.data());
+    return;
+  }
+  std::string text;
+  for (size_t value_index = 0; value_index < values.size(); value_index++) {
+    if (arguments[value_index]->get_type_info() == "char") {
+      text += static_cast<char>(values[value_index]);
+    } else {
+      text += std::to_string(values[value_index]) + " ";
+    }
+  }
+  print(text + "\n");
+}
+
+void InterpreterVisitor::print(const std::string& text) {
+  captured_output->append(text);
+  if (captured_output->size() > max_output_size) {
+    throw EvaluationAbandoned();
+  }
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::IdentifierExpression& expression) {
+  result = load(expression.get_name());
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::IndexExpression& expression) {
+  result = load(locate(expression));
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::AssignmentExpression& expression) {
+  Location target = locate(expression.get_name());
+  store(target, evaluate(expression.get_expression()));
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::SwapExpression& expression) {
+  Location lhs = locate(expression.get_lhs());
+  Location rhs = locate(expression.get_rhs());
+  int32_t value1 = load(lhs);
+  int32_t value2 = load(rhs);
+  store(lhs, value2);
+  store(rhs, value1);
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::IfExpression& expression) {
+  if (evaluate(expression.get_condition())) {
+    execute(expression.get_then_statement());
+  } else {
+    execute(expression.get_else_statement());
+  }
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::ForExpression& expression) {
+  expression.get_start_assignment().accept(*this);
+  while (evaluate(expression.get_condition())) {
+    execute(expression.get_body_statements());
+    if (returning) {
+      return;
+    }
+    expression.get_end_assignment().accept(*this);
+    count_back_edge();
+  }
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::RepeatUntilExpression& expression) {
+  do {
+    execute(expression.get_body_statements());
+    if (returning) {
+      return;
+    }
+    count_back_edge();
+  } while (!evaluate(expression.get_condition()));
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::WhileExpression& expression) {
+  while (evaluate(expression.get_condition())) {
+    execute(expression.get_body_statements());
+    if (returning) {
+      return;
+    }
+    count_back_edge();
+  }
+}
+
+bool InterpreterVisitor::case_matches(const Frontend::AST::CaseValue& case_value, int32_t value) {
+  if (std::holds_alternative<std::unique_ptr<Frontend::AST::Expression>>(case_value)) {
+    const Frontend::AST::Expression* value_expr =
+        std::get<std::unique_ptr<Frontend::AST::Expression>>(case_value).get();
+    if (const Frontend::AST::IdentifierExpression* const_identifier =
+            dynamic_cast<const Frontend::AST::IdentifierExpression*>(value_expr)) {
+      return lookup_user_type_const(const_identifier->get_name()) == value;
+    }
+    return evaluate(*value_expr) == value;
+  }
+  const auto& range = std::get<std::pair<std::unique_ptr<Frontend::AST::Expression>,
+                                         std::unique_ptr<Frontend::AST::Expression>>>(case_value);
+  return evaluate(*range.first) <= value && value <= evaluate(*range.second);
+}
+
+int32_t InterpreterVisitor::lookup_user_type_const(const std::string& name) {
+  // case labels name the constant or enum literal itself, not a variable that happens to shadow it
+  const Frontend::AST::Function* function =
+      frames.back().function_info ? frames.back().function_info->function : nullptr;
+  if (function) {
+    for (const auto& constant : function->get_constants()) {
+      if (constant->get_name() == name) {
+        return frames.back().variables[name];
+      }
+    }
+    for (const auto& type_def : function->get_type_defs()) {
+      const auto& value_names = type_def->get_value_names();
+      for (size_t value_index = 0; value_index < value_names.size(); value_index++) {
+        if (value_names[value_index] == name) {
+          return value_index;
+        }
+      }
+    }
+  }
+  auto global_const = global_user_def_type_consts.find(name);
+  if (global_const != global_user_def_type_consts.end()) {
+    return global_const->second;
+  }
+  LOG(ERROR) << "Unknown case value";
+  return -1;
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::CaseExpression& expression) {
+  int32_t value = evaluate(expression.get_expression());
+  for (const auto& case_clause : expression.get_cases()) {
+    if (case_matches(case_clause.first, value)) {
+      execute(case_clause.second);
+      break;
+    }
+  }
+  // the compiled code places the otherwise statements on the case exit, so every arm that does
+  // not return falls through to them as well
+  if (!returning) {
+    execute(expression.get_otherwise_clause());
+  }
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::ReturnExpression& expression) {
+  if (!frames.back().function_info) {
+    LOG(ERROR) << "Unknown return variable name";
+    return;
+  }
+  const Frontend::AST::Function* function = frames.back().function_info->function;
+  frames.back().variables[function->get_name()] = evaluate(expression.get_expression());
+  returning = true;
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::BinaryExpression& expression) {
+  if (short_circuit && (expression.get_op() == Frontend::AST::BinaryOperation::kAnd ||
+                        expression.get_op() == Frontend::AST::BinaryOperation::kOr)) {
+    result = evaluate(expression.get_lhs());
+    if (result == (expression.get_op() == Frontend::AST::BinaryOperation::kOr)) {
+      return;
+    }
+    result = evaluate(expression.get_rhs());
+    return;
+  }
+  uint32_t lhs = evaluate(expression.get_lhs());
+  uint32_t rhs = evaluate(expression.get_rhs());
+  int32_t signed_lhs = lhs;
+  int32_t signed_rhs = rhs;
+
+  switch (expression.get_op()) {
+  case Frontend::AST::BinaryOperation::kAdd:
+    result = lhs + rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kSubtract:
+    result = lhs - rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kMultiply:
+    result = lhs * rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kDivide:
+  case Frontend::AST::BinaryOperation::kModulo:
+    // the compiled program traps on both, the interpreter reports them and goes on with 0 as it
+    // does for indices out of bounds
+    if (signed_rhs == 0 ||
+        (signed_lhs == std::numeric_limits<int32_t>::min() && signed_rhs == -1)) {
+      if (evaluating) {
+        throw EvaluationAbandoned();
+      }
+      LOG(ERROR) << (signed_rhs == 0 ? "Division by zero: " : "Division overflow: ") << signed_lhs
+                 << (expression.get_op() == Frontend::AST::BinaryOperation::kDivide ? " / "
+                                                                                    : " mod ")
+                 << signed_rhs;
+      result = 0;
+      break;
+    }
+    result = expression.get_op() == Frontend::AST::BinaryOperation::kDivide
+                 ? signed_lhs / signed_rhs
+                 : signed_lhs % signed_rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kLessThan:
+    result = signed_lhs < signed_rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kLessThanOrEqual:
+    result = signed_lhs <= signed_rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kGreaterThan:
+    result = signed_lhs > signed_rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kGreaterThanOrEqual:
+    result = signed_lhs >= signed_rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kEqual:
+    result = signed_lhs == signed_rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kNotEqual:
+    result = signed_lhs != signed_rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kAnd:
+    result = lhs & rhs;
+    break;
+  case Frontend::AST::BinaryOperation::kOr:
+    result = lhs | rhs;
+    break;
+  default:
+    LOG(ERROR) << "Unknown binary operation";
+    result = 0;
+  }
+}
+
+void InterpreterVisitor::visit(const Frontend::AST::UnaryExpression& expression) {
+  uint32_t operand = evaluate(expression.get_expression());
+  switch (expression.get_op()) {
+  case Frontend::AST::UnaryOperation::kMinus:
+    result = 0u - operand;
+    break;
+  case Frontend::AST::UnaryOperation::kPlus:
+    result = operand;
+    break;
+  case Frontend::AST::UnaryOperation::kNot:
+    // only booleans can be negated
+    result = operand ^ 1;
+    break;
+  case Frontend::AST::UnaryOperation::kSucc:
+    result = operand + 1;
+    break;
+  case Frontend::AST::UnaryOperation::kPred:
+    result = operand - 1;
+    break;
+  default:
+    LOG(ERROR) << "Unknown unary operation";
+    result = 0;
+  }
+}
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "winzigc/common/pure.h"
+#include "winzigc/frontend/ast/visitor.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+// Entry point of a natively compiled function. Arguments and the result are passed as 32 bit
+// slots, narrower values (char, boolean) are sign/zero extended the same way the interpreter
+// holds them.
+using NativeEntry = int32_t (*)(const int32_t* args);
+
+class TierUpCompiler {
+public:
+  virtual ~TierUpCompiler() = default;
+  // Compiles the given functions to native code sharing the interpreter globals. Returns the
+  // entry point of each compiled function, or an empty map when compilation failed.
+  virtual std::map<std::string, NativeEntry> compile(const std::set<std::string>& functions) PURE;
+};
+
+// Tier 0 of the execution engine: walks the checked AST directly so that a program starts
+// running without paying for LLVM. Every function counts its calls and loop back edges, and once
+// a function gets hot it is handed to the tier up compiler together with the functions it calls.
+// Calls switch over to the native code through the per function entry table.
+class InterpreterVisitor : public Frontend::AST::Visitor {
+public:
+  static constexpr uint64_t kDefaultTierUpThreshold = 1000;
+  // every interpreted call takes a few frames of the native stack of the compiler
+  static constexpr size_t kMaxEvaluationDepth = 1000;
+  // a program calling deeper stops with an error instead of overflowing the native stack
+  static constexpr size_t kMaxCallDepth = 10000;
+
+  InterpreterVisitor(TierUpCompiler* tier_up_compiler = nullptr,
+                     uint64_t tier_up_threshold = kDefaultTierUpThreshold);
+  ~InterpreterVisitor() = default;
+
+  void set_tier_up_compiler(TierUpCompiler* compiler, uint64_t threshold);
+  // whether `and` and `or` skip their right operand when the left one decides the result
+  void set_short_circuit(bool enabled);
+  bool get_short_circuit() const;
+  int run(const Frontend::AST::Program& program);
+  void* get_global_address(const std::string& name) const;
+  std::set<std::string> get_callee_closure(const std::string& function_name) const;
+
+  // Compile-time evaluation for the code generator. `load_program` sets up the constants, the
+  // globals and the functions of the program without running it. `evaluate_main` runs the main
+  // body and captures what it prints in `output`, `evaluate_call` calls a function. Both fail
+  // when the program reads input, divides by zero, indexes an array out of its bounds, calls
+  // deeper than kMaxEvaluationDepth, or prints more than `max_output_size` bytes, and once the
+  // calls and loop iterations used up `step_budget`, which is decreased by the steps taken.
+  void load_program(const Frontend::AST::Program& program);
+  bool evaluate_main(const Frontend::AST::Program& program, uint64_t& step_budget,
+                     size_t max_output_size, std::string& output);
+  bool evaluate_call(const std::string& function_name, const std::vector<int32_t>& args,
+                     uint64_t& step_budget, int32_t& return_value);
+
+  void visit(const Frontend::AST::Program& program) override;
+  void visit(const Frontend::AST::Function& function) override;
+
+  void visit(const Frontend::AST::IntegerExpression& expression) override;
+  void visit(const Frontend::AST::BooleanExpression& expression) override;
+  void visit(const Frontend::AST::CharacterExpression& expression) override;
+
+  void visit(const Frontend::AST::CallExpression& expression) override;
+  void interpret_read_call(const Frontend::AST::CallExpression& expression);
+  void interpret_output_call(const Frontend::AST::CallExpression& expression);
+
+  void visit(const Frontend::AST::IdentifierExpression& expression) override;
+  void visit(const Frontend::AST::IndexExpression& expression) override;
+  void visit(const Frontend::AST::AssignmentExpression& expression) override;
+  void visit(const Frontend::AST::SwapExpression& expression) override;
+  void visit(const Frontend::AST::IfExpression& expression) override;
+  void visit(const Frontend::AST::ForExpression& expression) override;
+  void visit(const Frontend::AST::RepeatUntilExpression& expression) override;
+  void visit(const Frontend::AST::WhileExpression& expression) override;
+  void visit(const Frontend::AST::CaseExpression& expression) override;
+  void visit(const Frontend::AST::ReturnExpression& expression) override;
+  void visit(const Frontend::AST::BinaryExpression& expression) override;
+  void visit(const Frontend::AST::UnaryExpression& expression) override;
+
+  void visit(const Frontend::AST::LocalVariable& expression) override;
+  void visit(const Frontend::AST::GlobalVariable& expression) override;
+
+  void visit(const Frontend::AST::LocalConstant& expression) override;
+  void visit(const Frontend::AST::GlobalConstant& expression) override;
+
+  void visit(const Frontend::AST::LocalUserTypeDef& expression) override;
+  void visit(const Frontend::AST::GlobalUserTypeDef& expression) override;
+
+  void visit(const Frontend::AST::IntegerType& expression) override{};
+  void visit(const Frontend::AST::BooleanType& expression) override{};
+  void visit(const Frontend::AST::CharacterType& expression) override{};
+  void visit(const Frontend::AST::UserType& expression) override{};
+  void visit(const Frontend::AST::ArrayType& expression) override{};
+
+private:
+  enum class ValueKind { kInteger, kBoolean, kCharacter };
+
+  struct FunctionInfo {
+    const Frontend::AST::Function* function;
+    std::set<std::string> callees;
+    std::atomic<NativeEntry> native_entry{nullptr};
+    uint64_t calls = 0;
+    uint64_t back_edges = 0;
+    bool tier_up_failed = false;
+  };
+
+  // Elements are as wide as in the compiled code, one byte for booleans and characters, so that
+  // tiered up code can share the global arrays.
+  struct ArrayVariable {
+    int32_t lower;
+    int32_t size;
+    ValueKind kind;
+    void* elements;
+  };
+
+  struct Frame {
+    explicit Frame(FunctionInfo* function_info) : function_info(function_info) {}
+
+    FunctionInfo* function_info;
+    std::unordered_map<std::string, int32_t> variables;
+    std::unordered_map<std::string, ArrayVariable> arrays;
+    std::vector<std::unique_ptr<int32_t[]>> array_storage;
+  };
+
+  // Where a variable or an array element lives. Variables are looked up by name when they are
+  // accessed; elements are located once, so that their index is evaluated once, and have no
+  // address when the index is out of bounds.
+  struct Location {
+    const std::string* name;
+    ValueKind kind;
+    void* element;
+  };
+
+  static ValueKind get_value_kind(const Frontend::AST::Type& type);
+  static int32_t normalize(ValueKind kind, int32_t value);
+  static size_t get_slot_count(const Frontend::AST::Type& type);
+  static int32_t load_value(ValueKind kind, const void* address);
+  static void store_value(ValueKind kind, void* address, int32_t value);
+
+  int32_t evaluate(const Frontend::AST::Expression& expression);
+  void execute(const std::vector<std::unique_ptr<Frontend::AST::Expression>>& statements);
+  int32_t call(FunctionInfo& function_info, const std::vector<int32_t>& args);
+  void tier_up(FunctionInfo& function_info);
+  void count_back_edge();
+  bool evaluate_bounded(uint64_t& step_budget, const std::function<void()>& evaluation);
+  void count_step();
+  void print(const std::string& text);
+  bool case_matches(const Frontend::AST::CaseValue& case_value, int32_t value);
+  int32_t lookup_user_type_const(const std::string& name);
+  int32_t load(const std::string& name);
+  void store(const std::string& name, int32_t value);
+  Location locate(const Frontend::AST::IdentifierExpression& variable);
+  int32_t load(const Location& location);
+  void store(const Location& location, int32_t value);
+
+  TierUpCompiler* tier_up_compiler;
+  uint64_t tier_up_threshold;
+  bool short_circuit = true;
+
+  std::vector<ValueKind> global_kinds;
+  std::unique_ptr<int32_t[]> global_slots;
+  std::unordered_map<std::string, size_t> global_indices;
+  std::unordered_map<std::string, ArrayVariable> global_arrays;
+  // global enum literals and constants
+  std::unordered_map<std::string, int32_t> global_user_def_type_consts;
+  std::unordered_map<std::string, std::unique_ptr<FunctionInfo>> functions;
+  std::vector<Frame> frames;
+
+  int32_t result = 0;
+  bool returning = false;
+
+  // thrown to abandon a compile-time evaluation
+  struct EvaluationAbandoned {};
+  // thrown to stop a program calling deeper than kMaxCallDepth
+  struct CallDepthExceeded {};
+  bool evaluating = false;
+  uint64_t steps_left = 0;
+  size_t max_output_size = 0;
+  std::string* captured_output = nullptr;
+};
+
+} // namespace Visitor
+} // namespace WinZigC
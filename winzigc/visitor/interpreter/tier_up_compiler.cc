@@ -0,0 +1,95 @@
+#include "winzigc/visitor/interpreter/tier_up_compiler.h"
+#include "winzigc/visitor/codegen/codegen_visitor.h"
+
+#include "glog/logging.h"
+#include "llvm/ExecutionEngine/JITSymbol.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+JitTierUpCompiler::JitTierUpCompiler(const Frontend::AST::Program& program,
+                                     std::string program_path,
+                                     const InterpreterVisitor& interpreter)
+    : program(program), program_path(program_path), interpreter(interpreter) {}
+
+bool JitTierUpCompiler::initialize_jit() {
+  auto lljit = CodeGenVisitor::create_jit();
+  if (!lljit) {
+    LOG(ERROR) << "Could not create the JIT: " << llvm::toString(lljit.takeError());
+    return false;
+  }
+  jit = std::move(*lljit);
+  return true;
+}
+
+std::map<std::string, NativeEntry>
+JitTierUpCompiler::compile(const std::set<std::string>& functions) {
+  // the code generator also initializes the native target, so it has to run before the JIT is
+  // created on the first tier up
+  CodeGenVisitor codegen_visitor(false, false, interpreter.get_short_circuit());
+  codegen_visitor.codegen(program, program_path);
+  llvm::orc::ThreadSafeModule tier_module = codegen_visitor.release_tier_module(functions);
+  if (!jit && !initialize_jit()) {
+    return {};
+  }
+
+  auto dylib = jit->createJITDylib("tier" + std::to_string(tier_up_count++));
+  if (!dylib) {
+    LOG(ERROR) << "Could not create the JIT dylib: " << llvm::toString(dylib.takeError());
+    return {};
+  }
+  auto process_symbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      jit->getDataLayout().getGlobalPrefix());
+  if (!process_symbols) {
+    LOG(ERROR) << "Could not load host process symbols: "
+               << llvm::toString(process_symbols.takeError());
+    return {};
+  }
+  dylib->addGenerator(std::move(*process_symbols));
+  if (auto error = CodeGenVisitor::define_runtime_symbols(*jit, *dylib)) {
+    LOG(ERROR) << "Could not define the runtime symbols: " << llvm::toString(std::move(error));
+    return {};
+  }
+
+  llvm::orc::SymbolMap globals;
+  std::vector<std::string> global_names = {program.get_discard_variable()->get_name()};
+  for (const auto& var : program.get_variables()) {
+    global_names.push_back(var->get_name());
+  }
+  for (const auto& name : global_names) {
+    globals[jit->mangleAndIntern(CodeGenVisitor::kTierGlobalPrefix + name)] =
+        llvm::JITEvaluatedSymbol(
+            llvm::pointerToJITTargetAddress(interpreter.get_global_address(name)),
+            llvm::JITSymbolFlags::Exported);
+  }
+  if (auto error = dylib->define(llvm::orc::absoluteSymbols(std::move(globals)))) {
+    LOG(ERROR) << "Could not bind the program globals: " << llvm::toString(std::move(error));
+    return {};
+  }
+
+  tier_module.withModuleDo(
+      [this](llvm::Module& module) { module.setDataLayout(jit->getDataLayout()); });
+  if (auto error = jit->addIRModule(*dylib, std::move(tier_module))) {
+    LOG(ERROR) << "Could not add the module to the JIT: " << llvm::toString(std::move(error));
+    return {};
+  }
+
+  std::map<std::string, NativeEntry> native_entries;
+  for (const auto& name : functions) {
+    auto entry_symbol = jit->lookup(*dylib, name + CodeGenVisitor::kTierEntrySuffix);
+    if (!entry_symbol) {
+      LOG(ERROR) << "Could not find the entry of " << name << ": "
+                 << llvm::toString(entry_symbol.takeError());
+      return {};
+    }
+    native_entries[name] = reinterpret_cast<NativeEntry>(entry_symbol->getAddress());
+  }
+  return native_entries;
+}
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "winzigc/frontend/ast/program.h"
+#include "winzigc/visitor/interpreter/interpreter_visitor.h"
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+namespace WinZigC {
+namespace Visitor {
+
+// Tier 1 of the execution engine: compiles hot functions with LLVM at -O2 into an ORC JIT. Each
+// tier up goes into its own JITDylib whose program globals resolve to the interpreter storage,
+// so interpreted and native code always observe the same state.
+class JitTierUpCompiler : public TierUpCompiler {
+public:
+  JitTierUpCompiler(const Frontend::AST::Program& program, std::string program_path,
+                    const InterpreterVisitor& interpreter);
+  ~JitTierUpCompiler() = default;
+
+  std::map<std::string, NativeEntry> compile(const std::set<std::string>& functions) override;
+
+private:
+  bool initialize_jit();
+
+  const Frontend::AST::Program& program;
+  std::string program_path;
+  const InterpreterVisitor& interpreter;
+  std::unique_ptr<llvm::orc::LLJIT> jit;
+  int tier_up_count = 0;
+};
+
+} // namespace Visitor
+} // namespace WinZigC
@@ -14,12 +14,24 @@ std::vector<SemanticError> SemanticVisitor::check(const Frontend::AST::Program&
 }
 
 void SemanticVisitor::visit(const Frontend::AST::Program& program) {
+  for (const auto& constant : program.get_constants()) {
+    constant->accept(*this);
+  }
   for (const auto& user_type : program.get_user_types()) {
     user_type->accept(*this);
   }
   for (const auto& global_var : program.get_variables()) {
     global_var->accept(*this);
   }
+  // functions can be called before they are defined, e.g. by a function they call
+  for (const auto& function : program.get_functions()) {
+    std::vector<std::string> param_types;
+    for (const auto& param : function->get_parameters()) {
+      param_types.push_back(get_type(param->get_type()));
+    }
+    function_to_param_types.insert({function->get_name(), param_types});
+    function_to_return_type.insert({function->get_name(), get_type(function->get_return_type())});
+  }
   for (const auto& function : program.get_functions()) {
     function->accept(*this);
   }
@@ -32,13 +44,17 @@ void SemanticVisitor::visit(const Frontend::AST::Function& function) {
   current_function_name = function.get_name();
   current_function_return_type = get_type(function.get_return_type());
   local_var_to_type.insert({current_function_name, current_function_return_type});
-  function_to_return_type.insert({current_function_name, current_function_return_type});
-  std::vector<std::string> param_types;
   for (const auto& param : function.get_parameters()) {
     param->accept(*this);
-    param_types.push_back(get_type(param->get_type()));
+    if (dynamic_cast<const Frontend::AST::ArrayType*>(&param->get_type())) {
+      errors.push_back(SemanticError(param->get_line(), param->get_column(),
+                                     "Arrays cannot be passed to functions: '" +
+                                         param->get_name() + "'"));
+    }
+  }
+  for (const auto& constant : function.get_constants()) {
+    constant->accept(*this);
   }
-  function_to_param_types.insert({current_function_name, param_types});
   for (const auto& user_type : function.get_type_defs()) {
     user_type->accept(*this);
   }
@@ -49,6 +65,8 @@ void SemanticVisitor::visit(const Frontend::AST::Function& function) {
     statement->accept(*this);
   }
   local_var_to_type.clear();
+  local_var_to_array_type.clear();
+  local_constants.clear();
 };
 
 void SemanticVisitor::visit(const Frontend::AST::IntegerExpression& expression) {
@@ -74,6 +92,10 @@ void SemanticVisitor::visit(const Frontend::AST::CallExpression& expression) {
   if (expression.get_name() == "read" || expression.get_name() == "output") {
     for (const auto& arg : expression.get_arguments()) {
       arg->accept(*this);
+      const auto* variable = dynamic_cast<const Frontend::AST::IdentifierExpression*>(arg.get());
+      if (expression.get_name() == "read" && variable) {
+        check_not_constant(*variable);
+      }
     }
     return;
   }
@@ -113,12 +135,52 @@ void SemanticVisitor::visit(const Frontend::AST::IdentifierExpression& expressio
     errors.push_back(SemanticError(expression.get_line(), expression.get_column(),
                                    "Undeclared variable: '" + expression.get_name() + "'"));
   }
+  if (lookup_array_type(expression.get_name())) {
+    errors.push_back(
+        SemanticError(expression.get_line(), expression.get_column(),
+                      "Array '" + expression.get_name() + "' can only be used with an index"));
+    variable_type.clear();
+  }
   expression.set_type_info(variable_type);
 };
 
+void SemanticVisitor::visit(const Frontend::AST::IndexExpression& expression) {
+  expression.get_index().accept(*this);
+  std::string index_type = expression.get_index().get_type_info();
+  if (!index_type.empty() && index_type != "integer") {
+    errors.push_back(SemanticError(expression.get_line(), expression.get_column(),
+                                   "Array index type should be integer"));
+  }
+  if (lookup_variable_type(expression.get_name()).empty()) {
+    errors.push_back(SemanticError(expression.get_line(), expression.get_column(),
+                                   "Undeclared variable: '" + expression.get_name() + "'"));
+    return;
+  }
+  const Frontend::AST::ArrayType* array_type = lookup_array_type(expression.get_name());
+  if (!array_type) {
+    errors.push_back(SemanticError(expression.get_line(), expression.get_column(),
+                                   "Indexing a variable that is not an array: '" +
+                                       expression.get_name() + "'"));
+    return;
+  }
+  // only constant indices are checked, the others are the responsibility of the program
+  if (const Frontend::AST::IntegerExpression* constant_index =
+          dynamic_cast<const Frontend::AST::IntegerExpression*>(&expression.get_index())) {
+    if (constant_index->get_value() < array_type->get_lower() ||
+        constant_index->get_value() > array_type->get_upper()) {
+      errors.push_back(SemanticError(expression.get_line(), expression.get_column(),
+                                     "Array index out of bounds: '" + expression.get_name() +
+                                         "[" + std::to_string(constant_index->get_value()) +
+                                         "]'"));
+    }
+  }
+  expression.set_type_info(get_type(array_type->get_element_type()));
+};
+
 void SemanticVisitor::visit(const Frontend::AST::AssignmentExpression& expression) {
   expression.get_name().accept(*this);
   expression.get_expression().accept(*this);
+  check_not_constant(expression.get_name());
   std::string left_type = expression.get_name().get_type_info();
   std::string right_type = expression.get_expression().get_type_info();
   if (!left_type.empty() && !right_type.empty() && left_type != right_type) {
@@ -131,6 +193,8 @@ void SemanticVisitor::visit(const Frontend::AST::AssignmentExpression& expressio
 void SemanticVisitor::visit(const Frontend::AST::SwapExpression& expression) {
   expression.get_lhs().accept(*this);
   expression.get_rhs().accept(*this);
+  check_not_constant(expression.get_lhs());
+  check_not_constant(expression.get_rhs());
   std::string left_type = expression.get_lhs().get_type_info();
   std::string right_type = expression.get_rhs().get_type_info();
   if (!left_type.empty() && !right_type.empty() && left_type != right_type) {
@@ -346,6 +410,11 @@ void SemanticVisitor::visit(const Frontend::AST::LocalVariable& expression) {
                       "Redeclaration of local variable: '" + expression.get_name() + "'"));
   }
   local_var_to_type[expression.get_name()] = get_type(expression.get_type());
+  check_declared_type(expression.get_type(), expression.get_line(), expression.get_column());
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&expression.get_type())) {
+    local_var_to_array_type[expression.get_name()] = array_type;
+  }
 };
 
 void SemanticVisitor::visit(const Frontend::AST::GlobalVariable& expression) {
@@ -358,16 +427,43 @@ void SemanticVisitor::visit(const Frontend::AST::GlobalVariable& expression) {
                       "Redeclaration of global variable: '" + expression.get_name() + "'"));
   }
   global_var_to_type[expression.get_name()] = get_type(expression.get_type());
+  check_declared_type(expression.get_type(), expression.get_line(), expression.get_column());
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&expression.get_type())) {
+    global_var_to_array_type[expression.get_name()] = array_type;
+  }
+};
+
+void SemanticVisitor::visit(const Frontend::AST::LocalConstant& expression) {
+  std::string type = get_constant_type(expression);
+  if (local_var_to_type.find(expression.get_name()) != local_var_to_type.end()) {
+    errors.push_back(SemanticError(expression.get_line(), expression.get_column(),
+                                   "Redeclaration of constant: '" + expression.get_name() + "'"));
+  }
+  local_var_to_type[expression.get_name()] = type;
+  local_constants.insert(expression.get_name());
+};
+
+void SemanticVisitor::visit(const Frontend::AST::GlobalConstant& expression) {
+  std::string type = get_constant_type(expression);
+  if (global_var_to_type.find(expression.get_name()) != global_var_to_type.end()) {
+    errors.push_back(SemanticError(expression.get_line(), expression.get_column(),
+                                   "Redeclaration of constant: '" + expression.get_name() + "'"));
+  }
+  global_var_to_type[expression.get_name()] = type;
+  global_constants.insert(expression.get_name());
 };
 
 void SemanticVisitor::visit(const Frontend::AST::LocalUserTypeDef& expression) {
   for (const auto& user_value : expression.get_value_names()) {
     local_var_to_type[user_value] = "integer";
+    local_constants.insert(user_value);
   }
 };
 void SemanticVisitor::visit(const Frontend::AST::GlobalUserTypeDef& expression) {
   for (const auto& user_value : expression.get_value_names()) {
     global_var_to_type[user_value] = "integer";
+    global_constants.insert(user_value);
   }
 };
 
@@ -375,6 +471,70 @@ void SemanticVisitor::visit(const Frontend::AST::IntegerType& expression){};
 void SemanticVisitor::visit(const Frontend::AST::BooleanType& expression){};
 void SemanticVisitor::visit(const Frontend::AST::CharacterType& expression){};
 void SemanticVisitor::visit(const Frontend::AST::UserType& expression){};
+void SemanticVisitor::visit(const Frontend::AST::ArrayType& expression){};
+
+void SemanticVisitor::check_declared_type(const Frontend::AST::Type& type, int line, int column) {
+  if (const Frontend::AST::ArrayType* array_type =
+          dynamic_cast<const Frontend::AST::ArrayType*>(&type)) {
+    if (array_type->get_upper() < array_type->get_lower()) {
+      errors.push_back(
+          SemanticError(line, column, "Array upper bound is less than its lower bound"));
+    }
+  }
+}
+
+// A constant is a literal or names an enum literal or a constant declared before it.
+std::string SemanticVisitor::get_constant_type(const Frontend::AST::Constant& constant) {
+  constant.get_value().accept(*this);
+  const auto* identifier =
+      dynamic_cast<const Frontend::AST::IdentifierExpression*>(&constant.get_value());
+  if (identifier && !lookup_variable_type(identifier->get_name()).empty() &&
+      !is_constant(identifier->get_name())) {
+    errors.push_back(SemanticError(identifier->get_line(), identifier->get_column(),
+                                   "Constant value is not a constant: '" +
+                                       identifier->get_name() + "'"));
+    return "";
+  }
+  return constant.get_value().get_type_info();
+}
+
+// locals hide the global constants of the same name
+bool SemanticVisitor::is_constant(const std::string& name) const {
+  if (local_var_to_type.find(name) != local_var_to_type.end()) {
+    return local_constants.count(name) != 0;
+  }
+  return global_constants.count(name) != 0;
+}
+
+void SemanticVisitor::check_not_constant(const Frontend::AST::IdentifierExpression& variable) {
+  if (!dynamic_cast<const Frontend::AST::IndexExpression*>(&variable) &&
+      is_constant(variable.get_name())) {
+    errors.push_back(SemanticError(variable.get_line(), variable.get_column(),
+                                   "Cannot assign to constant: '" + variable.get_name() + "'"));
+  }
+}
+
+std::string SemanticVisitor::lookup_variable_type(const std::string& name) const {
+  auto local = local_var_to_type.find(name);
+  if (local != local_var_to_type.end()) {
+    return local->second;
+  }
+  auto global = global_var_to_type.find(name);
+  if (global != global_var_to_type.end()) {
+    return global->second;
+  }
+  return "";
+}
+
+// locals hide globals of the same name, arrays or not
+const Frontend::AST::ArrayType* SemanticVisitor::lookup_array_type(const std::string& name) const {
+  if (local_var_to_type.find(name) != local_var_to_type.end()) {
+    auto local = local_var_to_array_type.find(name);
+    return local != local_var_to_array_type.end() ? local->second : nullptr;
+  }
+  auto global = global_var_to_array_type.find(name);
+  return global != global_var_to_array_type.end() ? global->second : nullptr;
+}
 
 std::string SemanticVisitor::get_type(const Frontend::AST::Type& type) {
   if (const Frontend::AST::IntegerType* integer_type =
@@ -389,6 +549,11 @@ std::string SemanticVisitor::get_type(const Frontend::AST::Type& type) {
   } else if (const Frontend::AST::UserType* user_type =
                  dynamic_cast<const Frontend::AST::UserType*>(&type)) {
     return "integer";
+  } else if (const Frontend::AST::ArrayType* array_type =
+                 dynamic_cast<const Frontend::AST::ArrayType*>(&type)) {
+    return "array [" + std::to_string(array_type->get_lower()) + ".." +
+           std::to_string(array_type->get_upper()) + "] of " +
+           get_type(array_type->get_element_type());
   }
   return "";
 }
@@ -1,5 +1,6 @@
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "winzigc/frontend/ast/visitor.h"
 
@@ -41,6 +42,7 @@ public:
   void visit(const Frontend::AST::CallExpression& expression) override;
 
   void visit(const Frontend::AST::IdentifierExpression& expression) override;
+  void visit(const Frontend::AST::IndexExpression& expression) override;
   void visit(const Frontend::AST::AssignmentExpression& expression) override;
   void visit(const Frontend::AST::SwapExpression& expression) override;
   void visit(const Frontend::AST::IfExpression& expression) override;
@@ -55,6 +57,9 @@ public:
   void visit(const Frontend::AST::LocalVariable& expression) override;
   void visit(const Frontend::AST::GlobalVariable& expression) override;
 
+  void visit(const Frontend::AST::LocalConstant& expression) override;
+  void visit(const Frontend::AST::GlobalConstant& expression) override;
+
   void visit(const Frontend::AST::LocalUserTypeDef& expression) override;
   void visit(const Frontend::AST::GlobalUserTypeDef& expression) override;
 
@@ -62,13 +67,26 @@ public:
   void visit(const Frontend::AST::BooleanType& expression) override;
   void visit(const Frontend::AST::CharacterType& expression) override;
   void visit(const Frontend::AST::UserType& expression) override;
+  void visit(const Frontend::AST::ArrayType& expression) override;
 
   std::string get_type(const Frontend::AST::Type& type);
 
 private:
+  std::string lookup_variable_type(const std::string& name) const;
+  const Frontend::AST::ArrayType* lookup_array_type(const std::string& name) const;
+  void check_declared_type(const Frontend::AST::Type& type, int line, int column);
+  std::string get_constant_type(const Frontend::AST::Constant& constant);
+  bool is_constant(const std::string& name) const;
+  void check_not_constant(const Frontend::AST::IdentifierExpression& variable);
+
   std::vector<SemanticError> errors;
   std::unordered_map<std::string, std::string> global_var_to_type = {{"d", "integer"}};
   std::unordered_map<std::string, std::string> local_var_to_type;
+  std::unordered_map<std::string, const Frontend::AST::ArrayType*> global_var_to_array_type;
+  std::unordered_map<std::string, const Frontend::AST::ArrayType*> local_var_to_array_type;
+  // constants and enum literals, they are typed like variables but cannot be written
+  std::unordered_set<std::string> global_constants;
+  std::unordered_set<std::string> local_constants;
   std::unordered_map<std::string, std::string> function_to_return_type = {{"read", "void"},
                                                                           {"output", "void"}};
   std::string current_function_return_type;